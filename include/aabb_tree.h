@@ -0,0 +1,113 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include "collision.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A dynamic bounding volume hierarchy, used as a broad phase for collisions.
+ * Each item is a leaf of a binary tree whose internal nodes bound their
+ * children, so a query only descends into the subtrees that can overlap it.
+ * Unlike a grid, this works well however uneven the sizes of the items are.
+ *
+ * Leaves store their item's bounds grown by a margin, so an item that moves
+ * a little stays inside them and its leaf does not need to be touched.
+ * The tree is kept balanced with rotations as leaves are inserted and
+ * removed, so inserting, removing and moving an item take O(log n) time.
+ */
+typedef struct aabb_tree aabb_tree_t;
+
+/**
+ * A function called with each item whose bounds overlap a query box.
+ */
+typedef void (*aabb_tree_query_func_t)(void *item, void *aux);
+
+/**
+ * Allocates memory for an empty AABB tree.
+ * Asserts that the margin is not negative.
+ *
+ * @param margin how far each leaf's bounds extend past its item's bounds.
+ *   Works best when it is about how far a typical item moves in a few ticks.
+ * @return a pointer to the newly allocated tree
+ */
+aabb_tree_t *aabb_tree_init(double margin);
+
+/**
+ * Releases the memory allocated for an AABB tree.
+ * Does not free the items stored in it.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ */
+void aabb_tree_free(aabb_tree_t *tree);
+
+/**
+ * Gets the number of items in an AABB tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @return the number of items inserted and not removed
+ */
+size_t aabb_tree_size(aabb_tree_t *tree);
+
+/**
+ * Gets the height of an AABB tree, which is logarithmic in its size.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @return the number of edges from the root to the deepest leaf,
+ *   or 0 if the tree has no more than one item
+ */
+size_t aabb_tree_height(aabb_tree_t *tree);
+
+/**
+ * Adds an item to an AABB tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param item the item to store (not owned by the tree)
+ * @param bounds the bounding box of the item
+ * @return the item's proxy, which identifies it in later calls
+ */
+size_t aabb_tree_insert(aabb_tree_t *tree, void *item, aabb_t bounds);
+
+/**
+ * Removes an item from an AABB tree.
+ * The proxy may be reused by a later insertion.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy the proxy returned when the item was inserted
+ */
+void aabb_tree_remove(aabb_tree_t *tree, size_t proxy);
+
+/**
+ * Changes the bounding box of an item.
+ * The tree is only changed if the new bounds leave the item's leaf.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy the proxy returned when the item was inserted
+ * @param bounds the new bounding box of the item
+ * @return whether the item's leaf had to be moved
+ */
+bool aabb_tree_move(aabb_tree_t *tree, size_t proxy, aabb_t bounds);
+
+/**
+ * Gets the bounds stored in an item's leaf, which contain its bounding box.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy the proxy returned when the item was inserted
+ * @return the item's bounds, grown by the tree's margin
+ */
+aabb_t aabb_tree_get_fat_bounds(aabb_tree_t *tree, size_t proxy);
+
+/**
+ * Calls a function once for every item whose leaf overlaps a given box.
+ * Since leaves are grown by the margin, this may include items that are
+ * near the box but do not overlap it.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param bounds the box to look for items in
+ * @param func the function to call with each overlapping item
+ * @param aux an auxiliary value to pass to func
+ */
+void aabb_tree_query(aabb_tree_t *tree, aabb_t bounds,
+                     aabb_tree_query_func_t func, void *aux);
+
+#endif // #ifndef __AABB_TREE_H__
@@ -3,9 +3,35 @@
 
 #include "collision.h"
 #include "color.h"
+#include "gjk.h"
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include "image.h"
+#include "integration.h"
+
+/**
+ * A link from a body to a force creator or collision in a scene
+ * that depends on the body. Defined and maintained by the scene.
+ */
+typedef struct scene_link scene_link_t;
+
+/**
+ * Storage for the physics state of many bodies (see struct body_store).
+ */
+typedef struct body_store body_store_t;
+
+/**
+ * The kind of shape a body has, which picks its collision test.
+ * Every body also keeps a polygon, used for drawing and body_get_shape().
+ */
+typedef enum {
+  BODY_SHAPE_POLYGON,
+  // a circle of radius bounding_radius centered on pos
+  BODY_SHAPE_CIRCLE,
+  // a rectangle, detected from the polygon passed to the body
+  BODY_SHAPE_BOX
+} body_shape_kind_t;
 
 /**
  * A rigid body constrained to the plane.
@@ -14,25 +40,110 @@
  * Angular physics (i.e. torques) are not currently implemented.
  */
 typedef struct {
-  list_t *shape;
-  double mass;
+  body_shape_kind_t shape_kind;
+  // the shape relative to pos, before rotating by angle
+  polygon_t *local_shape;
+  // the shape in world coordinates, recomputed when it is needed after the
+  // body has moved (see body_get_shape_unsafe())
+  polygon_t *shape;
+  bool shape_dirty;
+  // for boxes, the box relative to pos, and in world coordinates
+  box_t local_box;
+  box_t box;
+  // the bounds of the body, refreshed with box when they are needed
+  // after the body has moved
+  aabb_t aabb;
+  bool bounds_dirty;
+  // the distance from pos to the farthest vertex, which rotation preserves
+  double bounding_radius;
   rgb_color_t color;
+  // the physics state, only used while the body is not in a store,
+  // and otherwise kept in the store's arrays (see body_store_add())
+  double mass;
   vector_t vel;
   vector_t pos;
   double angular_vel;
   double angle;
   vector_t net_force;
   vector_t net_impulse;
+  // the store holding the body's physics state, and its index in the store
+  body_store_t *store;
+  size_t slot;
+  // the transform saved before the last fixed step (see body_save_transform())
+  vector_t prev_pos;
+  double prev_angle;
   void *info;
   free_func_t freer;
   bool removed;
+  // never integrated, and only tested for collisions against dynamic bodies
+  bool is_static;
+  // swept along its path each tick so it cannot pass through thin bodies
+  bool is_fast;
+  // skipped like a static body until something moves it (see body_sleep())
+  bool asleep;
+  // how long the body has been moving slowly enough to sleep
+  double slow_time;
   image_t *image;
   double image_scale;
   double image_rotation;
   vector_t image_offset;
   const char *type;
+  // the id the scene gave the body's type (see scene_type_id())
+  size_t type_id;
+  // force creators and collisions depending on this body, so removing it
+  // from a scene only touches those
+  scene_link_t *scene_links;
+  // scratch space for the scene's contact solver while it builds islands
+  size_t island_node;
+  // whether the scene's broad phase last treated the body as resting
+  bool broad_phase_resting;
+  // the body's proxy in the scene's sweep and prune or AABB tree broad phase,
+  // if it is using one
+  size_t broad_phase_proxy;
+  bool has_broad_phase_proxy;
+  // whether the body is in its store's list of changed bodies
+  bool changed;
 } body_t;
 
+/**
+ * Structure-of-arrays storage for the physics state of a scene's bodies.
+ * While a body is in a store, its mass, position, velocity, angle,
+ * and accumulated forces live in the store's arrays at the body's slot
+ * rather than in the body, so passes over every body
+ * (e.g. body_store_integrate()) stream through contiguous arrays instead of
+ * following a pointer to each body. A body's getters and setters read and
+ * write the store, so body_t pointers remain handles to the bodies.
+ */
+struct body_store {
+  size_t size;
+  size_t capacity;
+  // the body in each slot
+  body_t **bodies;
+  double *mass;
+  vector_t *vel;
+  vector_t *pos;
+  double *angular_vel;
+  double *angle;
+  vector_t *net_force;
+  vector_t *net_impulse;
+  // whether each body is integrated, i.e. not removed, static, or asleep
+  bool *active;
+  // whether each body was moved by body_store_integrate() since it last
+  // marked its cached shape and bounds as stale
+  bool *moved;
+  // the bodies that moved, were added or removed, or fell asleep or woke
+  // since the last body_store_clear_changed(), so a scene can refresh just
+  // those in its broad phase; not kept while all_changed is set
+  body_t **changed;
+  size_t num_changed;
+  // set when every body may have changed, e.g. by body_store_integrate()
+  bool all_changed;
+  // the number of bodies marked for removal since the last compaction
+  size_t num_removed;
+  // how the bodies in the store are ticked, INTEGRATOR_VERLET by default
+  integrator_t integrator;
+};
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -44,7 +155,8 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
  * The body is initially at rest.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
- * @param shape a list of vectors describing the initial shape of the body
+ * @param shape a list of vectors describing the initial shape of the body.
+ *   The body copies it into a polygon and frees the list.
  * @param mass the mass of the body (if INFINITY, stops the body from moving)
  * @param color the color of the body, used to draw it on the screen
  * @param info additional information to associate with the body,
@@ -54,6 +166,35 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
  */
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color, const char *type);
 
+/**
+ * Allocates memory for a body with the given parameters.
+ * Acts like body_init_with_info(), but takes ownership of a polygon
+ * instead of copying a list of vectors.
+ *
+ * @param shape the initial shape of the body, freed with the body
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param type the type of the body, compared by pointer
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_with_polygon(polygon_t *shape, double mass, rgb_color_t color,
+                               const char *type);
+
+/**
+ * Allocates memory for a circular body centered on the origin.
+ * Collisions with circular bodies are computed exactly
+ * (see find_circle_collision() and find_circle_polygon_collision()),
+ * rather than with the polygon approximating the circle.
+ *
+ * @param radius the radius of the circle
+ * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param type the type of the body, compared by pointer
+ * @return a pointer to the newly allocated body
+ */
+body_t *body_init_circle(double radius, double mass, rgb_color_t color,
+                         const char *type);
+
 /**
  * Releases the memory allocated for a body.
  *
@@ -71,13 +212,135 @@ void body_free(body_t *body);
 list_t *body_get_shape(body_t *body);
 
 /**
- * Gets the current shape of the body, but returns the internal shape list (not
- * a copy)
+ * Gets the current shape of the body, but returns the internal polygon (not
+ * a copy).
+ * The world-space vertices are only recomputed here, and only if the body
+ * has moved since they were last computed.
+ * The polygon is invalidated by the next change to the body's position or angle.
  */
-list_t *body_get_shape_unsafe(body_t *body);
+polygon_t *body_get_shape_unsafe(body_t *body);
 
+/**
+ * Computes the status of the collision between two bodies' current shapes.
+ * Bodies whose bounding circles or bounding boxes do not overlap are
+ * rejected before testing their shapes with find_polygon_collision().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies are colliding, and if so, the collision axis
+ */
 collision_info_t body_collide(body_t *body1, body_t *body2);
 
+/**
+ * Acts like body_collide(), but tries the axis in axis_cache first
+ * when testing polygons and boxes (see find_polygon_collision_cached()).
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param axis_cache the separating axis cached for this pair of bodies,
+ *   initially VEC_ZERO
+ * @return whether the bodies are colliding, and if so, the collision axis
+ */
+collision_info_t body_collide_cached(body_t *body1, body_t *body2,
+                                     vector_t *axis_cache);
+
+/**
+ * Acts like body_collide(), but tests pairs involving a polygon with
+ * find_gjk_collision_cached() instead of the separating axis test.
+ * Circles and pairs of boxes still use their own tests.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param simplex_cache the GJK simplex cached for this pair of bodies,
+ *   initially zeroed, or NULL to start from scratch
+ * @return whether the bodies are colliding, and if so, the collision axis
+ */
+collision_info_t body_collide_gjk(body_t *body1, body_t *body2,
+                                  gjk_simplex_t *simplex_cache);
+
+/**
+ * Allocates memory for an empty body store.
+ * Asserts that the required memory is allocated.
+ *
+ * @param initial_capacity the number of bodies to allocate space for
+ * @return a pointer to the newly allocated store
+ */
+body_store_t *body_store_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a body store.
+ * Does not free the bodies in it, which must not be used afterwards
+ * unless they are freed first.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_free(body_store_t *store);
+
+/**
+ * Moves a body's physics state into the next slot of a store.
+ * Asserts that the body is not already in a store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_store_add(body_store_t *store, body_t *body);
+
+/**
+ * Removes the bodies marked for removal from a store, moving their state
+ * back into them, and shifts the remaining bodies down to fill the gaps.
+ * The remaining bodies keep their order.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_compact(body_store_t *store);
+
+/**
+ * Forgets which bodies in a store have changed (see struct body_store),
+ * e.g. once a scene's broad phase has caught up with them.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_clear_changed(body_store_t *store);
+
+/**
+ * Ticks every body in a store that is not removed, static, or asleep,
+ * exactly as body_tick() would, in a single pass over the store's arrays.
+ * Uses SIMD instructions where the CPU has them (see integrate_batch()).
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_integrate(body_store_t *store, double dt);
+
+/**
+ * Gets the axis-aligned bounding box of a body's current shape.
+ * The box is cached, and only recomputed after the body moves.
+ * Circles and boxes compute it without transforming their polygon.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smallest axis-aligned box containing the body
+ */
+aabb_t body_get_aabb(body_t *body);
+
+/**
+ * Gets the kind of shape a body has.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return BODY_SHAPE_CIRCLE if the body was created by body_init_circle(),
+ *   BODY_SHAPE_BOX if its polygon is a rectangle,
+ *   and BODY_SHAPE_POLYGON otherwise
+ */
+body_shape_kind_t body_get_shape_kind(body_t *body);
+
+/**
+ * Gets the radius of a body's bounding circle, which is centered on its
+ * centroid. The radius does not change as the body moves or rotates.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the distance from the centroid to the farthest vertex
+ */
+double body_get_bounding_radius(body_t *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -97,6 +360,42 @@ vector_t body_get_centroid(body_t *body);
  */
 vector_t body_get_velocity(body_t *body);
 
+/**
+ * Records a body's current position and angle as its previous transform,
+ * which body_get_interpolated_centroid() and friends blend from.
+ * The scene calls this before each fixed step (see scene_step_fixed()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_save_transform(body_t *body);
+
+/**
+ * Gets a body's centroid blended between its previous and current transform.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha 0 for the previous centroid, 1 for the current one
+ * @return the interpolated centroid
+ */
+vector_t body_get_interpolated_centroid(body_t *body, double alpha);
+
+/**
+ * Gets a body's angle blended between its previous and current transform.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha 0 for the previous angle, 1 for the current one
+ * @return the interpolated angle
+ */
+double body_get_interpolated_angle(body_t *body, double alpha);
+
+/**
+ * Gets a body's shape placed at its interpolated centroid and angle.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha 0 for the previous transform, 1 for the current one
+ * @return a newly allocated polygon, which the caller must free
+ */
+polygon_t *body_get_interpolated_shape(body_t *body, double alpha);
+
 /**
  * Gets the mass of a body.
  *
@@ -153,6 +452,14 @@ void body_set_rotation(body_t *body, double angle);
  */
 void body_set_angular_velocity(body_t *body, double angular_velocity);
 
+/**
+ * Gets a body's angular velocity.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's angular velocity, in radians per second
+ */
+double body_get_angular_velocity(body_t *body);
+
 /**
  * Applies a force to a body over the current tick.
  * If multiple forces are applied in the same tick, they should be added.
@@ -175,12 +482,34 @@ void body_add_force(body_t *body, vector_t force);
  */
 void body_add_impulse(body_t *body, vector_t impulse);
 
+/**
+ * Gets the velocity a body will have after its next body_tick(),
+ * given the forces and impulses applied to it so far this tick.
+ * Lets a contact solver see the effect of the impulses it has applied.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the length of the tick, in seconds
+ * @return the body's velocity after the tick
+ */
+vector_t body_get_next_velocity(body_t *body, double dt);
+
+/**
+ * Gets how far a body will move in its next body_tick(),
+ * given the forces and impulses applied to it so far this tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param dt the length of the tick, in seconds
+ * @return the body's displacement over the tick
+ */
+vector_t body_get_tick_displacement(body_t *body, double dt);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
  * applied to the body during the tick.
  * The body should be translated at the *average* of the velocities before
- * and after the tick.
+ * and after the tick, unless it is in a store that uses
+ * INTEGRATOR_SEMI_IMPLICIT_EULER, which translates it at the new velocity.
  * Resets the forces and impulses accumulated on the body.
  *
  * @param body the body to tick
@@ -210,6 +539,76 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Makes a body static, e.g. a wall.
+ * Static bodies are never moved by body_tick() in a scene,
+ * and are only tested for collisions against bodies that are not static.
+ * A scene keeps its static bodies in a separate broad phase that is only
+ * rebuilt when a static body is added or removed, so static bodies must not
+ * be moved after they are added to a scene.
+ * Asserts that the body has infinite mass.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_set_static(body_t *body);
+
+/**
+ * Returns whether body_set_static() has been called on a body.
+ *
+ * @param body the body to check
+ * @return whether the body is static
+ */
+bool body_is_static(body_t *body);
+
+/**
+ * Marks a body as fast, e.g. a bullet.
+ * Every tick, a scene sweeps a fast body along the path it is about to
+ * travel, and if it would touch a body it has collision or contact handlers
+ * with, moves it to the point of impact and calls those handlers then.
+ * It then moves only for the rest of the tick, at the velocity it has
+ * after the handlers and the contact solver.
+ * This stops fast bodies from passing through thin bodies between ticks.
+ * A fast body that is not a circle is swept as its bounding circle.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_set_fast(body_t *body);
+
+/**
+ * Returns whether body_set_fast() has been called on a body.
+ *
+ * @param body the body to check
+ * @return whether the body is fast
+ */
+bool body_is_fast(body_t *body);
+
+/**
+ * Puts a body to sleep, stopping it. A scene does not integrate sleeping
+ * bodies, skips force creators whose bodies are all asleep or static,
+ * and does not test sleeping bodies against each other or static bodies.
+ * Applying a nonzero force or impulse, setting a nonzero velocity,
+ * or moving the body (e.g. with body_set_centroid()) wakes it up.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_sleep(body_t *body);
+
+/**
+ * Wakes up a sleeping body, restarting the time it has been at rest.
+ * Does nothing to a body that is awake.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_wake(body_t *body);
+
+/**
+ * Returns whether a body is asleep (see body_sleep()).
+ *
+ * @param body the body to check
+ * @return whether the body is asleep
+ */
+bool body_is_asleep(body_t *body);
+
 /**
  * @param name file in assets/image folder, excluding ".png", for example "tank_green" 
  * @param scale image scaling factor when rendering
@@ -2,6 +2,7 @@
 #define __COLLISION_H__
 
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include <stdbool.h>
 
@@ -19,10 +20,225 @@ typedef struct {
    * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * If the shapes are colliding, how far they overlap along axis,
+   * i.e. how far shape2 must move along axis to stop overlapping shape1.
+   */
+  double depth;
+  /** If the shapes are colliding, the number of contact points (1 or 2) */
+  size_t num_contacts;
+  /**
+   * If the shapes are colliding, the points of one shape
+   * that lie deepest inside the other. Two parallel edges in contact
+   * give two points, the ends of their overlap; otherwise there is one.
+   */
+  vector_t contacts[2];
 } collision_info_t;
 
+/**
+ * The algorithms available for testing a pair of convex polygons.
+ * Both give the same collision_info_t; which is faster depends on the shapes.
+ */
+typedef enum {
+  /**
+   * The separating axis test (find_polygon_collision()).
+   * Tests every edge normal of both shapes, so it is best for few vertices.
+   */
+  COLLISION_ENGINE_SAT,
+  /**
+   * GJK to detect the collision, then EPA to find its axis
+   * (find_gjk_collision()). Each step only needs the farthest vertex of
+   * each shape in some direction, so it is best for many vertices.
+   */
+  COLLISION_ENGINE_GJK
+} collision_engine_t;
+
+/**
+ * An axis-aligned bounding box.
+ * Used to cheaply rule out collisions before testing the shapes themselves.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+/**
+ * An oriented rectangle, described by its center and half side lengths
+ * along a pair of perpendicular axes.
+ */
+typedef struct {
+  vector_t center;
+  /** A unit vector along the box's first side */
+  vector_t axis;
+  /** Half the length of the box's sides along axis and its perpendicular */
+  vector_t half_size;
+} box_t;
+
+/**
+ * Checks whether a polygon is a rectangle, and if so, describes it as a box.
+ *
+ * @param polygon the polygon to check
+ * @param box if the polygon is a rectangle, set to the matching box
+ * @return whether the polygon is a rectangle
+ */
+bool polygon_get_box(polygon_t *polygon, box_t *box);
+
+/**
+ * Computes the status of the collision between two convex polygons.
+ * Pairs of rectangles are tested with find_box_collision().
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_polygon_collision(polygon_t *shape1, polygon_t *shape2);
+
+/**
+ * Acts like find_polygon_collision(), but first tests the axis in axis_cache.
+ * Pairs of shapes usually stay separated along the same axis for many ticks,
+ * so this often takes a single projection of each shape.
+ * See find_box_collision_cached().
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param axis_cache the axis to try first (VEC_ZERO if there is none),
+ *   updated with the axis to try next time
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+collision_info_t find_polygon_collision_cached(polygon_t *shape1,
+                                              polygon_t *shape2,
+                                              vector_t *axis_cache);
+
+/**
+ * Computes the status of the collision between two circles.
+ *
+ * @param center1 the center of the first circle
+ * @param radius1 the radius of the first circle
+ * @param center2 the center of the second circle
+ * @param radius2 the radius of the second circle
+ * @return whether the circles are colliding, and if so, the collision axis.
+ * The axis is a unit vector pointing from the first center to the second.
+ */
+collision_info_t find_circle_collision(vector_t center1, double radius1,
+                                       vector_t center2, double radius2);
+
+/**
+ * Computes the status of the collision between a circle and a convex polygon.
+ * Much cheaper than approximating the circle with a polygon,
+ * since only one axis is tested per polygon edge, plus one more.
+ *
+ * @param center the center of the circle
+ * @param radius the radius of the circle
+ * @param polygon the polygon
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis is a unit vector pointing from the circle towards the polygon.
+ */
+collision_info_t find_circle_polygon_collision(vector_t center, double radius,
+                                               polygon_t *polygon);
+
+/**
+ * Computes the status of the collision between two boxes.
+ * Only the two axes of each box need to be tested, and their normals are
+ * known without normalizing any edges.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @return whether the boxes are colliding, and if so, the collision axis.
+ * The axis is a unit vector pointing from box1 towards box2.
+ */
+collision_info_t find_box_collision(box_t box1, box_t box2);
+
+/**
+ * Acts like find_box_collision(), but first tests the axis in axis_cache.
+ * If that axis still separates the boxes, no other axis is tested.
+ * Otherwise, stores the axis that separated the boxes,
+ * or the axis they collided along, so it can be tried first next time.
+ * Pass the same cache each time the same pair of shapes is tested.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @param axis_cache the axis to try first (VEC_ZERO if there is none),
+ *   updated with the axis to try next time. If NULL, acts like
+ *   find_box_collision().
+ * @return whether the boxes are colliding, and if so, the collision axis
+ */
+collision_info_t find_box_collision_cached(box_t box1, box_t box2,
+                                          vector_t *axis_cache);
+
+/**
+ * Computes the status of the collision between a circle and a box,
+ * using the point of the box closest to the circle's center.
+ *
+ * @param center the center of the circle
+ * @param radius the radius of the circle
+ * @param box the box
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis is a unit vector pointing from the circle towards the box.
+ */
+collision_info_t find_circle_box_collision(vector_t center, double radius,
+                                           box_t box);
+
+/**
+ * Finds when a moving circle first touches another circle.
+ * The second circle is held still, so pass the circles' relative motion
+ * if both are moving.
+ *
+ * @param start the center of the moving circle at the start of its motion
+ * @param displacement how far the moving circle's center moves
+ * @param radius1 the radius of the moving circle
+ * @param center2 the center of the other circle
+ * @param radius2 the radius of the other circle
+ * @param collision set to the collision at the moment the circles touch,
+ *   with depth 0 and an axis from the moving circle towards the other one.
+ *   If the circles overlap at the start, set to that collision instead.
+ * @return the fraction of displacement (between 0 and 1) the moving circle
+ *   travels before touching the other one, 0 if they already overlap,
+ *   or INFINITY if they do not touch
+ */
+double find_circle_toi(vector_t start, vector_t displacement, double radius1,
+                       vector_t center2, double radius2,
+                       collision_info_t *collision);
+
+/**
+ * Finds when a moving circle first touches a convex polygon.
+ * The circle's center touches the polygon grown by the circle's radius,
+ * so its path is tested against each edge pushed out by the radius
+ * and a circle around each vertex.
+ * The polygon is held still, so pass the relative motion if both move.
+ *
+ * @param start the center of the circle at the start of its motion
+ * @param displacement how far the circle's center moves
+ * @param radius the radius of the circle
+ * @param polygon the polygon, with its vertices in counterclockwise order
+ * @param collision set to the collision at the moment the shapes touch,
+ *   with depth 0 and an axis from the circle towards the polygon.
+ *   If the shapes overlap at the start, set to that collision instead.
+ * @return the fraction of displacement (between 0 and 1) the circle travels
+ *   before touching the polygon, 0 if they already overlap,
+ *   or INFINITY if they do not touch
+ */
+double find_circle_polygon_toi(vector_t start, vector_t displacement,
+                               double radius, polygon_t *polygon,
+                               collision_info_t *collision);
+
+/**
+ * Fills in the depth and contact points of a collision between two convex
+ * polygons, given its axis. The contacts are found by clipping the edge of
+ * one shape that faces the collision against the sides of the other
+ * shape's facing edge.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param collision a collision between the shapes, whose axis points from
+ *   shape1 towards shape2
+ */
+void find_polygon_contacts(polygon_t *shape1, polygon_t *shape2,
+                           collision_info_t *collision);
+
 /**
  * Computes the status of the collision between two convex polygons.
+ * List-based version of find_polygon_collision().
  * The shapes are given as lists of vertices in counterclockwise order.
  * There is an edge between each pair of consecutive vertices,
  * and one between the first vertex and the last vertex.
@@ -34,4 +250,10 @@ typedef struct {
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Returns whether two axis-aligned bounding boxes overlap.
+ * Boxes that only touch along an edge are considered overlapping.
+ */
+bool aabb_overlaps(aabb_t box1, aabb_t box2);
+
 #endif // #ifndef __COLLISION_H__
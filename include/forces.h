@@ -3,17 +3,6 @@
 
 #include "scene.h"
 
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- */
-typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
-                                    void *aux);
-
 /**
  * Adds a force creator to a scene that applies gravity between two bodies.
  * The force creator will be called each tick
@@ -58,8 +47,8 @@ void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2);
 void create_drag(scene_t *scene, double gamma, body_t *body);
 
 /**
- * Adds a force creator to a scene that calls a given collision handler
- * function each time two bodies collide.
+ * Registers a collision handler with a scene (see scene_add_collision())
+ * that is called each time two bodies collide.
  * This generalizes create_destructive_collision() from last week,
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
@@ -103,6 +92,21 @@ void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 void create_bullet_tank_collision(scene_t *scene, body_t *tank, body_t *bullet,
                                   size_t *health, bool *was_shot);
 
+/**
+ * Like create_bullet_tank_collision(), but registered once as a rule between
+ * all tanks of one type and all bullets of another type
+ * (see scene_add_collision_rule()).
+ *
+ * @param scene the scene containing the bodies
+ * @param tank_type the type of the tanks the bullets damage
+ * @param bullet_type the type of the bullets
+ * @param health a pointer to the tank's health
+ * @param was_shot a bool pointer to the tank's was_shot
+ */
+void create_bullet_tank_collision_rule(scene_t *scene, const char *tank_type,
+                                       const char *bullet_type, size_t *health,
+                                       bool *was_shot);
+
 /**
  * Adds a force creator to a scene that destroys a bullet when it collides with
  * an obstacle The bullet should be destroyed by calling body_remove(). This
@@ -116,16 +120,26 @@ void create_bullet_tank_collision(scene_t *scene, body_t *tank, body_t *bullet,
 void create_bullet_obstacle_collision(scene_t *scene, body_t *tank,
                                       body_t *bullet);
 
+/**
+ * Like create_bullet_obstacle_collision(), but registered once as a rule
+ * between all obstacles and bullets of the given types.
+ *
+ * @param scene the scene containing the bodies
+ * @param obstacle_type the type of the obstacles
+ * @param bullet_type the type of the bullets
+ */
+void create_bullet_obstacle_collision_rule(scene_t *scene,
+                                           const char *obstacle_type,
+                                           const char *bullet_type);
+
 /**
  * Adds a force creator to a scene that applies impulses
  * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
- *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * This is represented as a contact handler (see scene_add_contact())
+ * that adds the bodies to the scene's contact solver every tick they overlap
+ * (see scene_add_solver_contact()), so contacts between several bodies
+ * are resolved together. Either body1 or body2 may have mass INFINITY,
+ * as this is useful for simulating walls.
  *
  * @param scene the scene containing the bodies
  * @param elasticity the "coefficient of restitution" of the collision;
@@ -136,13 +150,49 @@ void create_bullet_obstacle_collision(scene_t *scene, body_t *tank,
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
                               body_t *body2);
 
+/**
+ * Like create_physics_collision(), but registered once as a rule between
+ * all bodies of the given types, so each pair of types has one material.
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of the collision
+ * @param type1 the type of the first bodies
+ * @param type2 the type of the second bodies
+ */
+void create_physics_collision_rule(scene_t *scene, double elasticity,
+                                   const char *type1, const char *type2);
+
 void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                const double *elasticity);
 
+/**
+ * Bounces a bullet off a wall like physics_collision_handler(),
+ * removing it after too many bounces.
+ * Does nothing if the bullet is already moving away from the wall.
+ *
+ * @param bullet the bullet, whose info points to its bounce count (a size_t)
+ * @param wall the wall
+ * @param axis the collision axis, from the bullet towards the wall
+ * @param elasticity the "coefficient of restitution" of the bounce
+ */
 void bullet_collision_handler(body_t *bullet, body_t *wall, vector_t axis,
                                const double *elasticity);
 
 void create_bullet_wall_collision(scene_t *scene, double elasticity, body_t *bullet,
                               body_t *wall);
 
+/**
+ * Registers bullet_collision_handler() as a rule between all bullets
+ * and walls of the given types.
+ * Each bullet's info must point to its bounce count (a size_t).
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of the bounce
+ * @param bullet_type the type of the bullets
+ * @param wall_type the type of the walls
+ */
+void create_bullet_wall_collision_rule(scene_t *scene, double elasticity,
+                                       const char *bullet_type,
+                                       const char *wall_type);
+
 #endif // #ifndef __FORCES_H__
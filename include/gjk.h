@@ -0,0 +1,52 @@
+#ifndef __GJK_H__
+#define __GJK_H__
+
+#include "collision.h"
+#include "polygon.h"
+#include <stddef.h>
+
+/**
+ * The simplex GJK ended with the last time it tested a pair of shapes.
+ * Each simplex vertex is stored as the indices of the vertices of the two
+ * shapes it came from, so it is still meaningful after the shapes move.
+ * Starting from it usually takes GJK only an iteration or two.
+ * Zero-initialize the simplex before the first test.
+ */
+typedef struct {
+  /** The number of vertices in the simplex, or 0 if there is none */
+  size_t size;
+  size_t indices1[3];
+  size_t indices2[3];
+} gjk_simplex_t;
+
+/**
+ * Computes the status of the collision between two convex polygons
+ * using GJK, and if they collide, finds the collision axis using EPA.
+ * Takes time roughly linear in the number of vertices,
+ * unlike find_polygon_collision(), which is quadratic.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * penetration depth, and contact points (see collision_info_t).
+ * The axis is a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_gjk_collision(polygon_t *shape1, polygon_t *shape2);
+
+/**
+ * Acts like find_gjk_collision(), but starts GJK from the simplex
+ * it ended with the last time the same pair of shapes was tested.
+ * Pass the same cache each time the same pair of shapes is tested,
+ * with the shapes in the same order.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param simplex_cache the simplex to start from, updated with the simplex
+ *   GJK ended with. If NULL, acts like find_gjk_collision().
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+collision_info_t find_gjk_collision_cached(polygon_t *shape1,
+                                          polygon_t *shape2,
+                                          gjk_simplex_t *simplex_cache);
+
+#endif // #ifndef __GJK_H__
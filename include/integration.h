@@ -0,0 +1,105 @@
+#ifndef __INTEGRATION_H__
+#define __INTEGRATION_H__
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * How a tick moves a body, given its velocities before and after the tick.
+ * Either way, the velocity changes by the forces and impulses applied
+ * during the tick.
+ */
+typedef enum {
+  // translates the body at the average of the two velocities,
+  // which is velocity Verlet when the forces are constant over the tick
+  INTEGRATOR_VERLET,
+  // translates the body at its new velocity (semi-implicit Euler),
+  // which is cheaper to predict and damps stiff springs
+  INTEGRATOR_SEMI_IMPLICIT_EULER
+} integrator_t;
+
+/**
+ * The physics state of many bodies, as parallel arrays indexed by slot
+ * (see struct body_store). Only the active bodies are integrated.
+ */
+typedef struct {
+  size_t size;
+  const double *mass;
+  vector_t *vel;
+  vector_t *pos;
+  const double *angular_vel;
+  double *angle;
+  vector_t *net_force;
+  vector_t *net_impulse;
+  const bool *active;
+  // set for each active body that moved; never cleared
+  bool *moved;
+} integration_batch_t;
+
+/**
+ * The implementations of integrate_batch().
+ * They all compute exactly the same state;
+ * the vectorized ones just process several bodies per instruction.
+ */
+typedef enum {
+  /** One body at a time; available everywhere */
+  INTEGRATION_SCALAR,
+  /** One body's x and y at a time; available when compiled for SSE2 */
+  INTEGRATION_SSE2,
+  /** Two bodies' x and y at a time; available on x86-64 CPUs with AVX2 */
+  INTEGRATION_AVX2,
+} integration_impl_t;
+
+/**
+ * Checks whether an implementation of integrate_batch() can run on this
+ * machine.
+ *
+ * @param impl the implementation to check
+ * @return whether it was compiled in and the CPU supports it
+ */
+bool integration_impl_supported(integration_impl_t impl);
+
+/**
+ * Gets the implementation integrate_batch() currently uses.
+ * This is the fastest supported one, unless integration_set_impl() was called.
+ *
+ * @return the current implementation
+ */
+integration_impl_t integration_get_impl(void);
+
+/**
+ * Forces integrate_batch() to use a particular implementation,
+ * e.g. to compare implementations in tests.
+ * Asserts that the implementation is supported.
+ *
+ * @param impl the implementation to use
+ */
+void integration_set_impl(integration_impl_t impl);
+
+/**
+ * Gets how far a body moves over a tick.
+ *
+ * @param integrator how the body is moved
+ * @param vel the body's velocity before the tick
+ * @param new_vel the body's velocity after the tick
+ * @param dt the length of the tick, in seconds
+ * @return the body's displacement over the tick
+ */
+vector_t integrator_displacement(integrator_t integrator, vector_t vel,
+                                 vector_t new_vel, double dt);
+
+/**
+ * Ticks every active body in a batch, like body_tick():
+ * updates its velocity from the forces and impulses on it,
+ * moves it as the integrator says, turns it by its angular velocity,
+ * and resets its forces and impulses. Inactive bodies are left untouched.
+ *
+ * @param batch the bodies' state
+ * @param integrator how to move the bodies
+ * @param dt the length of the tick, in seconds
+ */
+void integrate_batch(integration_batch_t *batch, integrator_t integrator,
+                     double dt);
+
+#endif // #ifndef __INTEGRATION_H__
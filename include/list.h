@@ -54,6 +54,18 @@ size_t list_size(list_t *list);
  */
 void *list_get(list_t *list, size_t index);
 
+/**
+ * Replaces the element at a given index in a list.
+ * Asserts that the index is valid and that the new value is non-NULL.
+ * The old element is not freed.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param index an index in the list (the first element is at 0)
+ * @param value the new element
+ * @return the element previously at the given index
+ */
+void *list_set(list_t *list, size_t index, void *value);
+
 /**
  * Removes the element at a given index in a list and returns it,
  * moving all subsequent elements towards the start of the list.
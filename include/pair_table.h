@@ -0,0 +1,70 @@
+#ifndef __PAIR_TABLE_H__
+#define __PAIR_TABLE_H__
+
+#include <stddef.h>
+
+/**
+ * A hash table keyed on an unordered pair of pointers, e.g. two bodies.
+ * (key1, key2) and (key2, key1) refer to the same entry.
+ * The table does not own its keys or values.
+ */
+typedef struct pair_table pair_table_t;
+
+/**
+ * Allocates memory for an empty pair table.
+ *
+ * @param initial_size the number of entries to allocate space for
+ * @return a pointer to the newly allocated table
+ */
+pair_table_t *pair_table_init(size_t initial_size);
+
+/**
+ * Releases the memory allocated for a pair table.
+ * Does not free the values stored in it.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ */
+void pair_table_free(pair_table_t *table);
+
+/**
+ * Gets the number of entries in a pair table.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @return the number of pairs stored in the table
+ */
+size_t pair_table_size(pair_table_t *table);
+
+/**
+ * Looks up the value stored for a pair of keys.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param key1 the first key
+ * @param key2 the second key
+ * @return the value stored for the pair, or NULL if there is none
+ */
+void *pair_table_get(pair_table_t *table, const void *key1, const void *key2);
+
+/**
+ * Stores a value for a pair of keys, replacing any previous value.
+ * Asserts that the keys and the value are non-NULL.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param key1 the first key
+ * @param key2 the second key
+ * @param value the value to store
+ */
+void pair_table_put(pair_table_t *table, const void *key1, const void *key2,
+                    void *value);
+
+/**
+ * Removes the entry for a pair of keys.
+ *
+ * @param table a pointer to a table returned from pair_table_init()
+ * @param key1 the first key
+ * @param key2 the second key
+ * @return the value that was stored for the pair, or NULL if there was none
+ */
+void *pair_table_remove(pair_table_t *table, const void *key1,
+                        const void *key2);
+
+#endif // #ifndef __PAIR_TABLE_H__
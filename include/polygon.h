@@ -4,9 +4,130 @@
 #include "list.h"
 #include "vector.h"
 
+/**
+ * A polygon whose vertices are stored in one contiguous array,
+ * listed in a counterclockwise direction. There is an edge between
+ * each pair of consecutive vertices, plus one between the first and last.
+ * Prefer this over a list of vectors in hot loops,
+ * since reading a vertex does not chase a pointer.
+ */
+typedef struct {
+  size_t size;
+  vector_t *vertices;
+} polygon_t;
+
+/**
+ * Allocates memory for a polygon with the given number of vertices.
+ * The vertices are uninitialized.
+ * Asserts that the required memory was allocated.
+ *
+ * @param size the number of vertices
+ * @return a pointer to the newly allocated polygon
+ */
+polygon_t *poly_init(size_t size);
+
+/**
+ * Releases the memory allocated for a polygon.
+ *
+ * @param polygon a pointer to a polygon returned from poly_init()
+ */
+void poly_free(polygon_t *polygon);
+
+/**
+ * Allocates a copy of a polygon.
+ *
+ * @param polygon the polygon to copy
+ * @return a pointer to the newly allocated polygon
+ */
+polygon_t *poly_copy(polygon_t *polygon);
+
+/**
+ * Allocates a polygon with the same vertices as a list of vectors.
+ * Does not free the list.
+ *
+ * @param list a list of vector_t pointers
+ * @return a pointer to the newly allocated polygon
+ */
+polygon_t *poly_from_list(list_t *list);
+
+/**
+ * The most vertices poly_from_list_buffer() copies without allocating.
+ */
+#define POLY_BUFFER_SIZE 32
+
+/**
+ * Makes a polygon with the same vertices as a list of vectors,
+ * storing them in a caller's buffer (e.g. on the stack) if they fit,
+ * so short-lived conversions don't allocate.
+ * Longer lists are copied into newly allocated memory.
+ * Either way, release the polygon with poly_release_buffer().
+ *
+ * @param list a list of vector_t pointers
+ * @param buffer an array of POLY_BUFFER_SIZE vectors
+ * @return a polygon whose vertices are in buffer or on the heap
+ */
+polygon_t poly_from_list_buffer(list_t *list, vector_t *buffer);
+
+/**
+ * Releases a polygon made by poly_from_list_buffer(),
+ * freeing its vertices unless they are in the buffer.
+ *
+ * @param polygon a polygon returned from poly_from_list_buffer()
+ * @param buffer the buffer passed to poly_from_list_buffer()
+ */
+void poly_release_buffer(polygon_t *polygon, vector_t *buffer);
+
+/**
+ * Allocates a list of vectors with the same vertices as a polygon.
+ * The list owns its vectors and must be list_free()d.
+ *
+ * @param polygon the polygon to copy
+ * @return a pointer to the newly allocated list
+ */
+list_t *poly_to_list(polygon_t *polygon);
+
+/**
+ * Computes the area of a polygon.
+ * See https://en.wikipedia.org/wiki/Shoelace_formula#Statement.
+ *
+ * @param polygon the polygon
+ * @return the area of the polygon
+ */
+double poly_area(polygon_t *polygon);
+
+/**
+ * Computes the center of mass of a polygon.
+ * See https://en.wikipedia.org/wiki/Centroid#Of_a_polygon.
+ *
+ * @param polygon the polygon
+ * @return the centroid of the polygon
+ */
+vector_t poly_centroid(polygon_t *polygon);
+
+/**
+ * Translates all vertices in a polygon by a given vector.
+ * Note: mutates the original polygon.
+ *
+ * @param polygon the polygon
+ * @param translation the vector to add to each vertex's position
+ */
+void poly_translate(polygon_t *polygon, vector_t translation);
+
+/**
+ * Rotates vertices in a polygon by a given angle about a given point.
+ * Note: mutates the original polygon.
+ *
+ * @param polygon the polygon
+ * @param angle the angle to rotate the polygon, in radians.
+ * A positive angle means counterclockwise.
+ * @param point the point to rotate around
+ */
+void poly_rotate(polygon_t *polygon, double angle, vector_t point);
+
 /**
  * Computes the area of a polygon.
  * See https://en.wikipedia.org/wiki/Shoelace_formula#Statement.
+ * List-based version of poly_area().
  *
  * @param polygon the list of vertices that make up the polygon,
  * listed in a counterclockwise direction. There is an edge between
@@ -18,6 +139,7 @@ double polygon_area(list_t *polygon);
 /**
  * Computes the center of mass of a polygon.
  * See https://en.wikipedia.org/wiki/Centroid#Of_a_polygon.
+ * List-based version of poly_centroid().
  *
  * @param polygon the list of vertices that make up the polygon,
  * listed in a counterclockwise direction. There is an edge between
@@ -29,6 +151,7 @@ vector_t polygon_centroid(list_t *polygon);
 /**
  * Translates all vertices in a polygon by a given vector.
  * Note: mutates the original polygon.
+ * List-based version of poly_translate().
  *
  * @param polygon the list of vertices that make up the polygon
  * @param translation the vector to add to each vertex's position
@@ -38,6 +161,7 @@ void polygon_translate(list_t *polygon, vector_t translation);
 /**
  * Rotates vertices in a polygon by a given angle about a given point.
  * Note: mutates the original polygon.
+ * List-based version of poly_rotate().
  *
  * @param polygon the list of vertices that make up the polygon
  * @param angle the angle to rotate the polygon, in radians.
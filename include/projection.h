@@ -0,0 +1,69 @@
+#ifndef __PROJECTION_H__
+#define __PROJECTION_H__
+
+#include "polygon.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The interval a shape covers when projected onto an axis.
+ */
+typedef struct {
+  double min;
+  double max;
+} projection_range_t;
+
+/**
+ * The implementations of poly_project().
+ * They all compute exactly the same ranges;
+ * the vectorized ones just process several vertices per instruction.
+ */
+typedef enum {
+  /** One vertex at a time; available everywhere */
+  PROJECTION_SCALAR,
+  /** Two vertices at a time; available when compiled for SSE2 */
+  PROJECTION_SSE2,
+  /** Four vertices at a time; available on x86-64 CPUs with AVX2 */
+  PROJECTION_AVX2,
+} projection_impl_t;
+
+/**
+ * Checks whether an implementation of poly_project() can run on this machine.
+ *
+ * @param impl the implementation to check
+ * @return whether it was compiled in and the CPU supports it
+ */
+bool projection_impl_supported(projection_impl_t impl);
+
+/**
+ * Gets the implementation poly_project() currently uses.
+ * This is the fastest supported one, unless projection_set_impl() was called.
+ *
+ * @return the current implementation
+ */
+projection_impl_t projection_get_impl(void);
+
+/**
+ * Forces poly_project() to use a particular implementation,
+ * e.g. to compare implementations in tests.
+ * Asserts that the implementation is supported.
+ *
+ * @param impl the implementation to use
+ */
+void projection_set_impl(projection_impl_t impl);
+
+/**
+ * Projects a polygon onto several axes in a single pass over its vertices.
+ * Projecting onto a batch of axes at once reads each vertex only once,
+ * which is cheaper than projecting onto each axis separately.
+ *
+ * @param polygon the polygon to project
+ * @param axes the axes to project onto
+ * @param num_axes the number of axes
+ * @param ranges set to the range of the polygon's projection onto each axis
+ */
+void poly_project(polygon_t *polygon, const vector_t *axes, size_t num_axes,
+                  projection_range_t *ranges);
+
+#endif // #ifndef __PROJECTION_H__
@@ -4,6 +4,7 @@
 #include "body.h"
 #include "list.h"
 #include "image.h"
+#include <stdint.h>
 
 typedef struct {
   const char *text;
@@ -32,6 +33,72 @@ typedef struct scene scene_t;
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision()
+ * @param body2 the second body passed to create_collision()
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value passed to create_collision()
+ */
+typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                                    void *aux);
+
+/**
+ * A function called every tick while two bodies are colliding.
+ * @param body1 the first body passed to scene_add_contact()
+ * @param body2 the second body passed to scene_add_contact()
+ * @param collision the collision between the bodies;
+ *   its axis points from body1 towards body2
+ * @param aux the auxiliary value passed to scene_add_contact()
+ */
+typedef void (*contact_handler_t)(body_t *body1, body_t *body2,
+                                  const collision_info_t *collision, void *aux);
+
+/**
+ * A function called with each body found by a scene query.
+ * It may remove bodies, but must not add any to the scene.
+ * @param body a body matching the query
+ * @param aux the auxiliary value passed to the query
+ */
+typedef void (*scene_query_func_t)(body_t *body, void *aux);
+
+/**
+ * The first body hit by a ray or shape cast through a scene.
+ */
+typedef struct {
+  // the body that was hit, or NULL if nothing was
+  body_t *body;
+  // how far the cast travelled before the hit
+  double distance;
+  // where the ray, or the surface of the cast circle, touches the body
+  vector_t point;
+  // a unit vector out of the body at point, facing back along the cast
+  vector_t normal;
+} scene_hit_t;
+
+/**
+ * The ways a scene can find the pairs of bodies that may be colliding.
+ */
+typedef enum {
+  /**
+   * A uniform grid (see spatial_hash.h), rebuilt every tick from the bodies
+   * that are moving. Best when bodies appear, vanish or jump around.
+   */
+  BROAD_PHASE_GRID,
+  /**
+   * Sweep and prune (see sweep_prune.h), which keeps the bodies' bounding
+   * boxes sorted between ticks. Best when most bodies move a little at a time.
+   */
+  BROAD_PHASE_SAP,
+  /**
+   * A dynamic AABB tree (see aabb_tree.h), updated as bodies are added,
+   * removed and moved. Best when body sizes are very uneven,
+   * like long walls next to small bullets.
+   */
+  BROAD_PHASE_TREE
+} broad_phase_t;
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -69,6 +136,9 @@ body_t *scene_get_body(scene_t *scene, size_t index);
 
 /**
  * Adds a body to a scene.
+ * Static bodies (see body_set_static()) are not ticked,
+ * and are kept in a broad phase that is only rebuilt when the set of
+ * static bodies changes.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param body a pointer to the body to add to the scene
@@ -86,6 +156,55 @@ void scene_add_body(scene_t *scene, body_t *body);
  */
 void scene_remove_body(scene_t *scene, size_t index);
 
+/**
+ * Gets the small integer id a scene uses for a body type, giving the type
+ * the next unused id the first time it is seen.
+ * Types are compared by pointer, like in collision rules.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type a body type, or NULL for untyped bodies (which have id 0)
+ * @return the type's id
+ */
+size_t scene_type_id(scene_t *scene, const char *type);
+
+/**
+ * Sets which collision layers a body type is on, and which layers it
+ * collides with. Two bodies are only checked for collisions if each one's
+ * layers overlap the other's mask, and this is tested before their shapes.
+ * Every type starts on layer 1 (the lowest bit), colliding with all layers.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type a body type, or NULL for untyped bodies
+ * @param layers a bitmask of the layers bodies of this type are on
+ * @param mask a bitmask of the layers bodies of this type collide with
+ */
+void scene_set_type_layers(scene_t *scene, const char *type, uint32_t layers,
+                           uint32_t mask);
+
+/**
+ * Gets the number of bodies of a given type in a scene.
+ * Like scene_bodies(), this counts bodies removed since the last tick.
+ * The scene keeps a list of the bodies of each type, so looping over them
+ * with scene_get_type_body() only visits bodies of that type.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type a body type, or NULL for untyped bodies
+ * @return the number of bodies of that type,
+ *   or 0 if the scene hasn't seen the type (which doesn't give it an id)
+ */
+size_t scene_type_bodies(scene_t *scene, const char *type);
+
+/**
+ * Gets a body of a given type in a scene, in the order they were added.
+ * Asserts that the index is valid, so the type must have bodies.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type a body type, or NULL for untyped bodies
+ * @param index the index of the body among those of its type (starting at 0)
+ * @return a pointer to the body at the given index
+ */
+body_t *scene_get_type_body(scene_t *scene, const char *type, size_t index);
+
 /**
  * @deprecated Use scene_add_bodies_force_creator() instead
  * so the scene knows which bodies the force creator depends on
@@ -112,10 +231,242 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies,
                                     free_func_t freer);
 
+/**
+ * Registers a collision handler between two bodies.
+ * Each tick, the scene's broad phase (see scene_set_broad_phase())
+ * finds the pairs of bodies that might be touching,
+ * and only those pairs are tested with body_collide().
+ * The handler is called once when the bodies start colliding,
+ * and not again until they have separated.
+ * If either body is fast (see body_set_fast()), the handler may be called
+ * just before the bodies would touch, with the fast body moved to the
+ * point of impact.
+ * The collision is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call whenever the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_collision(scene_t *scene, body_t *body1, body_t *body2,
+                         collision_handler_t handler, void *aux,
+                         free_func_t freer);
+
+/**
+ * Registers a collision handler between every body of one type
+ * and every body of another type (see body_init_with_info()).
+ * Types are compared by pointer, so use the same string constant
+ * for every body of a type.
+ * Unlike scene_add_collision(), this is done once for the whole scene,
+ * so adding a body to the scene does not register anything per pair.
+ * Several rules may be registered for the same pair of types;
+ * they are called in registration order.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type1 the type of the first body passed to the handler
+ * @param type2 the type of the second body passed to the handler
+ * @param handler a function to call whenever two such bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_collision_rule(scene_t *scene, const char *type1,
+                              const char *type2, collision_handler_t handler,
+                              void *aux, free_func_t freer);
+
+/**
+ * Registers a contact handler between two bodies.
+ * Unlike a collision handler, it is called every tick the bodies are
+ * colliding, with the penetration depth and contact points,
+ * so it can keep resolving a collision that lasts several ticks.
+ * It is also called when a fast body is swept into the other body
+ * (see body_set_fast()), with the bodies just touching, and the solver
+ * contacts it adds then are resolved before the fast body moves on,
+ * so e.g. create_physics_collision_rule() stops fast bodies too.
+ * The contact is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call every tick the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       contact_handler_t handler, void *aux, free_func_t freer);
+
+/**
+ * Registers a contact handler between every body of one type
+ * and every body of another type, like scene_add_collision_rule().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type1 the type of the first body passed to the handler
+ * @param type2 the type of the second body passed to the handler
+ * @param handler a function to call every tick two such bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_contact_rule(scene_t *scene, const char *type1,
+                            const char *type2, contact_handler_t handler,
+                            void *aux, free_func_t freer);
+
+/**
+ * Adds a pair of colliding bodies to the scene's contact solver for this tick.
+ * Call this from a contact handler (see scene_add_contact()) instead of
+ * applying impulses to the bodies directly. Once every pair has been tested,
+ * the solver resolves all the contacts of the tick together, going over them
+ * several times so that chains of contacts (e.g. a body pushing another into
+ * a wall) settle. While two bodies stay in contact, the impulse found between
+ * them is the solver's starting guess the next tick.
+ * The solver then moves the bodies apart by most of their penetration depth.
+ * Contacts are split into islands, groups connected through bodies that
+ * can move, which are solved independently (see scene_set_solver_threads()).
+ * Asserts that the bodies were tested against each other this tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param collision the collision between the bodies,
+ *   with its axis pointing from body1 towards body2
+ * @param elasticity the "coefficient of restitution" of the collision;
+ * 0 is a perfectly inelastic collision and 1 is a perfectly elastic collision
+ */
+void scene_add_solver_contact(scene_t *scene, body_t *body1, body_t *body2,
+                              const collision_info_t *collision,
+                              double elasticity);
+
+/**
+ * Sets the number of times per tick the contact solver goes over
+ * every contact. More iterations settle chains of contacts better,
+ * but take longer. The default is 8. Asserts that iterations is positive.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of solver iterations per tick
+ */
+void scene_set_solver_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Sets the number of threads the contact solver spreads islands over,
+ * including the thread calling scene_tick(). Since islands share no bodies
+ * that can move, the results are exactly the same for any number of threads.
+ * The default is 1. Asserts that num_threads is positive.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param num_threads the number of threads to solve contacts on
+ */
+void scene_set_solver_threads(scene_t *scene, size_t num_threads);
+
+/**
+ * Lets bodies that have been nearly still for a while fall asleep
+ * (see body_sleep()). Sleeping bodies are not integrated or tested against
+ * each other, and force creators acting only on sleeping or static bodies
+ * are skipped, until a contact, force, or impulse wakes them up.
+ * Sleeping is off by default.
+ * Asserts that the thresholds are not negative.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param sleep_velocity the speed below which a body counts as still,
+ *   including the speed of its farthest point from rotating;
+ *   0 turns sleeping off
+ * @param sleep_time how long a body must stay still before it sleeps,
+ *   in seconds
+ */
+void scene_set_sleeping(scene_t *scene, double sleep_velocity,
+                        double sleep_time);
+
+/**
+ * Sets how the scene's bodies are moved at the end of each tick
+ * (see integrator_t). INTEGRATOR_VERLET is the default.
+ * Either way, every body is integrated in one pass over the scene's
+ * body store (see body_store_integrate()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param integrator the integrator to use from now on
+ */
+void scene_set_integrator(scene_t *scene, integrator_t integrator);
+
+/**
+ * Sets the side length of the cells in the scene's broad phase grid.
+ * Cells a little larger than a typical body work best.
+ * Asserts that the cell size is positive.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param cell_size the new cell side length
+ */
+void scene_set_grid_cell_size(scene_t *scene, double cell_size);
+
+/**
+ * Sets which broad phase the scene uses to find pairs of bodies
+ * that may be colliding. All broad phases (the grid, sweep and prune,
+ * and the AABB tree) find the same collisions.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param broad_phase the broad phase to use from now on
+ */
+void scene_set_broad_phase(scene_t *scene, broad_phase_t broad_phase);
+
+/**
+ * Chooses the algorithm used to test pairs of bodies involving a polygon
+ * (see collision_engine_t). Circles and pairs of boxes always use their own
+ * tests. The default is COLLISION_ENGINE_SAT.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param engine the engine to use for pairs without their own engine
+ */
+void scene_set_collision_engine(scene_t *scene, collision_engine_t engine);
+
+/**
+ * Chooses the algorithm used to test bodies of one type against bodies
+ * of another, overriding scene_set_collision_engine() for those pairs.
+ * E.g. GJK is faster for pairs of shapes with many vertices.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type1 the type of one body in the pair
+ * @param type2 the type of the other body in the pair
+ * @param engine the engine to use for such pairs
+ */
+void scene_set_type_collision_engine(scene_t *scene, const char *type1,
+                                     const char *type2,
+                                     collision_engine_t engine);
+
+/**
+ * Lets scene_tick() split a tick into shorter sub-steps when bodies are
+ * moving fast, as a cheaper way than body_set_fast() to keep them from
+ * passing through each other. The number of sub-steps is the fewest that
+ * keep every moving body from travelling more than max_travel times its
+ * smallest extent (the shorter side of its bounding box) per sub-step,
+ * at its speed at the start of the tick. Force creators, collisions,
+ * and the contact solver all run once per sub-step.
+ * Sub-stepping is off by default.
+ * Asserts that max_travel is not negative and max_substeps is positive.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param max_travel how far a body may move per sub-step, as a fraction
+ *   of its smallest extent; 0 turns sub-stepping off
+ * @param max_substeps the most sub-steps a tick is split into
+ */
+void scene_set_substepping(scene_t *scene, double max_travel,
+                           size_t max_substeps);
+
+/**
+ * Gets the number of sub-steps the last call to scene_tick() ran
+ * (see scene_set_substepping()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of sub-steps, which is 1 if sub-stepping is off,
+ *   or 0 if scene_tick() was never called
+ */
+size_t scene_get_substeps(scene_t *scene);
+
 /**
  * Executes a tick of a given scene over a small time interval.
- * This requires executing all the force creators
- * and then ticking each body (see body_tick()).
+ * This requires executing all the force creators,
+ * handling collisions between bodies,
+ * solving the contacts they added (see scene_add_solver_contact()),
+ * sweeping fast bodies along their paths (see body_set_fast()),
+ * and then ticking each body (see body_tick()),
+ * possibly several times over shorter sub-steps (see scene_set_substepping()).
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
@@ -130,4 +481,116 @@ void scene_draw_image(scene_t *scene, image_t *image, vector_t pos, double scale
 list_t *scene_get_images_to_draw(scene_t *scene);
 void scene_text_to_draw_free(text_to_draw_t *text_to_draw);
 
+/**
+ * Sets the tick rate scene_step_fixed() simulates at,
+ * and the most ticks one call may run to catch up after a slow frame.
+ * The defaults are 60 ticks per second and 5 ticks per call.
+ * Asserts that both are positive.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param tick_rate the number of ticks per second of simulated time
+ * @param max_steps the most ticks a call to scene_step_fixed() runs
+ */
+void scene_set_fixed_step(scene_t *scene, double tick_rate, size_t max_steps);
+
+/**
+ * Advances a scene by a frame of real time in ticks of a fixed length
+ * (see scene_set_fixed_step()), so the results do not depend on the frame
+ * rate and a slow frame cannot produce one huge tick.
+ * The frame time is added to an accumulator, and scene_tick() runs once
+ * for each whole tick accumulated, which may be zero times on a fast frame.
+ * Time beyond the catch-up limit is dropped, slowing the simulation down
+ * instead of falling further behind.
+ * Before each tick every body's transform is saved (see
+ * body_save_transform()), so a renderer can draw the bodies between their
+ * last two ticks (see scene_get_interpolation()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param frame_dt the real time elapsed since the last frame, in seconds
+ * @return the number of ticks run
+ */
+size_t scene_step_fixed(scene_t *scene, double frame_dt);
+
+/**
+ * Gets how far the real time is past the scene's last fixed tick,
+ * as a fraction of a tick. Renderers draw each body at this fraction
+ * of the way from its previous to its current transform
+ * (see body_get_interpolated_centroid()), hiding the difference between
+ * the tick rate and the frame rate. This lags the simulation by up to a tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return a fraction from 0 to 1, or 1 if scene_step_fixed() was never called
+ */
+double scene_get_interpolation(scene_t *scene);
+
+/*
+ * Spatial queries use the scene's broad phase (see scene_set_broad_phase()),
+ * so they only test the bodies near the query. Between ticks, they see the
+ * bodies where they are now; only the bodies moved, added, removed, or woken
+ * since the last query or tick are refreshed, so moving a body and querying
+ * again (e.g. to find it a free spot) stays cheap. From a collision
+ * handler, they see the bodies where they were when the tick started
+ * checking for collisions.
+ * Removed bodies are never found, and a non-NULL type limits a query to
+ * bodies of that type (compared by pointer, like collision rules).
+ */
+
+/**
+ * Calls a function with each body whose bounding box overlaps a box.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param bounds the box to look for bodies in
+ * @param type if non-NULL, the type of bodies to find
+ * @param func the function to call with each body found
+ * @param aux an auxiliary value to pass to func
+ */
+void scene_query_aabb(scene_t *scene, aabb_t bounds, const char *type,
+                      scene_query_func_t func, void *aux);
+
+/**
+ * Calls a function with each body whose shape comes within a distance of
+ * a point.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param center the point to look for bodies around
+ * @param radius how far from center to look
+ * @param type if non-NULL, the type of bodies to find
+ * @param func the function to call with each body found
+ * @param aux an auxiliary value to pass to func
+ */
+void scene_query_radius(scene_t *scene, vector_t center, double radius,
+                        const char *type, scene_query_func_t func, void *aux);
+
+/**
+ * Finds the first body a ray hits, e.g. to check for a line of sight.
+ * A body the ray starts inside is hit at distance 0.
+ * Asserts that the direction is non-zero and the distance is finite.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param start where the ray starts
+ * @param direction the direction of the ray (need not be a unit vector)
+ * @param max_distance how far along the ray to look
+ * @param type if non-NULL, the type of bodies the ray can hit
+ * @return the first hit, whose body is NULL if the ray hit nothing
+ */
+scene_hit_t scene_raycast(scene_t *scene, vector_t start, vector_t direction,
+                          double max_distance, const char *type);
+
+/**
+ * Finds the first body a moving circle hits, e.g. to check whether a bullet
+ * or a tank fits through a gap. Like scene_raycast(), but for a ray with
+ * a thickness.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param start where the circle's center starts
+ * @param radius the radius of the circle
+ * @param direction the direction the circle moves (need not be a unit vector)
+ * @param max_distance how far the circle moves
+ * @param type if non-NULL, the type of bodies the circle can hit
+ * @return the first hit, whose body is NULL if the circle hit nothing
+ */
+scene_hit_t scene_shape_cast(scene_t *scene, vector_t start, double radius,
+                             vector_t direction, double max_distance,
+                             const char *type);
+
 #endif // #ifndef __SCENE_H__
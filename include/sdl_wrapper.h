@@ -3,6 +3,7 @@
 
 #include "color.h"
 #include "list.h"
+#include "polygon.h"
 #include "scene.h"
 #include "vector.h"
 #include <stdbool.h>
@@ -61,12 +62,12 @@ bool sdl_is_done(void);
 void sdl_clear(void);
 
 /**
- * Draws a polygon from the given list of vertices and a color.
+ * Draws a polygon with a given color.
  *
- * @param points the list of vertices of the polygon
+ * @param polygon the polygon to draw
  * @param color the color used to fill in the polygon
  */
-void sdl_draw_polygon(list_t *points, rgb_color_t color);
+void sdl_draw_polygon(polygon_t *polygon, rgb_color_t color);
 
 /**
  * Displays the rendered frame on the SDL window.
@@ -0,0 +1,95 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include "collision.h"
+#include <stddef.h>
+
+/**
+ * A uniform grid of square cells, used as a broad phase for collisions.
+ * Each item is stored in every cell its bounding box overlaps,
+ * so only items sharing a cell need to be tested against each other.
+ * The grid is unbounded: cells are keyed on their integer coordinates
+ * and only cells containing items take up memory.
+ */
+typedef struct spatial_hash spatial_hash_t;
+
+/**
+ * A function called with each pair of items whose bounding boxes overlap.
+ * The items are passed in the order they were inserted.
+ */
+typedef void (*spatial_pair_func_t)(void *item1, void *item2, void *aux);
+
+/**
+ * A function called with each item whose bounding box overlaps a query box.
+ */
+typedef void (*spatial_query_func_t)(void *item, void *aux);
+
+/**
+ * Allocates memory for an empty spatial hash.
+ * Asserts that the cell size is positive.
+ *
+ * @param cell_size the side length of each grid cell.
+ *   Works best when it is a little larger than a typical item.
+ * @return a pointer to the newly allocated spatial hash
+ */
+spatial_hash_t *spatial_hash_init(double cell_size);
+
+/**
+ * Releases the memory allocated for a spatial hash.
+ * Does not free the items stored in it.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_free(spatial_hash_t *hash);
+
+/**
+ * Removes all items from a spatial hash, keeping its allocated memory.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_clear(spatial_hash_t *hash);
+
+/**
+ * Gets the number of items in a spatial hash.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @return the number of items inserted since the last clear
+ */
+size_t spatial_hash_size(spatial_hash_t *hash);
+
+/**
+ * Adds an item to every cell overlapped by its bounding box.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param item the item to store (not owned by the spatial hash)
+ * @param bounds the bounding box of the item
+ */
+void spatial_hash_insert(spatial_hash_t *hash, void *item, aabb_t bounds);
+
+/**
+ * Calls a function once for every pair of items with overlapping bounds.
+ * Pairs are reported in a deterministic order, which only depends on
+ * the order and bounds of the inserted items.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param func the function to call with each candidate pair
+ * @param aux an auxiliary value to pass to func
+ */
+void spatial_hash_find_pairs(spatial_hash_t *hash, spatial_pair_func_t func,
+                             void *aux);
+
+/**
+ * Calls a function once for every item whose bounds overlap a given box.
+ * Items are reported in a deterministic order, like spatial_hash_find_pairs().
+ * Querying a hash that is not modified in between is cheap,
+ * so a hash of items that never move can be built once and reused.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param bounds the box to look for items in
+ * @param func the function to call with each overlapping item
+ * @param aux an auxiliary value to pass to func
+ */
+void spatial_hash_query(spatial_hash_t *hash, aabb_t bounds,
+                        spatial_query_func_t func, void *aux);
+
+#endif // #ifndef __SPATIAL_HASH_H__
@@ -0,0 +1,120 @@
+#ifndef __SWEEP_PRUNE_H__
+#define __SWEEP_PRUNE_H__
+
+#include "collision.h"
+#include <stddef.h>
+
+/**
+ * A sweep and prune broad phase for collisions.
+ * The ends of every item's bounding box are kept sorted along each axis
+ * between updates, so when items move only a little, re-sorting them with
+ * insertion sort takes close to linear time. Each swap of two ends is where
+ * a pair of boxes can start or stop overlapping, so the set of overlapping
+ * pairs is updated from those swaps instead of being found from scratch.
+ */
+typedef struct sweep_prune sweep_prune_t;
+
+/**
+ * A function called with a pair of items.
+ * The items are passed in the order their proxies were created.
+ */
+typedef void (*sweep_pair_func_t)(void *item1, void *item2, void *aux);
+
+/**
+ * A function called with each item whose bounding box overlaps a query box.
+ */
+typedef void (*sweep_query_func_t)(void *item, void *aux);
+
+/**
+ * Allocates memory for an empty sweep and prune broad phase.
+ *
+ * @return a pointer to the newly allocated broad phase
+ */
+sweep_prune_t *sweep_prune_init(void);
+
+/**
+ * Releases the memory allocated for a sweep and prune broad phase.
+ * Does not free the items stored in it.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ */
+void sweep_prune_free(sweep_prune_t *sap);
+
+/**
+ * Gets the number of items in a sweep and prune broad phase.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @return the number of items inserted and not removed
+ */
+size_t sweep_prune_size(sweep_prune_t *sap);
+
+/**
+ * Adds an item to a sweep and prune broad phase.
+ * Its pairs are found by the next call to sweep_prune_update_pairs().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param item the item to store (not owned by the broad phase)
+ * @param bounds the bounding box of the item
+ * @return the item's proxy, which identifies it in later calls
+ */
+size_t sweep_prune_insert(sweep_prune_t *sap, void *item, aabb_t bounds);
+
+/**
+ * Changes the bounding box of an item.
+ * Its pairs are updated by the next call to sweep_prune_update_pairs().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param proxy the proxy returned when the item was inserted
+ * @param bounds the new bounding box of the item
+ */
+void sweep_prune_update(sweep_prune_t *sap, size_t proxy, aabb_t bounds);
+
+/**
+ * Removes an item, along with every pair it is in, without reporting them.
+ * The proxy may be reused by a later insertion.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param proxy the proxy returned when the item was inserted
+ */
+void sweep_prune_remove(sweep_prune_t *sap, size_t proxy);
+
+/**
+ * Re-sorts the ends of the items' bounding boxes after insertions and
+ * updates, and reports the pairs of items whose boxes started or stopped
+ * overlapping since the last call.
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param added if non-NULL, called with each pair that started overlapping
+ * @param removed if non-NULL, called with each pair that stopped overlapping
+ * @param aux an auxiliary value to pass to added and removed
+ */
+void sweep_prune_update_pairs(sweep_prune_t *sap, sweep_pair_func_t added,
+                              sweep_pair_func_t removed, void *aux);
+
+/**
+ * Calls a function once for every pair of items whose bounding boxes
+ * overlapped at the last call to sweep_prune_update_pairs().
+ * Boxes that only touch count as overlapping, as in aabb_overlaps().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param func the function to call with each pair
+ * @param aux an auxiliary value to pass to func
+ */
+void sweep_prune_find_pairs(sweep_prune_t *sap, sweep_pair_func_t func,
+                            void *aux);
+
+/**
+ * Calls a function once for every item whose current bounds overlap a box.
+ * Only scans the items that can overlap it along the x axis
+ * if the ends are sorted, i.e. there have been no insertions or updates
+ * since the last call to sweep_prune_update_pairs().
+ *
+ * @param sap a pointer to a broad phase returned from sweep_prune_init()
+ * @param bounds the box to look for items in
+ * @param func the function to call with each overlapping item
+ * @param aux an auxiliary value to pass to func
+ */
+void sweep_prune_query(sweep_prune_t *sap, aabb_t bounds,
+                       sweep_query_func_t func, void *aux);
+
+#endif // #ifndef __SWEEP_PRUNE_H__
@@ -0,0 +1,64 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stddef.h>
+
+/**
+ * A fixed set of worker threads that run batches of independent jobs.
+ * The thread that submits a batch also runs jobs from it,
+ * so a pool with no worker threads runs every job on the calling thread.
+ * Builds without thread support (e.g. emscripten without pthreads)
+ * never start any worker threads.
+ */
+typedef struct thread_pool thread_pool_t;
+
+/**
+ * A function that runs one job of a batch.
+ * Jobs in the same batch may run at the same time on different threads,
+ * so they must not write to anything another job reads or writes.
+ *
+ * @param aux the auxiliary value passed to thread_pool_run()
+ * @param index the index of the job in the batch
+ */
+typedef void (*thread_pool_job_t)(void *aux, size_t index);
+
+/**
+ * Allocates memory for a thread pool and starts its worker threads.
+ * Asserts that the required memory is allocated and the threads started.
+ *
+ * @param num_workers the number of threads to start besides the caller's
+ * @return a pointer to the newly allocated thread pool
+ */
+thread_pool_t *thread_pool_init(size_t num_workers);
+
+/**
+ * Stops the worker threads of a thread pool and releases its memory.
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ */
+void thread_pool_free(thread_pool_t *pool);
+
+/**
+ * Gets the number of worker threads a thread pool started.
+ * This may be fewer than requested if threads are not supported.
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ * @return the number of worker threads
+ */
+size_t thread_pool_workers(thread_pool_t *pool);
+
+/**
+ * Runs a batch of jobs on the pool's threads and the calling thread,
+ * returning once all of them have finished.
+ * Jobs are handed out in index order, but may finish in any order.
+ *
+ * @param pool a pointer to a thread pool returned from thread_pool_init()
+ * @param job the function to call for each job
+ * @param aux an auxiliary value to pass to every job
+ * @param num_jobs the number of jobs; job is called with indices
+ *   0 to num_jobs - 1
+ */
+void thread_pool_run(thread_pool_t *pool, thread_pool_job_t job, void *aux,
+                     size_t num_jobs);
+
+#endif // #ifndef __THREAD_POOL_H__
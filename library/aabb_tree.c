@@ -0,0 +1,344 @@
+#include <aabb_tree.h>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <util.h>
+
+static const size_t INITIAL_CAPACITY = 64;
+static const size_t GROWTH_FACTOR = 2;
+static const size_t NULL_NODE = SIZE_MAX;
+
+typedef struct {
+  // for leaves, the item's bounds grown by the margin;
+  // for internal nodes, the union of the children's bounds
+  aabb_t bounds;
+  // NULL for internal nodes
+  void *item;
+  // the next free node, for nodes that are not in use
+  size_t parent;
+  size_t child1;
+  size_t child2;
+  // 0 for leaves, and -1 for nodes that are not in use
+  int height;
+} node_t;
+
+struct aabb_tree {
+  node_t *nodes;
+  size_t capacity;
+  size_t free_list;
+  size_t root;
+  double margin;
+  size_t size;
+  // scratch space for queries
+  size_t *stack;
+  size_t stack_capacity;
+};
+
+static aabb_t aabb_union(aabb_t box1, aabb_t box2) {
+  return (aabb_t){{fmin(box1.min.x, box2.min.x), fmin(box1.min.y, box2.min.y)},
+                  {fmax(box1.max.x, box2.max.x), fmax(box1.max.y, box2.max.y)}};
+}
+
+static bool aabb_contains(aabb_t outer, aabb_t inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+// the cost of a box in the tree, proportional to how often queries hit it
+static double aabb_perimeter(aabb_t box) {
+  return 2 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
+
+static bool is_leaf(node_t *node) { return node->child1 == NULL_NODE; }
+
+// adds the nodes from start to capacity to the free list
+static void link_free_nodes(aabb_tree_t *tree, size_t start) {
+  for (size_t i = start; i < tree->capacity; i++) {
+    tree->nodes[i].parent = i + 1 < tree->capacity ? i + 1 : NULL_NODE;
+    tree->nodes[i].height = -1;
+  }
+  tree->free_list = start;
+}
+
+aabb_tree_t *aabb_tree_init(double margin) {
+  assert(margin >= 0);
+  aabb_tree_t *tree = malloc_safe(sizeof(aabb_tree_t));
+  tree->nodes = malloc_safe(INITIAL_CAPACITY * sizeof(node_t));
+  tree->capacity = INITIAL_CAPACITY;
+  link_free_nodes(tree, 0);
+  tree->root = NULL_NODE;
+  tree->margin = margin;
+  tree->size = 0;
+  tree->stack = malloc_safe(INITIAL_CAPACITY * sizeof(size_t));
+  tree->stack_capacity = INITIAL_CAPACITY;
+  return tree;
+}
+
+void aabb_tree_free(aabb_tree_t *tree) {
+  free(tree->stack);
+  free(tree->nodes);
+  free(tree);
+}
+
+size_t aabb_tree_size(aabb_tree_t *tree) { return tree->size; }
+
+size_t aabb_tree_height(aabb_tree_t *tree) {
+  return tree->root == NULL_NODE ? 0 : tree->nodes[tree->root].height;
+}
+
+static size_t allocate_node(aabb_tree_t *tree) {
+  if (tree->free_list == NULL_NODE) {
+    size_t old_capacity = tree->capacity;
+    tree->capacity *= GROWTH_FACTOR;
+    tree->nodes = realloc_safe(tree->nodes, tree->capacity * sizeof(node_t));
+    link_free_nodes(tree, old_capacity);
+  }
+  size_t index = tree->free_list;
+  node_t *node = &tree->nodes[index];
+  tree->free_list = node->parent;
+  node->item = NULL;
+  node->parent = NULL_NODE;
+  node->child1 = NULL_NODE;
+  node->child2 = NULL_NODE;
+  node->height = 0;
+  return index;
+}
+
+static void free_node(aabb_tree_t *tree, size_t index) {
+  tree->nodes[index].parent = tree->free_list;
+  tree->nodes[index].height = -1;
+  tree->free_list = index;
+}
+
+// recomputes an internal node's bounds and height from its children
+static void refit(node_t *nodes, size_t index) {
+  node_t *node = &nodes[index];
+  node_t *child1 = &nodes[node->child1];
+  node_t *child2 = &nodes[node->child2];
+  node->bounds = aabb_union(child1->bounds, child2->bounds);
+  node->height = 1 + (child1->height > child2->height ? child1->height
+                                                       : child2->height);
+}
+
+// points the parent of old_child (or the root) at new_child instead
+static void replace_child(aabb_tree_t *tree, size_t parent, size_t old_child,
+                          size_t new_child) {
+  if (parent == NULL_NODE) {
+    tree->root = new_child;
+  } else if (tree->nodes[parent].child1 == old_child) {
+    tree->nodes[parent].child1 = new_child;
+  } else {
+    tree->nodes[parent].child2 = new_child;
+  }
+}
+
+/**
+ * If one child of a node is more than one level taller than the other,
+ * rotates the taller child up to take the node's place.
+ * The node moves down to become the parent of the shorter child and
+ * the shorter of the taller child's children.
+ *
+ * @return the index of the node now in the given node's place
+ */
+static size_t balance(aabb_tree_t *tree, size_t index_a) {
+  node_t *nodes = tree->nodes;
+  node_t *a = &nodes[index_a];
+  if (is_leaf(a) || a->height < 2) {
+    return index_a;
+  }
+  int difference = nodes[a->child2].height - nodes[a->child1].height;
+  if (difference >= -1 && difference <= 1) {
+    return index_a;
+  }
+
+  // b is the taller child, which rises
+  bool second_rises = difference > 1;
+  size_t index_b = second_rises ? a->child2 : a->child1;
+  node_t *b = &nodes[index_b];
+  size_t index_d = b->child1;
+  size_t index_e = b->child2;
+  // b keeps its taller child, and gives the shorter one to a
+  size_t kept = nodes[index_d].height > nodes[index_e].height ? index_d
+                                                               : index_e;
+  size_t given = kept == index_d ? index_e : index_d;
+
+  b->parent = a->parent;
+  replace_child(tree, b->parent, index_a, index_b);
+  b->child1 = index_a;
+  b->child2 = kept;
+  a->parent = index_b;
+  if (second_rises) {
+    a->child2 = given;
+  } else {
+    a->child1 = given;
+  }
+  nodes[given].parent = index_a;
+  refit(nodes, index_a);
+  refit(nodes, index_b);
+  return index_b;
+}
+
+// refits and balances every node from index up to the root
+static void refit_ancestors(aabb_tree_t *tree, size_t index) {
+  while (index != NULL_NODE) {
+    index = balance(tree, index);
+    refit(tree->nodes, index);
+    index = tree->nodes[index].parent;
+  }
+}
+
+/**
+ * Finds the best sibling for a new leaf by descending from the root,
+ * choosing at each node whichever of stopping there or going into a child
+ * adds the least perimeter to the tree, then pairs the leaf with it.
+ */
+static void insert_leaf(aabb_tree_t *tree, size_t leaf) {
+  if (tree->root == NULL_NODE) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  node_t *nodes = tree->nodes;
+  aabb_t leaf_bounds = nodes[leaf].bounds;
+  size_t index = tree->root;
+  while (!is_leaf(&nodes[index])) {
+    node_t *node = &nodes[index];
+    double perimeter = aabb_perimeter(node->bounds);
+    double combined = aabb_perimeter(aabb_union(node->bounds, leaf_bounds));
+    // the cost of making a new parent for this node and the leaf
+    double cost = 2 * combined;
+    // every ancestor of the leaf grows by the same amount, wherever it goes
+    double inherited = 2 * (combined - perimeter);
+
+    double child_costs[2];
+    size_t children[2] = {node->child1, node->child2};
+    for (size_t i = 0; i < 2; i++) {
+      node_t *child = &nodes[children[i]];
+      double child_cost =
+          aabb_perimeter(aabb_union(child->bounds, leaf_bounds));
+      if (!is_leaf(child)) {
+        child_cost -= aabb_perimeter(child->bounds);
+      }
+      child_costs[i] = child_cost + inherited;
+    }
+    if (cost < child_costs[0] && cost < child_costs[1]) {
+      break;
+    }
+    index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+  }
+
+  size_t sibling = index;
+  size_t old_parent = nodes[sibling].parent;
+  size_t new_parent = allocate_node(tree);
+  nodes = tree->nodes;
+  nodes[new_parent].parent = old_parent;
+  replace_child(tree, old_parent, sibling, new_parent);
+  nodes[new_parent].child1 = sibling;
+  nodes[new_parent].child2 = leaf;
+  nodes[sibling].parent = new_parent;
+  nodes[leaf].parent = new_parent;
+  refit_ancestors(tree, new_parent);
+}
+
+// detaches a leaf, putting its sibling in the place of their parent
+static void remove_leaf(aabb_tree_t *tree, size_t leaf) {
+  if (leaf == tree->root) {
+    tree->root = NULL_NODE;
+    return;
+  }
+  node_t *nodes = tree->nodes;
+  size_t parent = nodes[leaf].parent;
+  size_t grandparent = nodes[parent].parent;
+  size_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2
+                                                : nodes[parent].child1;
+  replace_child(tree, grandparent, parent, sibling);
+  nodes[sibling].parent = grandparent;
+  free_node(tree, parent);
+  refit_ancestors(tree, grandparent);
+}
+
+static aabb_t fatten(aabb_tree_t *tree, aabb_t bounds) {
+  vector_t margin = {tree->margin, tree->margin};
+  return (aabb_t){vec_subtract(bounds.min, margin),
+                  vec_add(bounds.max, margin)};
+}
+
+size_t aabb_tree_insert(aabb_tree_t *tree, void *item, aabb_t bounds) {
+  size_t leaf = allocate_node(tree);
+  tree->nodes[leaf].item = item;
+  tree->nodes[leaf].bounds = fatten(tree, bounds);
+  insert_leaf(tree, leaf);
+  tree->size++;
+  return leaf;
+}
+
+static void assert_leaf(aabb_tree_t *tree, size_t proxy) {
+  assert(proxy < tree->capacity && tree->nodes[proxy].height == 0);
+}
+
+void aabb_tree_remove(aabb_tree_t *tree, size_t proxy) {
+  assert_leaf(tree, proxy);
+  remove_leaf(tree, proxy);
+  free_node(tree, proxy);
+  tree->size--;
+}
+
+bool aabb_tree_move(aabb_tree_t *tree, size_t proxy, aabb_t bounds) {
+  assert_leaf(tree, proxy);
+  if (aabb_contains(tree->nodes[proxy].bounds, bounds)) {
+    return false;
+  }
+  remove_leaf(tree, proxy);
+  tree->nodes[proxy].bounds = fatten(tree, bounds);
+  insert_leaf(tree, proxy);
+  return true;
+}
+
+aabb_t aabb_tree_get_fat_bounds(aabb_tree_t *tree, size_t proxy) {
+  assert_leaf(tree, proxy);
+  return tree->nodes[proxy].bounds;
+}
+
+void aabb_tree_query(aabb_tree_t *tree, aabb_t bounds,
+                     aabb_tree_query_func_t func, void *aux) {
+  if (tree->root == NULL_NODE) {
+    return;
+  }
+  // func may query the tree too, so the stack is taken from the tree
+  // while in use, and a nested query allocates its own
+  size_t *stack = tree->stack;
+  size_t capacity = tree->stack_capacity;
+  tree->stack = NULL;
+  if (!stack) {
+    stack = malloc_safe(INITIAL_CAPACITY * sizeof(size_t));
+    capacity = INITIAL_CAPACITY;
+  }
+  size_t num_stacked = 0;
+  stack[num_stacked++] = tree->root;
+  while (num_stacked > 0) {
+    size_t index = stack[--num_stacked];
+    node_t *node = &tree->nodes[index];
+    if (!aabb_overlaps(node->bounds, bounds)) {
+      continue;
+    }
+    if (is_leaf(node)) {
+      func(node->item, aux);
+      continue;
+    }
+    if (num_stacked + 2 > capacity) {
+      capacity *= GROWTH_FACTOR;
+      stack = realloc_safe(stack, capacity * sizeof(size_t));
+    }
+    // the first child is pushed last, so it is visited first
+    stack[num_stacked++] = node->child2;
+    stack[num_stacked++] = node->child1;
+  }
+  if (tree->stack) {
+    free(stack);
+  } else {
+    tree->stack = stack;
+    tree->stack_capacity = capacity;
+  }
+}
@@ -1,38 +1,108 @@
+#include <assert.h>
 #include <body.h>
 #include <collision.h>
+#include <gjk.h>
 #include <list.h>
+#include <math.h>
 #include <polygon.h>
+#include <shape.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <util.h>
 #include <vector.h>
 #include <image.h>
 
+// a field of a body's physics state, which lives in the body's store
+// while it is in one (see body_store_add())
+#define STATE(body, field)                                                     \
+  (*((body)->store ? &(body)->store->field[(body)->slot] : &(body)->field))
+
+static aabb_t poly_bounds(polygon_t *polygon) {
+  aabb_t bounds = {{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+  for (size_t i = 0; i < polygon->size; i++) {
+    vector_t vertex = polygon->vertices[i];
+    bounds.min.x = fmin(bounds.min.x, vertex.x);
+    bounds.min.y = fmin(bounds.min.y, vertex.y);
+    bounds.max.x = fmax(bounds.max.x, vertex.x);
+    bounds.max.y = fmax(bounds.max.y, vertex.y);
+  }
+  return bounds;
+}
+
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   return body_init_with_info(shape, mass, color, NULL);
 }
 
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color, const char *type) {
+  polygon_t *polygon = poly_from_list(shape);
+  list_free(shape);
+  return body_init_with_polygon(polygon, mass, color, type);
+}
+
+body_t *body_init_with_polygon(polygon_t *shape, double mass, rgb_color_t color,
+                               const char *type) {
   body_t *body = malloc_safe(sizeof(body_t));
+  body->shape_kind = BODY_SHAPE_POLYGON;
+  body->pos = poly_centroid(shape);
+  body->local_shape = poly_copy(shape);
+  poly_translate(body->local_shape, vec_negate(body->pos));
   body->shape = shape;
+  body->shape_dirty = false;
+  if (polygon_get_box(body->local_shape, &body->local_box)) {
+    body->shape_kind = BODY_SHAPE_BOX;
+  }
+  body->bounds_dirty = true;
+  body->prev_pos = body->pos;
+  body->prev_angle = 0.0;
+  body->bounding_radius = 0.0;
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t v = body->local_shape->vertices[i];
+    body->bounding_radius = fmax(body->bounding_radius, sqrt(vec_dot(v, v)));
+  }
   body->mass = mass;
   body->color = color;
   body->vel = VEC_ZERO;
-  body->pos = polygon_centroid(shape);
   body->angular_vel = 0.0;
   body->angle = 0.0;
   body->net_force = VEC_ZERO;
   body->net_impulse = VEC_ZERO;
+  body->store = NULL;
+  body->slot = 0;
   body->info = NULL;
   body->freer = NULL;
   body->removed = false;
+  body->is_static = false;
+  body->is_fast = false;
+  body->asleep = false;
+  body->slow_time = 0.0;
   body->image = NULL;
   body->type = type;
+  body->type_id = 0;
+  body->scene_links = NULL;
+  body->island_node = 0;
+  body->broad_phase_resting = false;
+  body->broad_phase_proxy = 0;
+  body->has_broad_phase_proxy = false;
+  body->changed = false;
+  return body;
+}
+
+body_t *body_init_circle(double radius, double mass, rgb_color_t color,
+                         const char *type) {
+  body_t *body =
+      body_init_with_polygon(shape_circle_create(radius), mass, color, type);
+  body->shape_kind = BODY_SHAPE_CIRCLE;
+  // the polygon's centroid is only about zero, so the world shape is
+  // rebuilt around the exact center
+  body_set_centroid(body, VEC_ZERO);
+  body->prev_pos = body->pos;
+  body->bounding_radius = radius;
   return body;
 }
 
 void body_free(body_t *body) {
-  list_free(body->shape);
+  poly_free(body->local_shape);
+  poly_free(body->shape);
   if (body->freer != NULL && body->info != NULL) {
     body->freer(body->info);
   }
@@ -40,111 +110,387 @@ void body_free(body_t *body) {
 }
 
 list_t *body_get_shape(body_t *body) {
-  size_t size = list_size(body->shape);
-  list_t *new = list_init(size, free);
-  for (size_t i = 0; i < size; i++) {
-    vector_t *vec = list_get(body->shape, i);
-    vector_t *vec_copy = malloc_safe(sizeof(vector_t));
-    *vec_copy = *vec;
-    list_add(new, vec_copy);
+  return poly_to_list(body_get_shape_unsafe(body));
+}
+
+// places a shape given relative to its centroid at a position and angle
+static void transform_shape(polygon_t *local_shape, vector_t pos, double angle,
+                            polygon_t *shape) {
+  // one sin/cos per body, rather than per vertex
+  double sin_theta = sin(angle);
+  double cos_theta = cos(angle);
+  const vector_t *local = local_shape->vertices;
+  vector_t *world = shape->vertices;
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t v = local[i];
+    world[i] = (vector_t){pos.x + v.x * cos_theta - v.y * sin_theta,
+                          pos.y + v.x * sin_theta + v.y * cos_theta};
+  }
+}
+
+// adds a body to its store's list of changed bodies, if it is in a store
+static void body_changed(body_t *body) {
+  body_store_t *store = body->store;
+  if (store && !store->all_changed && !body->changed) {
+    store->changed[store->num_changed++] = body;
+    body->changed = true;
+  }
+}
+
+// marks the cached world-space shape and bounds as stale
+static void body_invalidate(body_t *body) {
+  body->shape_dirty = true;
+  body->bounds_dirty = true;
+}
+
+static void body_moved(body_t *body) {
+  body_invalidate(body);
+  body_changed(body);
+}
+
+// picks up a move by body_store_integrate(), which only flags the store
+// (and already counts as a change to every body)
+static void body_sync(body_t *body) {
+  if (body->store && body->store->moved[body->slot]) {
+    body->store->moved[body->slot] = false;
+    body_invalidate(body);
+  }
+}
+
+polygon_t *body_get_shape_unsafe(body_t *body) {
+  body_sync(body);
+  if (body->shape_dirty) {
+    transform_shape(body->local_shape, STATE(body, pos), STATE(body, angle), body->shape);
+    body->shape_dirty = false;
+  }
+  return body->shape;
+}
+
+void body_save_transform(body_t *body) {
+  body->prev_pos = STATE(body, pos);
+  body->prev_angle = STATE(body, angle);
+}
+
+vector_t body_get_interpolated_centroid(body_t *body, double alpha) {
+  return vec_add(body->prev_pos,
+                 vec_multiply(alpha, vec_subtract(STATE(body, pos), body->prev_pos)));
+}
+
+double body_get_interpolated_angle(body_t *body, double alpha) {
+  return body->prev_angle + alpha * (STATE(body, angle) - body->prev_angle);
+}
+
+polygon_t *body_get_interpolated_shape(body_t *body, double alpha) {
+  polygon_t *shape = poly_init(body->local_shape->size);
+  transform_shape(body->local_shape, body_get_interpolated_centroid(body, alpha),
+                  body_get_interpolated_angle(body, alpha), shape);
+  return shape;
+}
+
+double body_get_mass(body_t *body) { return STATE(body, mass); }
+
+/**
+ * Recomputes a body's bounding box, and its box if it is one,
+ * if the body has moved since they were last computed.
+ * Unlike body_get_shape_unsafe(), this does not transform any vertices
+ * unless the body is a generic polygon.
+ */
+static void body_update_bounds(body_t *body) {
+  body_sync(body);
+  if (!body->bounds_dirty) {
+    return;
+  }
+  switch (body->shape_kind) {
+  case BODY_SHAPE_CIRCLE: {
+    vector_t extent = {body->bounding_radius, body->bounding_radius};
+    body->aabb = (aabb_t){vec_subtract(STATE(body, pos), extent),
+                          vec_add(STATE(body, pos), extent)};
+    break;
+  }
+  case BODY_SHAPE_BOX: {
+    box_t local = body->local_box;
+    double sin_theta = sin(STATE(body, angle));
+    double cos_theta = cos(STATE(body, angle));
+    vector_t axis = {local.axis.x * cos_theta - local.axis.y * sin_theta,
+                     local.axis.x * sin_theta + local.axis.y * cos_theta};
+    vector_t offset = {local.center.x * cos_theta - local.center.y * sin_theta,
+                       local.center.x * sin_theta + local.center.y * cos_theta};
+    body->box = (box_t){vec_add(STATE(body, pos), offset), axis, local.half_size};
+    vector_t extent = {
+        local.half_size.x * fabs(axis.x) + local.half_size.y * fabs(axis.y),
+        local.half_size.x * fabs(axis.y) + local.half_size.y * fabs(axis.x)};
+    body->aabb = (aabb_t){vec_subtract(body->box.center, extent),
+                          vec_add(body->box.center, extent)};
+    break;
+  }
+  case BODY_SHAPE_POLYGON:
+    body->aabb = poly_bounds(body_get_shape_unsafe(body));
+    break;
   }
-  return new;
+  body->bounds_dirty = false;
 }
 
-list_t *body_get_shape_unsafe(body_t *body) { return body->shape; }
+/**
+ * Tests two bodies, dispatching on their shape kinds.
+ * Pairs involving a polygon use GJK if simplex_cache is non-NULL,
+ * and the separating axis test otherwise.
+ */
+static collision_info_t body_collide_with(body_t *body1, body_t *body2,
+                                          vector_t *axis_cache,
+                                          gjk_simplex_t *simplex_cache) {
+  // most pairs are far apart, so try the cheap rejections first
+  vector_t between = vec_subtract(STATE(body2, pos), STATE(body1, pos));
+  double reach = body1->bounding_radius + body2->bounding_radius;
+  if (vec_dot(between, between) > reach * reach ||
+      !aabb_overlaps(body_get_aabb(body1), body_get_aabb(body2))) {
+    return (collision_info_t){false, VEC_ZERO};
+  }
 
-double body_get_mass(body_t *body) { return body->mass; }
+  // dispatch on the pair of shape kinds; the bounds are up to date here
+  body_shape_kind_t kind1 = body1->shape_kind;
+  body_shape_kind_t kind2 = body2->shape_kind;
+  if (kind1 == BODY_SHAPE_CIRCLE && kind2 == BODY_SHAPE_CIRCLE) {
+    return find_circle_collision(STATE(body1, pos), body1->bounding_radius,
+                                 STATE(body2, pos), body2->bounding_radius);
+  } else if (kind2 == BODY_SHAPE_CIRCLE) {
+    // so that the circle comes first
+    collision_info_t collision =
+        body_collide_with(body2, body1, axis_cache, simplex_cache);
+    collision.axis = vec_negate(collision.axis);
+    return collision;
+  } else if (kind1 == BODY_SHAPE_CIRCLE && kind2 == BODY_SHAPE_BOX) {
+    return find_circle_box_collision(STATE(body1, pos), body1->bounding_radius,
+                                     body2->box);
+  } else if (kind1 == BODY_SHAPE_CIRCLE) {
+    return find_circle_polygon_collision(STATE(body1, pos), body1->bounding_radius,
+                                         body_get_shape_unsafe(body2));
+  } else if (kind1 == BODY_SHAPE_BOX && kind2 == BODY_SHAPE_BOX) {
+    return find_box_collision_cached(body1->box, body2->box, axis_cache);
+  } else if (simplex_cache) {
+    return find_gjk_collision_cached(body_get_shape_unsafe(body1),
+                                     body_get_shape_unsafe(body2),
+                                     simplex_cache);
+  }
+  return find_polygon_collision_cached(body_get_shape_unsafe(body1),
+                                       body_get_shape_unsafe(body2),
+                                       axis_cache);
+}
 
 collision_info_t body_collide(body_t *body1, body_t *body2) {
-  return find_collision(body1->shape, body2->shape);
+  return body_collide_with(body1, body2, NULL, NULL);
 }
 
-vector_t body_get_centroid(body_t *body) { return body->pos; }
+collision_info_t body_collide_cached(body_t *body1, body_t *body2,
+                                     vector_t *axis_cache) {
+  return body_collide_with(body1, body2, axis_cache, NULL);
+}
+
+collision_info_t body_collide_gjk(body_t *body1, body_t *body2,
+                                  gjk_simplex_t *simplex_cache) {
+  gjk_simplex_t simplex = {0};
+  return body_collide_with(body1, body2, NULL,
+                           simplex_cache ? simplex_cache : &simplex);
+}
+
+aabb_t body_get_aabb(body_t *body) {
+  body_update_bounds(body);
+  return body->aabb;
+}
+
+body_shape_kind_t body_get_shape_kind(body_t *body) {
+  return body->shape_kind;
+}
 
-vector_t body_get_velocity(body_t *body) { return body->vel; }
+double body_get_bounding_radius(body_t *body) { return body->bounding_radius; }
+
+vector_t body_get_centroid(body_t *body) { return STATE(body, pos); }
+
+vector_t body_get_velocity(body_t *body) { return STATE(body, vel); }
 
 rgb_color_t body_get_color(body_t *body) { return body->color; }
 
 void *body_get_info(body_t *body) { return body->info; }
 
+static bool vec_is_zero(vector_t v) { return v.x == 0.0 && v.y == 0.0; }
+
 void body_set_centroid(body_t *body, vector_t x) {
-  vector_t diff = vec_subtract(x, body->pos);
-  polygon_translate(body->shape, diff);
-  body->pos = x;
+  STATE(body, pos) = x;
+  body_moved(body);
+  body_wake(body);
 }
 
-void body_set_velocity(body_t *body, vector_t v) { body->vel = v; }
+void body_set_velocity(body_t *body, vector_t v) {
+  STATE(body, vel) = v;
+  if (!vec_is_zero(v)) {
+    body_wake(body);
+  }
+}
 
 void body_set_rotation(body_t *body, double angle) {
-  double diff = angle - body->angle;
-  polygon_rotate(body->shape, diff, body->pos);
-  body->angle = angle;
+  STATE(body, angle) = angle;
+  body_moved(body);
+  body_wake(body);
 }
 
 void body_set_angular_velocity(body_t *body, double angular_velocity) {
-  body->angular_vel = angular_velocity;
+  STATE(body, angular_vel) = angular_velocity;
+  if (angular_velocity != 0.0) {
+    body_wake(body);
+  }
 }
 
-void body_tick(body_t *body, double dt) {
-  vector_t acc = vec_divide(body->mass, body->net_force);
-  vector_t new_vel = vec_add(vec_add(body->vel, vec_multiply(dt, acc)),
-                             vec_divide(body->mass, body->net_impulse));
-  vector_t dx = vec_multiply(0.5 * dt, vec_add(new_vel, body->vel));
-
-  polygon_translate(body->shape, dx);
-  body->pos = vec_add(body->pos, dx);
-  body->vel = new_vel;
-  body->net_force = VEC_ZERO;
-  body->net_impulse = VEC_ZERO;
+double body_get_angular_velocity(body_t *body) {
+  return STATE(body, angular_vel);
+}
+
+static vector_t next_velocity(double mass, vector_t vel, vector_t net_force,
+                              vector_t net_impulse, double dt) {
+  vector_t acc = vec_divide(mass, net_force);
+  return vec_add(vec_add(vel, vec_multiply(dt, acc)),
+                 vec_divide(mass, net_impulse));
+}
+
+vector_t body_get_next_velocity(body_t *body, double dt) {
+  return next_velocity(STATE(body, mass), STATE(body, vel),
+                       STATE(body, net_force), STATE(body, net_impulse), dt);
+}
 
-  double d_theta = dt * body->angular_vel;
-  body->angle += d_theta;
-  polygon_rotate(body->shape, d_theta, body->pos);
+// bodies outside a store are always ticked with INTEGRATOR_VERLET
+static integrator_t body_integrator(body_t *body) {
+  return body->store ? body->store->integrator : INTEGRATOR_VERLET;
+}
+
+vector_t body_get_tick_displacement(body_t *body, double dt) {
+  return integrator_displacement(body_integrator(body), STATE(body, vel),
+                                 body_get_next_velocity(body, dt), dt);
+}
+
+/**
+ * Ticks one body's physics state, wherever it is kept (see body_tick()).
+ * Returns whether the body moved.
+ */
+static bool integrate(integrator_t integrator, double mass, vector_t *vel,
+                      vector_t *pos, double angular_vel, double *angle,
+                      vector_t *net_force, vector_t *net_impulse, double dt) {
+  vector_t new_vel = next_velocity(mass, *vel, *net_force, *net_impulse, dt);
+  vector_t dx = integrator_displacement(integrator, *vel, new_vel, dt);
+
+  *pos = vec_add(*pos, dx);
+  *vel = new_vel;
+  *net_force = VEC_ZERO;
+  *net_impulse = VEC_ZERO;
+
+  double d_theta = dt * angular_vel;
+  *angle += d_theta;
+  return dx.x != 0.0 || dx.y != 0.0 || d_theta != 0.0;
+}
+
+void body_tick(body_t *body, double dt) {
+  // resting bodies (e.g. walls) keep their world vertices
+  if (integrate(body_integrator(body), STATE(body, mass), &STATE(body, vel),
+                &STATE(body, pos), STATE(body, angular_vel),
+                &STATE(body, angle), &STATE(body, net_force),
+                &STATE(body, net_impulse), dt)) {
+    body_moved(body);
+  }
 }
 
 void body_tick_with_bounds(body_t *body, double dt, vector_t bounds,
                            double bounciness) {
   body_tick(body, dt);
 
-  const size_t num_vertices = list_size(body->shape);
   bool vertical_hit = false;
   bool horizontal_hit = false;
-  for (size_t i = 0; i < num_vertices; i++) {
-    vector_t *vertex = list_get(body->shape, i);
-    if (vertex->x < 0 || vertex->x > bounds.x) {
+  polygon_t *shape = body_get_shape_unsafe(body);
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t vertex = shape->vertices[i];
+    if (vertex.x < 0 || vertex.x > bounds.x) {
       horizontal_hit = true;
     }
-    if (vertex->y < 0 || vertex->y > bounds.y) {
+    if (vertex.y < 0 || vertex.y > bounds.y) {
       vertical_hit = true;
     }
   }
   if (vertical_hit) {
-    body->vel.y *= -bounciness;
+    STATE(body, vel).y *= -bounciness;
   }
   if (horizontal_hit) {
-    body->vel.x *= -bounciness;
+    STATE(body, vel).x *= -bounciness;
   }
   if (vertical_hit || horizontal_hit) {
     // undo the move so that we are no longer inside the wall
-    vector_t dx = vec_multiply(dt, body->vel);
-    body->pos = vec_add(body->pos, dx);
-    polygon_translate(body->shape, dx);
+    vector_t dx = vec_multiply(dt, STATE(body, vel));
+    STATE(body, pos) = vec_add(STATE(body, pos), dx);
+    body_moved(body);
     body->color = color_random();
   }
 }
 
 void body_add_force(body_t *body, vector_t force) {
-  body->net_force = vec_add(body->net_force, force);
+  STATE(body, net_force) = vec_add(STATE(body, net_force), force);
+  if (!vec_is_zero(force)) {
+    body_wake(body);
+  }
 }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
-  body->net_impulse = vec_add(body->net_impulse, impulse);
+  STATE(body, net_impulse) = vec_add(STATE(body, net_impulse), impulse);
+  if (!vec_is_zero(impulse)) {
+    body_wake(body);
+  }
 }
 
-void body_remove(body_t *body) { body->removed = true; }
+// keeps the store's copy of whether the body should be integrated
+static void body_update_active(body_t *body) {
+  if (body->store) {
+    body->store->active[body->slot] =
+        !body->removed && !body->is_static && !body->asleep;
+    body_changed(body);
+  }
+}
+
+void body_remove(body_t *body) {
+  if (body->removed) {
+    return;
+  }
+  body->removed = true;
+  if (body->store) {
+    body->store->num_removed++;
+  }
+  body_update_active(body);
+}
 
 bool body_is_removed(body_t *body) { return body->removed; }
 
+void body_set_static(body_t *body) {
+  assert(STATE(body, mass) == INFINITY);
+  body->is_static = true;
+  body_update_active(body);
+}
+
+bool body_is_static(body_t *body) { return body->is_static; }
+
+void body_set_fast(body_t *body) { body->is_fast = true; }
+
+bool body_is_fast(body_t *body) { return body->is_fast; }
+
+void body_sleep(body_t *body) {
+  body->asleep = true;
+  STATE(body, vel) = VEC_ZERO;
+  STATE(body, angular_vel) = 0.0;
+  body_update_active(body);
+}
+
+void body_wake(body_t *body) {
+  if (body->asleep) {
+    body->asleep = false;
+    body->slow_time = 0.0;
+    body_update_active(body);
+  }
+}
+
+bool body_is_asleep(body_t *body) { return body->asleep; }
+
 void body_set_image(body_t *body, const char *name, double scale) {
   body->image = image_load(name);
   body->image_scale = scale;
@@ -163,7 +509,7 @@ double body_get_image_scale(body_t *body) {
 }
 
 double body_get_angle(body_t *body) {
-  return body->angle;
+  return STATE(body, angle);
 }
 
 double body_get_image_rotation(body_t *body) {
@@ -176,4 +522,144 @@ void body_set_image_offset(body_t *body, vector_t offset) {
 
 vector_t body_get_image_offset(body_t *body) {
   return body->image_offset;
-}
\ No newline at end of file
+}
+
+body_store_t *body_store_init(size_t initial_capacity) {
+  body_store_t *store = malloc_safe(sizeof(body_store_t));
+  store->size = 0;
+  store->capacity = initial_capacity > 0 ? initial_capacity : 1;
+  store->bodies = malloc_safe(store->capacity * sizeof(body_t *));
+  store->mass = malloc_safe(store->capacity * sizeof(double));
+  store->vel = malloc_safe(store->capacity * sizeof(vector_t));
+  store->pos = malloc_safe(store->capacity * sizeof(vector_t));
+  store->angular_vel = malloc_safe(store->capacity * sizeof(double));
+  store->angle = malloc_safe(store->capacity * sizeof(double));
+  store->net_force = malloc_safe(store->capacity * sizeof(vector_t));
+  store->net_impulse = malloc_safe(store->capacity * sizeof(vector_t));
+  store->active = malloc_safe(store->capacity * sizeof(bool));
+  store->moved = malloc_safe(store->capacity * sizeof(bool));
+  // each body is listed at most once, so this grows with the store
+  store->changed = malloc_safe(store->capacity * sizeof(body_t *));
+  store->num_changed = 0;
+  store->all_changed = false;
+  store->num_removed = 0;
+  store->integrator = INTEGRATOR_VERLET;
+  return store;
+}
+
+void body_store_free(body_store_t *store) {
+  free(store->bodies);
+  free(store->mass);
+  free(store->vel);
+  free(store->pos);
+  free(store->angular_vel);
+  free(store->angle);
+  free(store->net_force);
+  free(store->net_impulse);
+  free(store->active);
+  free(store->moved);
+  free(store->changed);
+  free(store);
+}
+
+static void body_store_grow(body_store_t *store) {
+  store->capacity *= 2;
+  size_t capacity = store->capacity;
+  store->bodies = realloc_safe(store->bodies, capacity * sizeof(body_t *));
+  store->mass = realloc_safe(store->mass, capacity * sizeof(double));
+  store->vel = realloc_safe(store->vel, capacity * sizeof(vector_t));
+  store->pos = realloc_safe(store->pos, capacity * sizeof(vector_t));
+  store->angular_vel =
+      realloc_safe(store->angular_vel, capacity * sizeof(double));
+  store->angle = realloc_safe(store->angle, capacity * sizeof(double));
+  store->net_force =
+      realloc_safe(store->net_force, capacity * sizeof(vector_t));
+  store->net_impulse =
+      realloc_safe(store->net_impulse, capacity * sizeof(vector_t));
+  store->active = realloc_safe(store->active, capacity * sizeof(bool));
+  store->moved = realloc_safe(store->moved, capacity * sizeof(bool));
+  store->changed = realloc_safe(store->changed, capacity * sizeof(body_t *));
+}
+
+void body_store_add(body_store_t *store, body_t *body) {
+  assert(!body->store);
+  if (store->size == store->capacity) {
+    body_store_grow(store);
+  }
+  size_t slot = store->size++;
+  store->bodies[slot] = body;
+  store->mass[slot] = body->mass;
+  store->vel[slot] = body->vel;
+  store->pos[slot] = body->pos;
+  store->angular_vel[slot] = body->angular_vel;
+  store->angle[slot] = body->angle;
+  store->net_force[slot] = body->net_force;
+  store->net_impulse[slot] = body->net_impulse;
+  store->moved[slot] = false;
+  body->store = store;
+  body->slot = slot;
+  if (body->removed) {
+    store->num_removed++;
+  }
+  body_update_active(body);
+}
+
+void body_store_compact(body_store_t *store) {
+  if (store->num_removed == 0) {
+    return;
+  }
+  // the list may hold bodies about to be freed,
+  // and a scene has to drop those from its broad phase anyway
+  body_store_clear_changed(store);
+  store->all_changed = true;
+  size_t kept = 0;
+  for (size_t slot = 0; slot < store->size; slot++) {
+    body_t *body = store->bodies[slot];
+    if (body->removed) {
+      // the body's state goes back to the body while it remains allocated
+      body_sync(body);
+      body->mass = store->mass[slot];
+      body->vel = store->vel[slot];
+      body->pos = store->pos[slot];
+      body->angular_vel = store->angular_vel[slot];
+      body->angle = store->angle[slot];
+      body->net_force = store->net_force[slot];
+      body->net_impulse = store->net_impulse[slot];
+      body->store = NULL;
+      continue;
+    }
+    store->bodies[kept] = body;
+    store->mass[kept] = store->mass[slot];
+    store->vel[kept] = store->vel[slot];
+    store->pos[kept] = store->pos[slot];
+    store->angular_vel[kept] = store->angular_vel[slot];
+    store->angle[kept] = store->angle[slot];
+    store->net_force[kept] = store->net_force[slot];
+    store->net_impulse[kept] = store->net_impulse[slot];
+    store->active[kept] = store->active[slot];
+    store->moved[kept] = store->moved[slot];
+    body->slot = kept;
+    kept++;
+  }
+  store->size = kept;
+  store->num_removed = 0;
+}
+
+void body_store_clear_changed(body_store_t *store) {
+  for (size_t i = 0; i < store->num_changed; i++) {
+    store->changed[i]->changed = false;
+  }
+  store->num_changed = 0;
+  store->all_changed = false;
+}
+
+void body_store_integrate(body_store_t *store, double dt) {
+  // the integration only flags the bodies it moves, so don't list them
+  store->all_changed = true;
+  integration_batch_t batch = {
+      store->size,        store->mass,        store->vel,
+      store->pos,         store->angular_vel, store->angle,
+      store->net_force,   store->net_impulse, store->active,
+      store->moved};
+  integrate_batch(&batch, store->integrator, dt);
+}
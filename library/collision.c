@@ -1,64 +1,523 @@
 #include <collision.h>
 #include <math.h>
+#include <projection.h>
 #include <vector.h>
 
-typedef struct {
-  double min;
-  double max;
-} projection_range_t;
+// the number of SAT axes each shape is projected onto per pass
+#define AXIS_BATCH 4
+// relative tolerance when choosing reference edges and contact points
+static const double CONTACT_TOLERANCE = 1e-9;
 
-static projection_range_t shape_project(list_t *shape, vector_t axis) {
-  size_t shape1_size = list_size(shape);
-  projection_range_t range = {INFINITY, -INFINITY};
+static projection_range_t shape_project(polygon_t *shape, vector_t axis) {
+  projection_range_t range;
+  poly_project(shape, &axis, 1, &range);
+  return range;
+}
 
-  for (size_t i = 0; i < shape1_size; i++) {
-    double projection = vec_dot(*(vector_t *)list_get(shape, i), axis);
-    range.max = fmax(range.max, projection);
-    range.min = fmin(range.min, projection);
+// relative tolerance when checking that a polygon's corners are right angles
+static const double BOX_TOLERANCE = 1e-9;
+
+bool polygon_get_box(polygon_t *polygon, box_t *box) {
+  if (polygon->size != 4) {
+    return false;
+  }
+  const vector_t *v = polygon->vertices;
+  vector_t side1 = vec_subtract(v[1], v[0]);
+  vector_t side2 = vec_subtract(v[2], v[1]);
+  double length1 = vec_magnitude(side1);
+  double length2 = vec_magnitude(side2);
+  double tolerance = BOX_TOLERANCE * (length1 + length2);
+  // a parallelogram with a right angle is a rectangle
+  vector_t opposite_sum1 = vec_add(side1, vec_subtract(v[3], v[2]));
+  vector_t opposite_sum2 = vec_add(side2, vec_subtract(v[0], v[3]));
+  if (length1 == 0 || length2 == 0 ||
+      fabs(vec_dot(side1, side2)) > tolerance * (length1 + length2) ||
+      vec_magnitude(opposite_sum1) > tolerance ||
+      vec_magnitude(opposite_sum2) > tolerance) {
+    return false;
   }
+  box->center = vec_multiply(0.5, vec_add(v[0], v[2]));
+  box->axis = vec_divide(length1, side1);
+  box->half_size = (vector_t){0.5 * length1, 0.5 * length2};
+  return true;
+}
 
-  return range;
+static bool has_cached_axis(vector_t *axis_cache) {
+  return axis_cache && (axis_cache->x != 0.0 || axis_cache->y != 0.0);
 }
 
-collision_info_t find_collision(list_t *shape1, list_t *shape2) {
-  size_t shape1_size = list_size(shape1);
-  size_t shape2_size = list_size(shape2);
+// the corners of a box, counterclockwise
+static void box_corners(box_t box, vector_t corners[4]) {
+  vector_t along = vec_multiply(box.half_size.x, box.axis);
+  vector_t across = vec_multiply(box.half_size.y, vec_perpendicular(box.axis));
+  corners[0] = vec_subtract(vec_subtract(box.center, along), across);
+  corners[1] = vec_subtract(vec_add(box.center, along), across);
+  corners[2] = vec_add(vec_add(box.center, along), across);
+  corners[3] = vec_add(vec_subtract(box.center, along), across);
+}
+
+// a collision with a circle, whose deepest point is its only contact
+static collision_info_t circle_collision(vector_t center, double radius,
+                                         vector_t axis, double depth) {
+  collision_info_t collision = {true, axis, depth, 1};
+  collision.contacts[0] = vec_add(center, vec_multiply(radius, axis));
+  return collision;
+}
+
+// the radius of a box's projection onto a unit axis
+static double box_project(box_t box, vector_t axis) {
+  double along = fabs(vec_dot(box.axis, axis));
+  double across = fabs(vec_cross(box.axis, axis));
+  return box.half_size.x * along + box.half_size.y * across;
+}
+
+collision_info_t find_box_collision(box_t box1, box_t box2) {
+  return find_box_collision_cached(box1, box2, NULL);
+}
+
+collision_info_t find_box_collision_cached(box_t box1, box_t box2,
+                                          vector_t *axis_cache) {
+  vector_t between = vec_subtract(box2.center, box1.center);
+  if (has_cached_axis(axis_cache)) {
+    vector_t axis = *axis_cache;
+    if (box_project(box1, axis) + box_project(box2, axis) <
+        fabs(vec_dot(between, axis))) {
+      collision_info_t no_collision = {false, VEC_ZERO};
+      return no_collision;
+    }
+  }
+
+  vector_t axes[] = {box1.axis, vec_perpendicular(box1.axis), box2.axis,
+                     vec_perpendicular(box2.axis)};
 
   double collision_axis_overlap = INFINITY;
-  vector_t collision_axis;
+  vector_t collision_axis = VEC_ZERO;
+  for (size_t i = 0; i < sizeof(axes) / sizeof(axes[0]); i++) {
+    double distance = vec_dot(between, axes[i]);
+    double overlap = box_project(box1, axes[i]) + box_project(box2, axes[i]) -
+                     fabs(distance);
+    if (overlap < 0) {
+      if (axis_cache) {
+        *axis_cache = axes[i];
+      }
+      collision_info_t no_collision = {false, VEC_ZERO};
+      return no_collision;
+    } else if (overlap < collision_axis_overlap) {
+      collision_axis_overlap = overlap;
+      // so that the axis points from box 1 to box 2
+      collision_axis = distance < 0 ? vec_negate(axes[i]) : axes[i];
+    }
+  }
+
+  if (axis_cache) {
+    *axis_cache = collision_axis;
+  }
+  vector_t corners1[4], corners2[4];
+  box_corners(box1, corners1);
+  box_corners(box2, corners2);
+  polygon_t polygon1 = {4, corners1};
+  polygon_t polygon2 = {4, corners2};
+  collision_info_t collision = {true, collision_axis};
+  find_polygon_contacts(&polygon1, &polygon2, &collision);
+  return collision;
+}
+
+collision_info_t find_circle_box_collision(vector_t center, double radius,
+                                           box_t box) {
+  // work in the box's frame, where it is axis-aligned and centered on 0
+  vector_t across_axis = vec_perpendicular(box.axis);
+  vector_t offset = vec_subtract(center, box.center);
+  vector_t local = {vec_dot(offset, box.axis), vec_dot(offset, across_axis)};
+  vector_t closest = {fmax(-box.half_size.x, fmin(box.half_size.x, local.x)),
+                      fmax(-box.half_size.y, fmin(box.half_size.y, local.y))};
+  vector_t to_center = vec_subtract(local, closest);
+  double distance_squared = vec_dot(to_center, to_center);
+  if (distance_squared > radius * radius) {
+    collision_info_t no_collision = {false, VEC_ZERO};
+    return no_collision;
+  }
 
-  for (size_t i = 0; i < shape1_size + shape2_size; i++) {
-    vector_t *point1;
-    vector_t *point2;
-    if (i < shape1_size) {
-      point1 = list_get(shape1, i);
-      point2 = list_get(shape1, (i + 1) % shape1_size);
+  vector_t local_axis;
+  double depth;
+  if (distance_squared > 0) {
+    double distance = sqrt(distance_squared);
+    local_axis = vec_divide(-distance, to_center);
+    depth = radius - distance;
+  } else {
+    // the center is inside the box, so push it out of the nearest side
+    double depth_x = box.half_size.x - fabs(local.x);
+    double depth_y = box.half_size.y - fabs(local.y);
+    if (depth_x < depth_y) {
+      local_axis = (vector_t){local.x < 0 ? 1.0 : -1.0, 0.0};
     } else {
-      point1 = list_get(shape2, i - shape1_size);
-      point2 = list_get(shape2, (i - shape1_size + 1) % shape2_size);
+      local_axis = (vector_t){0.0, local.y < 0 ? 1.0 : -1.0};
     }
+    depth = radius + fmin(depth_x, depth_y);
+  }
+  vector_t axis = vec_add(vec_multiply(local_axis.x, box.axis),
+                          vec_multiply(local_axis.y, across_axis));
+  return circle_collision(center, radius, axis, depth);
+}
+
+// whether projecting onto an axis separates two shapes
+static bool axis_separates(polygon_t *shape1, polygon_t *shape2,
+                           vector_t axis) {
+  projection_range_t range1 = shape_project(shape1, axis);
+  projection_range_t range2 = shape_project(shape2, axis);
+  return fmin(range1.max, range2.max) - fmax(range1.min, range2.min) < 0;
+}
+
+collision_info_t find_polygon_collision(polygon_t *shape1, polygon_t *shape2) {
+  return find_polygon_collision_cached(shape1, shape2, NULL);
+}
 
-    vector_t edge = vec_subtract(*point2, *point1);
-    vector_t axis = vec_norm(vec_perpendicular(edge));
-    if (i >= shape1_size) {
-      // so that normal points from shape 1 to shape 2
-      axis = vec_negate(axis);
+collision_info_t find_polygon_collision_cached(polygon_t *shape1,
+                                              polygon_t *shape2,
+                                              vector_t *axis_cache) {
+  box_t box1, box2;
+  if (polygon_get_box(shape1, &box1) && polygon_get_box(shape2, &box2)) {
+    return find_box_collision_cached(box1, box2, axis_cache);
+  }
+  if (has_cached_axis(axis_cache) &&
+      axis_separates(shape1, shape2, *axis_cache)) {
+    collision_info_t no_collision = {false, VEC_ZERO};
+    return no_collision;
+  }
+
+  size_t shape1_size = shape1->size;
+  size_t shape2_size = shape2->size;
+  size_t num_axes = shape1_size + shape2_size;
+
+  double collision_axis_overlap = INFINITY;
+  vector_t collision_axis;
+
+  // project both shapes onto a batch of edge normals at a time,
+  // then check the batch's axes in order
+  for (size_t start = 0; start < num_axes; start += AXIS_BATCH) {
+    size_t batch_size =
+        num_axes - start < AXIS_BATCH ? num_axes - start : AXIS_BATCH;
+    vector_t axes[AXIS_BATCH];
+    for (size_t j = 0; j < batch_size; j++) {
+      size_t i = start + j;
+      vector_t point1;
+      vector_t point2;
+      if (i < shape1_size) {
+        point1 = shape1->vertices[i];
+        point2 = shape1->vertices[(i + 1) % shape1_size];
+      } else {
+        point1 = shape2->vertices[i - shape1_size];
+        point2 = shape2->vertices[(i - shape1_size + 1) % shape2_size];
+      }
+
+      vector_t edge = vec_subtract(point2, point1);
+      axes[j] = vec_norm(vec_perpendicular(edge));
     }
 
-    projection_range_t range1 = shape_project(shape1, axis);
-    projection_range_t range2 = shape_project(shape2, axis);
+    projection_range_t ranges1[AXIS_BATCH];
+    projection_range_t ranges2[AXIS_BATCH];
+    poly_project(shape1, axes, batch_size, ranges1);
+    poly_project(shape2, axes, batch_size, ranges2);
+
+    for (size_t j = 0; j < batch_size; j++) {
+      double overlap = fmin(ranges1[j].max, ranges2[j].max) -
+                       fmax(ranges1[j].min, ranges2[j].min);
+      if (overlap < 0) {
+        if (axis_cache) {
+          *axis_cache = axes[j];
+        }
+        collision_info_t no_collision = {false, VEC_ZERO};
+        return no_collision;
+      } else if (overlap < collision_axis_overlap) {
+        collision_axis_overlap = overlap;
+        collision_axis = axes[j];
+        // so that the axis points from shape 1 to shape 2
+        if (ranges1[j].min + ranges1[j].max >
+            ranges2[j].min + ranges2[j].max) {
+          collision_axis = vec_negate(collision_axis);
+        }
+      }
+    }
+  }
 
-    double overlap =
-        fmin(range1.max, range2.max) - fmax(range1.min, range2.min);
+  if (axis_cache) {
+    *axis_cache = collision_axis;
+  }
+  collision_info_t collision = {true, collision_axis};
+  find_polygon_contacts(shape1, shape2, &collision);
+  return collision;
+}
+
+collision_info_t find_circle_collision(vector_t center1, double radius1,
+                                       vector_t center2, double radius2) {
+  vector_t between = vec_subtract(center2, center1);
+  double distance = vec_magnitude(between);
+  if (distance > radius1 + radius2) {
+    collision_info_t no_collision = {false, VEC_ZERO};
+    return no_collision;
+  }
+  // concentric circles can be pushed apart along any axis
+  vector_t axis = distance > 0 ? vec_divide(distance, between)
+                               : (vector_t){1.0, 0.0};
+  return circle_collision(center1, radius1, axis,
+                          radius1 + radius2 - distance);
+}
+
+collision_info_t find_circle_polygon_collision(vector_t center, double radius,
+                                               polygon_t *polygon) {
+  size_t num_vertices = polygon->size;
+  double collision_axis_overlap = INFINITY;
+  vector_t collision_axis = VEC_ZERO;
+  bool polygon_is_behind = false;
+
+  // the candidate axes are the polygon's edge normals,
+  // plus the axis from its closest vertex to the center of the circle
+  vector_t closest_vertex = polygon->vertices[0];
+  double closest_distance = INFINITY;
+  for (size_t i = 0; i <= num_vertices; i++) {
+    vector_t axis;
+    if (i < num_vertices) {
+      vector_t point1 = polygon->vertices[i];
+      vector_t point2 = polygon->vertices[(i + 1) % num_vertices];
+      axis = vec_norm(vec_perpendicular(vec_subtract(point2, point1)));
+      vector_t offset = vec_subtract(center, point1);
+      double distance = vec_dot(offset, offset);
+      if (distance < closest_distance) {
+        closest_distance = distance;
+        closest_vertex = point1;
+      }
+    } else {
+      vector_t offset = vec_subtract(center, closest_vertex);
+      if (closest_distance == 0) {
+        break;
+      }
+      axis = vec_divide(sqrt(closest_distance), offset);
+    }
+
+    projection_range_t range = shape_project(polygon, axis);
+    double projection = vec_dot(center, axis);
+    double overlap = fmin(range.max, projection + radius) -
+                     fmax(range.min, projection - radius);
     if (overlap < 0) {
       collision_info_t no_collision = {false, VEC_ZERO};
       return no_collision;
     } else if (overlap < collision_axis_overlap) {
       collision_axis_overlap = overlap;
       collision_axis = axis;
+      polygon_is_behind = range.min + range.max < 2.0 * projection;
     }
   }
 
-  collision_info_t collision = {true, collision_axis};
+  // so that the axis points from the circle to the polygon
+  if (polygon_is_behind) {
+    collision_axis = vec_negate(collision_axis);
+  }
+  projection_range_t range = shape_project(polygon, collision_axis);
+  double depth = vec_dot(center, collision_axis) + radius - range.min;
+  return circle_collision(center, radius, collision_axis, depth);
+}
+
+/**
+ * The first fraction of displacement (between 0 and 1) at which a point
+ * starting at offset from the origin comes within radius of it,
+ * or INFINITY if it never does while approaching.
+ */
+static double sweep_point_circle(vector_t offset, vector_t displacement,
+                                 double radius) {
+  double a = vec_dot(displacement, displacement);
+  double half_b = vec_dot(offset, displacement);
+  double c = vec_dot(offset, offset) - radius * radius;
+  // moving away from the origin (or not at all), so never getting closer
+  if (a == 0 || half_b >= 0) {
+    return INFINITY;
+  }
+  double discriminant = half_b * half_b - a * c;
+  if (discriminant < 0) {
+    return INFINITY;
+  }
+  double toi = (-half_b - sqrt(discriminant)) / a;
+  return toi >= 0 && toi <= 1 ? toi : INFINITY;
+}
+
+double find_circle_toi(vector_t start, vector_t displacement, double radius1,
+                       vector_t center2, double radius2,
+                       collision_info_t *collision) {
+  *collision = find_circle_collision(start, radius1, center2, radius2);
+  if (collision->collided) {
+    return 0;
+  }
+  double toi = sweep_point_circle(vec_subtract(start, center2), displacement,
+                                  radius1 + radius2);
+  if (toi != INFINITY) {
+    vector_t center = vec_add(start, vec_multiply(toi, displacement));
+    vector_t axis = vec_norm(vec_subtract(center2, center));
+    *collision = circle_collision(center, radius1, axis, 0);
+  }
+  return toi;
+}
+
+double find_circle_polygon_toi(vector_t start, vector_t displacement,
+                               double radius, polygon_t *polygon,
+                               collision_info_t *collision) {
+  *collision = find_circle_polygon_collision(start, radius, polygon);
+  if (collision->collided) {
+    return 0;
+  }
+  double toi = INFINITY;
+  vector_t axis = VEC_ZERO;
+  size_t num_vertices = polygon->size;
+  for (size_t i = 0; i < num_vertices; i++) {
+    vector_t vertex = polygon->vertices[i];
+    vector_t edge =
+        vec_subtract(polygon->vertices[(i + 1) % num_vertices], vertex);
+    double length = vec_magnitude(edge);
+    if (length > 0) {
+      // outward, since the vertices are counterclockwise
+      vector_t normal = vec_divide(length, (vector_t){edge.y, -edge.x});
+      double approach = -vec_dot(displacement, normal);
+      if (approach > 0) {
+        double distance =
+            vec_dot(vec_subtract(start, vertex), normal) - radius;
+        double edge_toi = distance / approach;
+        vector_t center = vec_add(start, vec_multiply(edge_toi, displacement));
+        double along = vec_dot(vec_subtract(center, vertex), edge) / length;
+        // the center must cross the pushed out edge itself, not its line
+        if (edge_toi >= 0 && edge_toi < toi && edge_toi <= 1 && along >= 0 &&
+            along <= length) {
+          toi = edge_toi;
+          axis = vec_negate(normal);
+        }
+      }
+    }
+
+    double vertex_toi = sweep_point_circle(vec_subtract(start, vertex),
+                                           displacement, radius);
+    if (vertex_toi < toi) {
+      toi = vertex_toi;
+      vector_t center = vec_add(start, vec_multiply(toi, displacement));
+      axis = vec_norm(vec_subtract(vertex, center));
+    }
+  }
+  if (toi != INFINITY) {
+    vector_t center = vec_add(start, vec_multiply(toi, displacement));
+    *collision = circle_collision(center, radius, axis, 0);
+  }
+  return toi;
+}
+
+// the edge of a polygon whose outward normal is closest to a direction
+static size_t facing_edge(polygon_t *polygon, vector_t direction,
+                          double *alignment) {
+  size_t best = 0;
+  *alignment = -INFINITY;
+  for (size_t i = 0; i < polygon->size; i++) {
+    vector_t edge = vec_subtract(polygon->vertices[(i + 1) % polygon->size],
+                                 polygon->vertices[i]);
+    // outward, since the vertices are counterclockwise
+    double edge_alignment =
+        vec_dot((vector_t){edge.y, -edge.x}, direction) / vec_magnitude(edge);
+    if (edge_alignment > *alignment) {
+      *alignment = edge_alignment;
+      best = i;
+    }
+  }
+  return best;
+}
+
+// keeps the part of a segment where vec_dot(normal, point) >= offset
+static size_t clip_segment(vector_t points[2], vector_t normal,
+                           double offset) {
+  double distance0 = vec_dot(normal, points[0]) - offset;
+  double distance1 = vec_dot(normal, points[1]) - offset;
+  vector_t clipped[2];
+  size_t num_clipped = 0;
+  if (distance0 >= 0) {
+    clipped[num_clipped++] = points[0];
+  }
+  if (distance1 >= 0) {
+    clipped[num_clipped++] = points[1];
+  }
+  if (distance0 * distance1 < 0) {
+    double t = distance0 / (distance0 - distance1);
+    clipped[num_clipped++] =
+        vec_add(points[0], vec_multiply(t, vec_subtract(points[1], points[0])));
+  }
+  points[0] = clipped[0];
+  points[1] = clipped[1];
+  return num_clipped;
+}
+
+void find_polygon_contacts(polygon_t *shape1, polygon_t *shape2,
+                           collision_info_t *collision) {
+  vector_t axis = collision->axis;
+  projection_range_t range1 = shape_project(shape1, axis);
+  projection_range_t range2 = shape_project(shape2, axis);
+  collision->depth = range1.max - range2.min;
+
+  // the reference edge is the facing edge closest to perpendicular to the
+  // axis; preferring shape 1 on ties keeps the contacts from flickering
+  double alignment1, alignment2;
+  size_t edge1 = facing_edge(shape1, axis, &alignment1);
+  size_t edge2 = facing_edge(shape2, vec_negate(axis), &alignment2);
+  polygon_t *reference = shape1;
+  polygon_t *incident = shape2;
+  size_t reference_edge = edge1;
+  if (alignment2 > alignment1 + CONTACT_TOLERANCE) {
+    reference = shape2;
+    incident = shape1;
+    reference_edge = edge2;
+  }
+  vector_t start = reference->vertices[reference_edge];
+  vector_t end = reference->vertices[(reference_edge + 1) % reference->size];
+  vector_t tangent = vec_norm(vec_subtract(end, start));
+  vector_t normal = {tangent.y, -tangent.x};
+
+  double unused;
+  size_t incident_edge = facing_edge(incident, vec_negate(normal), &unused);
+  vector_t points[2] = {
+      incident->vertices[incident_edge],
+      incident->vertices[(incident_edge + 1) % incident->size]};
+
+  // clip the incident edge to the sides of the reference edge,
+  // then keep the points behind the reference edge
+  size_t num_points = 0;
+  if (clip_segment(points, tangent, vec_dot(tangent, start)) == 2 &&
+      clip_segment(points, vec_negate(tangent), -vec_dot(tangent, end)) ==
+          2) {
+    double face = vec_dot(normal, start);
+    for (size_t i = 0; i < 2; i++) {
+      if (vec_dot(normal, points[i]) <=
+          face + CONTACT_TOLERANCE * (1.0 + fabs(face))) {
+        collision->contacts[num_points++] = points[i];
+      }
+    }
+  }
+  if (num_points == 0) {
+    // the shapes only meet at a corner, so use shape 2's deepest vertex
+    size_t deepest = 0;
+    for (size_t i = 1; i < shape2->size; i++) {
+      if (vec_dot(shape2->vertices[i], axis) <
+          vec_dot(shape2->vertices[deepest], axis)) {
+        deepest = i;
+      }
+    }
+    collision->contacts[num_points++] = shape2->vertices[deepest];
+  }
+  collision->num_contacts = num_points;
+}
+
+collision_info_t find_collision(list_t *shape1, list_t *shape2) {
+  // small shapes are copied to the stack, so this doesn't allocate
+  vector_t buffer1[POLY_BUFFER_SIZE];
+  vector_t buffer2[POLY_BUFFER_SIZE];
+  polygon_t polygon1 = poly_from_list_buffer(shape1, buffer1);
+  polygon_t polygon2 = poly_from_list_buffer(shape2, buffer2);
+  collision_info_t collision = find_polygon_collision(&polygon1, &polygon2);
+  poly_release_buffer(&polygon1, buffer1);
+  poly_release_buffer(&polygon2, buffer2);
   return collision;
-}
\ No newline at end of file
+}
+
+bool aabb_overlaps(aabb_t box1, aabb_t box2) {
+  return box1.min.x <= box2.max.x && box2.min.x <= box1.max.x &&
+         box1.min.y <= box2.max.y && box2.min.y <= box1.max.y;
+}
@@ -18,27 +18,11 @@ typedef struct {
   double constant_val;
 } body_aux_t;
 
-typedef struct {
-  body_t *body1;
-  body_t *body2;
-  bool just_collided;
-  collision_handler_t handler;
-  void *handler_aux;
-  free_func_t handler_aux_freer;
-} collision_aux_t;
-
 typedef struct {
   size_t *health;
   bool *was_shot;
 } bullet_aux_t;
 
-static void collision_aux_free(collision_aux_t *aux) {
-  if (aux->handler_aux_freer && aux->handler_aux) {
-    aux->handler_aux_freer(aux->handler_aux);
-  }
-  free(aux);
-}
-
 static void newtonian_gravity_forcer(bodies_aux_t *aux) {
   double G = aux->constant_val;
 
@@ -144,42 +128,10 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
                                  bodies, free);
 }
 
-static void collision_forcer(collision_aux_t *aux) {
-  collision_info_t info = find_collision(body_get_shape_unsafe(aux->body1),
-                                         body_get_shape_unsafe(aux->body2));
-  if (info.collided) {
-    if (!aux->just_collided) {
-      aux->handler(aux->body1, aux->body2, info.axis, aux->handler_aux);
-      aux->just_collided = true;
-    }
-  } else {
-    aux->just_collided = false;
-  }
-  // if (aux->just_collided) {
-  //   aux->just_collided = false;
-  // } else if (info.collided) {
-  //   aux->just_collided = true;
-  //   aux->handler(aux->body1, aux->body2, info.axis, aux->handler_aux);
-  // }
-}
-
 void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       free_func_t freer) {
-  collision_aux_t *collision_aux = malloc_safe(sizeof(collision_aux_t));
-  collision_aux->body1 = body1;
-  collision_aux->body2 = body2;
-  collision_aux->just_collided = false;
-  collision_aux->handler = handler;
-  collision_aux->handler_aux = aux;
-  collision_aux->handler_aux_freer = freer;
-  list_t *bodies = list_init(
-      2, NULL); // do not add freer, because bodies will be free'd by the scene
-  list_add(bodies, body1);
-  list_add(bodies, body2);
-  scene_add_bodies_force_creator(scene, (force_creator_t)collision_forcer,
-                                 collision_aux, bodies,
-                                 (free_func_t)collision_aux_free);
+  scene_add_collision(scene, body1, body2, handler, aux, freer);
 }
 
 static void destructive_collision_handler(body_t *body1, body_t *body2,
@@ -211,6 +163,17 @@ void create_bullet_tank_collision(scene_t *scene, body_t *tank, body_t *bullet,
                    free);
 }
 
+void create_bullet_tank_collision_rule(scene_t *scene, const char *tank_type,
+                                       const char *bullet_type, size_t *health,
+                                       bool *was_shot) {
+  bullet_aux_t *aux = malloc_safe(sizeof(bullet_aux_t));
+  aux->health = health;
+  aux->was_shot = was_shot;
+  scene_add_collision_rule(scene, tank_type, bullet_type,
+                           (collision_handler_t)bullet_tank_collision_handler,
+                           aux, free);
+}
+
 static void bullet_obstacle_collision_handler(body_t *tank, body_t *bullet,
                                               vector_t axis,
                                               bullet_aux_t *aux) {
@@ -225,6 +188,14 @@ void create_bullet_obstacle_collision(scene_t *scene, body_t *tank,
                    free);
 }
 
+void create_bullet_obstacle_collision_rule(scene_t *scene,
+                                           const char *obstacle_type,
+                                           const char *bullet_type) {
+  scene_add_collision_rule(
+      scene, obstacle_type, bullet_type,
+      (collision_handler_t)bullet_obstacle_collision_handler, NULL, NULL);
+}
+
 void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                const double *elasticity) {
   double ua = vec_dot(body_get_velocity(body1), axis);
@@ -247,18 +218,47 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
   body_add_impulse(body2, vec_negate(impulse));
 }
 
+typedef struct {
+  scene_t *scene;
+  double elasticity;
+} physics_aux_t;
+
+// leaves the impulses to the scene's contact solver
+static void physics_contact_handler(body_t *body1, body_t *body2,
+                                    const collision_info_t *collision,
+                                    physics_aux_t *aux) {
+  scene_add_solver_contact(aux->scene, body1, body2, collision,
+                           aux->elasticity);
+}
+
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1,
                               body_t *body2) {
-  double *elasticity_aux = malloc_safe(sizeof(double));
-  *elasticity_aux = elasticity;
-  create_collision(scene, body1, body2,
-                   (collision_handler_t)physics_collision_handler,
-                   elasticity_aux, free);
+  physics_aux_t *aux = malloc_safe(sizeof(physics_aux_t));
+  *aux = (physics_aux_t){scene, elasticity};
+  scene_add_contact(scene, body1, body2,
+                    (contact_handler_t)physics_contact_handler, aux, free);
 }
 
+void create_physics_collision_rule(scene_t *scene, double elasticity,
+                                   const char *type1, const char *type2) {
+  physics_aux_t *aux = malloc_safe(sizeof(physics_aux_t));
+  *aux = (physics_aux_t){scene, elasticity};
+  scene_add_contact_rule(scene, type1, type2,
+                         (contact_handler_t)physics_contact_handler, aux,
+                         free);
+}
 
 void bullet_collision_handler(body_t *bullet, body_t *wall, vector_t axis,
                                const double *elasticity) {
+  // the sweep follows the bullet's path over the whole tick, so it can
+  // report an impact while the bullet is already moving away from the wall
+  // along the axis (e.g. an impulse this tick turned it around);
+  // bouncing then would push it back into the wall
+  vector_t relative_velocity =
+      vec_subtract(body_get_velocity(bullet), body_get_velocity(wall));
+  if (vec_dot(relative_velocity, axis) <= 0) {
+    return;
+  }
   *(size_t*)bullet->info += 1;
   if(*(size_t*)bullet->info > MAX_BULLET_BOUNCES){
     body_remove(bullet);
@@ -275,3 +275,12 @@ void create_bullet_wall_collision(scene_t *scene, double elasticity, body_t *bul
                    elasticity_aux, free);
 }
 
+void create_bullet_wall_collision_rule(scene_t *scene, double elasticity,
+                                       const char *bullet_type,
+                                       const char *wall_type) {
+  double *elasticity_aux = malloc_safe(sizeof(double));
+  *elasticity_aux = elasticity;
+  scene_add_collision_rule(scene, bullet_type, wall_type,
+                           (collision_handler_t)bullet_collision_handler,
+                           elasticity_aux, free);
+}
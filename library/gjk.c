@@ -0,0 +1,374 @@
+#include <gjk.h>
+#include <math.h>
+#include <stdlib.h>
+#include <util.h>
+#include <vector.h>
+
+// extra iterations GJK may take beyond the number of vertices; only
+// reached when rounding makes it cycle, which only happens when touching
+static const size_t MAX_GJK_EXTRA_ITERATIONS = 32;
+// EPA stops once expanding the polytope gains less than this (relative)
+static const double EPA_TOLERANCE = 1e-9;
+// polytopes up to this size are kept on the stack
+#define EPA_STACK_CAPACITY 32
+
+// a vertex of the Minkowski difference shape1 - shape2
+typedef struct {
+  vector_t point;
+  size_t index1;
+  size_t index2;
+} support_point_t;
+
+// the index of the vertex of a shape farthest along a direction
+static size_t support_index(polygon_t *shape, vector_t direction) {
+  size_t best = 0;
+  double best_projection = -INFINITY;
+  for (size_t i = 0; i < shape->size; i++) {
+    double projection = vec_dot(shape->vertices[i], direction);
+    if (projection > best_projection) {
+      best_projection = projection;
+      best = i;
+    }
+  }
+  return best;
+}
+
+static support_point_t make_support_point(polygon_t *shape1, polygon_t *shape2,
+                                          size_t index1, size_t index2) {
+  vector_t point =
+      vec_subtract(shape1->vertices[index1], shape2->vertices[index2]);
+  return (support_point_t){point, index1, index2};
+}
+
+// the vertex of the Minkowski difference farthest along a direction
+static support_point_t minkowski_support(polygon_t *shape1, polygon_t *shape2,
+                                         vector_t direction) {
+  return make_support_point(shape1, shape2, support_index(shape1, direction),
+                            support_index(shape2, vec_negate(direction)));
+}
+
+/**
+ * The direction from the line through a and b towards the origin,
+ * or VEC_ZERO if the origin is on the line.
+ */
+static vector_t segment_direction(vector_t a, vector_t b) {
+  vector_t normal = vec_perpendicular(vec_subtract(b, a));
+  double side = vec_dot(normal, a);
+  if (side > 0) {
+    return vec_negate(normal);
+  } else if (side < 0) {
+    return normal;
+  }
+  return VEC_ZERO;
+}
+
+static vector_t reduce_segment(support_point_t *simplex, size_t *size) {
+  vector_t a = simplex[0].point;
+  vector_t b = simplex[1].point;
+  vector_t edge = vec_subtract(b, a);
+  if (vec_dot(a, edge) >= 0) {
+    *size = 1;
+    return vec_negate(a);
+  }
+  if (vec_dot(b, edge) <= 0) {
+    simplex[0] = simplex[1];
+    *size = 1;
+    return vec_negate(b);
+  }
+  return segment_direction(a, b);
+}
+
+static vector_t reduce_triangle(support_point_t *simplex, size_t *size) {
+  vector_t a = simplex[0].point;
+  vector_t b = simplex[1].point;
+  vector_t c = simplex[2].point;
+  vector_t ab = vec_subtract(b, a);
+  vector_t ac = vec_subtract(c, a);
+  vector_t bc = vec_subtract(c, b);
+  // the sign of each barycentric coordinate of the closest point
+  // on each edge, and on the triangle
+  double ab_a = -vec_dot(a, ab), ab_b = vec_dot(b, ab);
+  double ac_a = -vec_dot(a, ac), ac_c = vec_dot(c, ac);
+  double bc_b = -vec_dot(b, bc), bc_c = vec_dot(c, bc);
+  double area = vec_cross(ab, ac);
+  double abc_a = area * vec_cross(b, c);
+  double abc_b = area * vec_cross(c, a);
+  double abc_c = area * vec_cross(a, b);
+
+  if (ab_a <= 0 && ac_a <= 0) {
+    *size = 1;
+    return vec_negate(a);
+  }
+  if (ab_b > 0 && ab_a > 0 && abc_c <= 0) {
+    *size = 2;
+    return segment_direction(a, b);
+  }
+  if (ac_c > 0 && ac_a > 0 && abc_b <= 0) {
+    simplex[1] = simplex[2];
+    *size = 2;
+    return segment_direction(a, c);
+  }
+  if (ab_b <= 0 && bc_b <= 0) {
+    simplex[0] = simplex[1];
+    *size = 1;
+    return vec_negate(b);
+  }
+  if (ac_c <= 0 && bc_c <= 0) {
+    simplex[0] = simplex[2];
+    *size = 1;
+    return vec_negate(c);
+  }
+  if (bc_c > 0 && bc_b > 0 && abc_a <= 0) {
+    simplex[0] = simplex[1];
+    simplex[1] = simplex[2];
+    *size = 2;
+    return segment_direction(b, c);
+  }
+  // the origin is inside the triangle
+  return VEC_ZERO;
+}
+
+/**
+ * Reduces the simplex to the vertices of its feature closest to the origin.
+ * Works for any simplex, not only ones built by GJK, so a cached
+ * simplex from a previous tick is a valid starting point.
+ *
+ * @return the direction from that feature towards the origin,
+ *   or VEC_ZERO if the simplex contains the origin
+ */
+static vector_t simplex_reduce(support_point_t *simplex, size_t *size) {
+  switch (*size) {
+  case 1:
+    return vec_negate(simplex[0].point);
+  case 2:
+    return reduce_segment(simplex, size);
+  default:
+    return reduce_triangle(simplex, size);
+  }
+}
+
+// whether the origin is in the Minkowski difference, i.e. the shapes overlap
+static bool gjk_overlaps(polygon_t *shape1, polygon_t *shape2,
+                         support_point_t *simplex, size_t *size) {
+  size_t max_iterations =
+      shape1->size + shape2->size + MAX_GJK_EXTRA_ITERATIONS;
+  for (size_t i = 0; i < max_iterations; i++) {
+    vector_t direction = simplex_reduce(simplex, size);
+    if (direction.x == 0.0 && direction.y == 0.0) {
+      return true;
+    }
+    support_point_t support = minkowski_support(shape1, shape2, direction);
+    if (vec_dot(support.point, direction) < 0) {
+      // direction is a separating axis
+      return false;
+    }
+    simplex[(*size)++] = support;
+  }
+  // only cycles when the shapes are just touching
+  return true;
+}
+
+/**
+ * Expands a simplex containing the origin into a triangle around it.
+ * Returns false if the Minkowski difference has no area
+ * (one of the shapes is degenerate).
+ */
+static bool epa_make_triangle(polygon_t *shape1, polygon_t *shape2,
+                              support_point_t *simplex, size_t size) {
+  static const vector_t DIRECTIONS[] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+  for (size_t i = 0; size == 1 && i < 4; i++) {
+    support_point_t support = minkowski_support(shape1, shape2, DIRECTIONS[i]);
+    vector_t offset = vec_subtract(support.point, simplex[0].point);
+    if (offset.x != 0.0 || offset.y != 0.0) {
+      simplex[size++] = support;
+    }
+  }
+  if (size == 2) {
+    vector_t a = simplex[0].point;
+    vector_t normal = vec_perpendicular(vec_subtract(simplex[1].point, a));
+    for (int side = 0; side < 2 && size == 2; side++) {
+      support_point_t support = minkowski_support(shape1, shape2, normal);
+      if (vec_dot(vec_subtract(support.point, a), normal) > 0) {
+        simplex[size++] = support;
+      }
+      normal = vec_negate(normal);
+    }
+  }
+  return size == 3;
+}
+
+// a vertex of the EPA polytope, and the edge from it to the next vertex
+typedef struct {
+  vector_t point;
+  // the edge's outward unit normal, and its distance from the origin
+  vector_t normal;
+  double distance;
+} polytope_vertex_t;
+
+static void polytope_update_edge(polytope_vertex_t *polytope, size_t size,
+                                 size_t index) {
+  vector_t a = polytope[index].point;
+  vector_t edge = vec_subtract(polytope[(index + 1) % size].point, a);
+  // the polytope is counterclockwise, so this normal points outwards
+  vector_t normal = vec_norm((vector_t){edge.y, -edge.x});
+  polytope[index].normal = normal;
+  polytope[index].distance = vec_dot(normal, a);
+}
+
+static void polytope_remove(polytope_vertex_t *polytope, size_t *size,
+                            size_t index) {
+  for (size_t i = index; i + 1 < *size; i++) {
+    polytope[i] = polytope[i + 1];
+  }
+  (*size)--;
+}
+
+// whether the polytope turns clockwise (or not at all) at b
+static bool is_reflex(vector_t a, vector_t b, vector_t c) {
+  return vec_cross(vec_subtract(b, a), vec_subtract(c, b)) <= 0;
+}
+
+/**
+ * Inserts a vertex of the Minkowski difference after an edge's first vertex.
+ * The starting simplex's vertices need not be on the Minkowski difference's
+ * boundary (e.g. a cached simplex after the shapes have moved), so drop any
+ * vertices the new one makes reflex, keeping the polytope convex.
+ * Dropping a vertex only grows the polytope, so it still contains the origin.
+ */
+static void polytope_insert(polytope_vertex_t *polytope, size_t *size,
+                            size_t edge, vector_t point) {
+  size_t inserted = edge + 1;
+  for (size_t i = *size; i > inserted; i--) {
+    polytope[i] = polytope[i - 1];
+  }
+  polytope[inserted].point = point;
+  (*size)++;
+
+  while (*size > 3) {
+    size_t prev = (inserted + *size - 1) % *size;
+    size_t prev2 = (inserted + *size - 2) % *size;
+    if (!is_reflex(polytope[prev2].point, polytope[prev].point, point)) {
+      break;
+    }
+    polytope_remove(polytope, size, prev);
+    if (prev < inserted) {
+      inserted--;
+    }
+  }
+  while (*size > 3) {
+    size_t next = (inserted + 1) % *size;
+    size_t next2 = (inserted + 2) % *size;
+    if (!is_reflex(point, polytope[next].point, polytope[next2].point)) {
+      break;
+    }
+    polytope_remove(polytope, size, next);
+    if (next < inserted) {
+      inserted--;
+    }
+  }
+  // only the edges on either side of the new vertex changed
+  polytope_update_edge(polytope, *size, (inserted + *size - 1) % *size);
+  polytope_update_edge(polytope, *size, inserted);
+}
+
+/**
+ * Finds the edge of the Minkowski difference closest to the origin,
+ * starting from a simplex containing the origin.
+ * Its outward normal is the direction to move shape2 to separate it from
+ * shape1 by the least distance, which is the collision axis.
+ */
+static collision_info_t epa(polygon_t *shape1, polygon_t *shape2,
+                            support_point_t *simplex, size_t size) {
+  if (!epa_make_triangle(shape1, shape2, simplex, size)) {
+    return find_polygon_collision(shape1, shape2);
+  }
+
+  // the polytope's vertices are all vertices of the Minkowski difference,
+  // which has at most as many vertices as the two shapes combined
+  size_t capacity = shape1->size + shape2->size + 3;
+  polytope_vertex_t stack_polytope[EPA_STACK_CAPACITY];
+  polytope_vertex_t *polytope =
+      capacity <= EPA_STACK_CAPACITY
+          ? stack_polytope
+          : malloc_safe(capacity * sizeof(polytope_vertex_t));
+  size_t polytope_size = 3;
+  polytope[0].point = simplex[0].point;
+  polytope[1].point = simplex[1].point;
+  polytope[2].point = simplex[2].point;
+  // keep the vertices counterclockwise, so edge normals point outwards
+  if (vec_cross(vec_subtract(simplex[1].point, simplex[0].point),
+                vec_subtract(simplex[2].point, simplex[0].point)) < 0) {
+    polytope[1].point = simplex[2].point;
+    polytope[2].point = simplex[1].point;
+  }
+  for (size_t i = 0; i < polytope_size; i++) {
+    polytope_update_edge(polytope, polytope_size, i);
+  }
+
+  vector_t axis;
+  while (true) {
+    size_t closest_edge = 0;
+    for (size_t i = 1; i < polytope_size; i++) {
+      if (polytope[i].distance < polytope[closest_edge].distance) {
+        closest_edge = i;
+      }
+    }
+    axis = polytope[closest_edge].normal;
+
+    vector_t support = minkowski_support(shape1, shape2, axis).point;
+    double support_distance = vec_dot(support, axis);
+    if (support_distance - polytope[closest_edge].distance <=
+            EPA_TOLERANCE * (1.0 + fabs(support_distance)) ||
+        polytope_size == capacity) {
+      break;
+    }
+    polytope_insert(polytope, &polytope_size, closest_edge, support);
+  }
+
+  if (polytope != stack_polytope) {
+    free(polytope);
+  }
+  collision_info_t collision = {true, axis};
+  find_polygon_contacts(shape1, shape2, &collision);
+  return collision;
+}
+
+collision_info_t find_gjk_collision(polygon_t *shape1, polygon_t *shape2) {
+  return find_gjk_collision_cached(shape1, shape2, NULL);
+}
+
+collision_info_t find_gjk_collision_cached(polygon_t *shape1,
+                                          polygon_t *shape2,
+                                          gjk_simplex_t *simplex_cache) {
+  support_point_t simplex[3];
+  size_t size = 0;
+  if (simplex_cache) {
+    for (size_t i = 0; i < simplex_cache->size; i++) {
+      size_t index1 = simplex_cache->indices1[i];
+      size_t index2 = simplex_cache->indices2[i];
+      // the cache may come from other shapes if the caller swapped them
+      if (index1 >= shape1->size || index2 >= shape2->size) {
+        size = 0;
+        break;
+      }
+      simplex[size++] = make_support_point(shape1, shape2, index1, index2);
+    }
+  }
+  if (size == 0) {
+    simplex[size++] = make_support_point(shape1, shape2, 0, 0);
+  }
+
+  bool overlaps = gjk_overlaps(shape1, shape2, simplex, &size);
+  if (simplex_cache) {
+    simplex_cache->size = size;
+    for (size_t i = 0; i < size; i++) {
+      simplex_cache->indices1[i] = simplex[i].index1;
+      simplex_cache->indices2[i] = simplex[i].index2;
+    }
+  }
+  if (!overlaps) {
+    collision_info_t no_collision = {false, VEC_ZERO};
+    return no_collision;
+  }
+  return epa(shape1, shape2, simplex, size);
+}
@@ -0,0 +1,293 @@
+#include <assert.h>
+#include <integration.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+// AVX2 is compiled in per function, so the rest of the library
+// still runs on any x86-64 CPU; it is only used if the CPU supports it
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/**
+ * Integrates the bodies of a batch from slot start onwards.
+ * The displacement is step * (new_vel + old_weight * vel), which covers
+ * both integrators without a branch (see integrator_step()).
+ */
+typedef void (*integrate_kernel_t)(integration_batch_t *batch, size_t start,
+                                   double dt, double step, double old_weight);
+
+static integration_impl_t current_impl;
+static bool impl_chosen = false;
+
+// Multiplying by 1 and adding are exact, so the Verlet displacement is
+// the same as averaging the velocities and scaling by dt
+static double integrator_step(integrator_t integrator, double dt) {
+  return integrator == INTEGRATOR_VERLET ? 0.5 * dt : dt;
+}
+
+static double integrator_old_weight(integrator_t integrator) {
+  return integrator == INTEGRATOR_VERLET ? 1.0 : 0.0;
+}
+
+vector_t integrator_displacement(integrator_t integrator, vector_t vel,
+                                 vector_t new_vel, double dt) {
+  double step = integrator_step(integrator, dt);
+  double old_weight = integrator_old_weight(integrator);
+  return (vector_t){step * (new_vel.x + old_weight * vel.x),
+                    step * (new_vel.y + old_weight * vel.y)};
+}
+
+// the arithmetic every kernel does, in the same order, so they all round
+// alike; this matches body_tick() too
+static void integrate_scalar(integration_batch_t *batch, size_t start,
+                             double dt, double step, double old_weight) {
+  for (size_t i = start; i < batch->size; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    double mass = batch->mass[i];
+    vector_t vel = batch->vel[i];
+    vector_t force = batch->net_force[i];
+    vector_t impulse = batch->net_impulse[i];
+    vector_t new_vel = {(vel.x + dt * (force.x / mass)) + impulse.x / mass,
+                        (vel.y + dt * (force.y / mass)) + impulse.y / mass};
+    vector_t dx = {step * (new_vel.x + old_weight * vel.x),
+                   step * (new_vel.y + old_weight * vel.y)};
+    double d_theta = dt * batch->angular_vel[i];
+
+    batch->pos[i].x += dx.x;
+    batch->pos[i].y += dx.y;
+    batch->vel[i] = new_vel;
+    batch->net_force[i] = VEC_ZERO;
+    batch->net_impulse[i] = VEC_ZERO;
+    batch->angle[i] += d_theta;
+    if (dx.x != 0.0 || dx.y != 0.0 || d_theta != 0.0) {
+      batch->moved[i] = true;
+    }
+  }
+}
+
+// spreads the low bits of bits into the bytes of a word, one bit per byte,
+// so several bool flags can be updated with one write
+static uint32_t bits_to_bools(int bits) {
+  // the 1 << 7k term moves bit k to bit 8k; every other term misses the mask
+  return ((uint32_t)bits * 0x00204081u) & 0x01010101u;
+}
+
+#ifdef HAVE_SSE2
+static __m128d sse2_select(__m128d mask, __m128d if_set, __m128d if_clear) {
+  return _mm_or_pd(_mm_and_pd(mask, if_set), _mm_andnot_pd(mask, if_clear));
+}
+
+// two bodies per pass, so their masses, angles, and flags fill a register
+static void integrate_sse2(integration_batch_t *batch, size_t start,
+                           double dt, double step, double old_weight) {
+  const double *mass = batch->mass;
+  double *vel = &batch->vel[0].x;
+  double *pos = &batch->pos[0].x;
+  const double *angular_vel = batch->angular_vel;
+  double *angle = batch->angle;
+  double *net_force = &batch->net_force[0].x;
+  double *net_impulse = &batch->net_impulse[0].x;
+  __m128d dts = _mm_set1_pd(dt);
+  __m128d steps = _mm_set1_pd(step);
+  __m128d old_weights = _mm_set1_pd(old_weight);
+  __m128i zero = _mm_setzero_si128();
+  size_t i = start;
+  for (; i + 2 <= batch->size; i += 2) {
+    // the two active flags, widened to all ones or all zeros per body
+    uint16_t active_bytes;
+    memcpy(&active_bytes, &batch->active[i], sizeof(active_bytes));
+    __m128i active = _mm_cvtsi32_si128(active_bytes);
+    active = _mm_unpacklo_epi8(active, zero);
+    active = _mm_unpacklo_epi16(active, zero);
+    active = _mm_unpacklo_epi32(active, zero);
+    __m128d masks = _mm_castsi128_pd(_mm_sub_epi64(zero, active));
+    __m128d masses = _mm_loadu_pd(&mass[i]);
+
+    // each body's x and y share a register
+    int moved_bits = 0;
+    for (size_t k = 0; k < 2; k++) {
+      size_t lane = 2 * (i + k);
+      __m128d mask = k == 0 ? _mm_unpacklo_pd(masks, masks)
+                            : _mm_unpackhi_pd(masks, masks);
+      __m128d body_mass = k == 0 ? _mm_unpacklo_pd(masses, masses)
+                                 : _mm_unpackhi_pd(masses, masses);
+      __m128d v = _mm_loadu_pd(&vel[lane]);
+      __m128d force = _mm_loadu_pd(&net_force[lane]);
+      __m128d impulse = _mm_loadu_pd(&net_impulse[lane]);
+      __m128d new_v = _mm_add_pd(
+          _mm_add_pd(v, _mm_mul_pd(dts, _mm_div_pd(force, body_mass))),
+          _mm_div_pd(impulse, body_mass));
+      __m128d dx =
+          _mm_mul_pd(steps, _mm_add_pd(new_v, _mm_mul_pd(old_weights, v)));
+
+      __m128d p = _mm_loadu_pd(&pos[lane]);
+      _mm_storeu_pd(&pos[lane], sse2_select(mask, _mm_add_pd(p, dx), p));
+      _mm_storeu_pd(&vel[lane], sse2_select(mask, new_v, v));
+      _mm_storeu_pd(&net_force[lane], _mm_andnot_pd(mask, force));
+      _mm_storeu_pd(&net_impulse[lane], _mm_andnot_pd(mask, impulse));
+      int bits = _mm_movemask_pd(
+          _mm_and_pd(mask, _mm_cmpneq_pd(dx, _mm_setzero_pd())));
+      moved_bits |= (bits != 0) << k;
+    }
+
+    __m128d a = _mm_loadu_pd(&angle[i]);
+    __m128d d_theta =
+        _mm_and_pd(masks, _mm_mul_pd(dts, _mm_loadu_pd(&angular_vel[i])));
+    _mm_storeu_pd(&angle[i], sse2_select(masks, _mm_add_pd(a, d_theta), a));
+    moved_bits |= _mm_movemask_pd(_mm_cmpneq_pd(d_theta, _mm_setzero_pd()));
+
+    uint16_t moved;
+    memcpy(&moved, &batch->moved[i], sizeof(moved));
+    moved |= (uint16_t)bits_to_bools(moved_bits);
+    memcpy(&batch->moved[i], &moved, sizeof(moved));
+  }
+  integrate_scalar(batch, i, dt, step, old_weight);
+}
+#endif
+
+#ifdef HAVE_AVX2
+// four bodies per pass, so their masses, angles, and flags fill a register
+TARGET_AVX2
+static void integrate_avx2(integration_batch_t *batch, size_t start,
+                           double dt, double step, double old_weight) {
+  const double *mass = batch->mass;
+  double *vel = &batch->vel[0].x;
+  double *pos = &batch->pos[0].x;
+  const double *angular_vel = batch->angular_vel;
+  double *angle = batch->angle;
+  double *net_force = &batch->net_force[0].x;
+  double *net_impulse = &batch->net_impulse[0].x;
+  __m256d dts = _mm256_set1_pd(dt);
+  __m256d steps = _mm256_set1_pd(step);
+  __m256d old_weights = _mm256_set1_pd(old_weight);
+  size_t i = start;
+  for (; i + 4 <= batch->size; i += 4) {
+    // the four active flags, widened to all ones or all zeros per body
+    uint32_t active_bytes;
+    memcpy(&active_bytes, &batch->active[i], sizeof(active_bytes));
+    __m256i active = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(active_bytes));
+    __m256d masks = _mm256_castsi256_pd(
+        _mm256_sub_epi64(_mm256_setzero_si256(), active));
+    __m256d masses = _mm256_loadu_pd(&mass[i]);
+
+    // two bodies' x and y share a register, as (x0, y0, x1, y1)
+    int moved_bits = 0;
+    for (size_t k = 0; k < 2; k++) {
+      size_t lane = 2 * (i + 2 * k);
+      // (0, 0, 1, 1) for the first pair, and (2, 2, 3, 3) for the second
+      __m256d mask = k == 0 ? _mm256_permute4x64_pd(masks, 0x50)
+                            : _mm256_permute4x64_pd(masks, 0xfa);
+      __m256d pair_mass = k == 0 ? _mm256_permute4x64_pd(masses, 0x50)
+                                 : _mm256_permute4x64_pd(masses, 0xfa);
+      __m256d v = _mm256_loadu_pd(&vel[lane]);
+      __m256d force = _mm256_loadu_pd(&net_force[lane]);
+      __m256d impulse = _mm256_loadu_pd(&net_impulse[lane]);
+      // separate multiplies and adds, not FMAs, to round like the others
+      __m256d new_v = _mm256_add_pd(
+          _mm256_add_pd(v,
+                        _mm256_mul_pd(dts, _mm256_div_pd(force, pair_mass))),
+          _mm256_div_pd(impulse, pair_mass));
+      __m256d dx = _mm256_mul_pd(
+          steps, _mm256_add_pd(new_v, _mm256_mul_pd(old_weights, v)));
+
+      __m256d p = _mm256_loadu_pd(&pos[lane]);
+      _mm256_storeu_pd(&pos[lane],
+                       _mm256_blendv_pd(p, _mm256_add_pd(p, dx), mask));
+      _mm256_storeu_pd(&vel[lane], _mm256_blendv_pd(v, new_v, mask));
+      _mm256_storeu_pd(&net_force[lane], _mm256_andnot_pd(mask, force));
+      _mm256_storeu_pd(&net_impulse[lane], _mm256_andnot_pd(mask, impulse));
+      __m256d nonzero = _mm256_and_pd(
+          mask, _mm256_cmp_pd(dx, _mm256_setzero_pd(), _CMP_NEQ_UQ));
+      int bits = _mm256_movemask_pd(nonzero);
+      moved_bits |= ((bits & 3) != 0) << (2 * k);
+      moved_bits |= ((bits & 12) != 0) << (2 * k + 1);
+    }
+
+    __m256d a = _mm256_loadu_pd(&angle[i]);
+    __m256d d_theta = _mm256_and_pd(
+        masks, _mm256_mul_pd(dts, _mm256_loadu_pd(&angular_vel[i])));
+    _mm256_storeu_pd(&angle[i],
+                     _mm256_blendv_pd(a, _mm256_add_pd(a, d_theta), masks));
+    moved_bits |= _mm256_movemask_pd(
+        _mm256_cmp_pd(d_theta, _mm256_setzero_pd(), _CMP_NEQ_UQ));
+
+    uint32_t moved;
+    memcpy(&moved, &batch->moved[i], sizeof(moved));
+    moved |= bits_to_bools(moved_bits);
+    memcpy(&batch->moved[i], &moved, sizeof(moved));
+  }
+  integrate_scalar(batch, i, dt, step, old_weight);
+}
+#endif
+
+bool integration_impl_supported(integration_impl_t impl) {
+  switch (impl) {
+  case INTEGRATION_SCALAR:
+    return true;
+  case INTEGRATION_SSE2:
+#ifdef HAVE_SSE2
+    return true;
+#else
+    return false;
+#endif
+  case INTEGRATION_AVX2:
+#ifdef HAVE_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+integration_impl_t integration_get_impl(void) {
+  if (!impl_chosen) {
+    if (integration_impl_supported(INTEGRATION_AVX2)) {
+      current_impl = INTEGRATION_AVX2;
+    } else if (integration_impl_supported(INTEGRATION_SSE2)) {
+      current_impl = INTEGRATION_SSE2;
+    } else {
+      current_impl = INTEGRATION_SCALAR;
+    }
+    impl_chosen = true;
+  }
+  return current_impl;
+}
+
+void integration_set_impl(integration_impl_t impl) {
+  assert(integration_impl_supported(impl));
+  current_impl = impl;
+  impl_chosen = true;
+}
+
+static integrate_kernel_t get_kernel(void) {
+  switch (integration_get_impl()) {
+#ifdef HAVE_AVX2
+  case INTEGRATION_AVX2:
+    return integrate_avx2;
+#endif
+#ifdef HAVE_SSE2
+  case INTEGRATION_SSE2:
+    return integrate_sse2;
+#endif
+  default:
+    return integrate_scalar;
+  }
+}
+
+void integrate_batch(integration_batch_t *batch, integrator_t integrator,
+                     double dt) {
+  get_kernel()(batch, 0, dt, integrator_step(integrator, dt),
+               integrator_old_weight(integrator));
+}
@@ -21,37 +21,41 @@ void map_add_walls(scene_t *scene, vector_t screen_size) {
   // Top wall
   vector_t top_wall_centroid = {
       .x = screen_size.x / 2, .y = screen_size.y + EXTERIOR_WALL_THICKNESS / 2};
-  body_t *top_wall = body_init_with_info(
+  body_t *top_wall = body_init_with_polygon(
       shape_rectangle((vector_t){screen_size.x, EXTERIOR_WALL_THICKNESS}),
       INFINITY, WALL_COLOR, BODY_TYPE_WALL);
   body_set_centroid(top_wall, top_wall_centroid);
+  body_set_static(top_wall);
   scene_add_body(scene, top_wall);
 
   // Bottom wall
   vector_t bottom_wall_centroid = {.x = screen_size.x / 2,
                                    .y = -EXTERIOR_WALL_THICKNESS / 2};
-  body_t *bottom_wall = body_init_with_info(
+  body_t *bottom_wall = body_init_with_polygon(
       shape_rectangle((vector_t){screen_size.x, EXTERIOR_WALL_THICKNESS}),
       INFINITY, WALL_COLOR, BODY_TYPE_WALL);
   body_set_centroid(bottom_wall, bottom_wall_centroid);
+  body_set_static(bottom_wall);
   scene_add_body(scene, bottom_wall);
 
   // Left wall
   vector_t left_wall_centroid = {.x = -EXTERIOR_WALL_THICKNESS / 2,
                                  .y = screen_size.y / 2};
-  body_t *left_wall = body_init_with_info(
+  body_t *left_wall = body_init_with_polygon(
       shape_rectangle((vector_t){EXTERIOR_WALL_THICKNESS, screen_size.y}),
       INFINITY, WALL_COLOR, BODY_TYPE_WALL);
   body_set_centroid(left_wall, left_wall_centroid);
+  body_set_static(left_wall);
   scene_add_body(scene, left_wall);
 
   // Right wall
   vector_t right_wall_centroid = {
       .x = screen_size.x + EXTERIOR_WALL_THICKNESS / 2, .y = screen_size.y / 2};
-  body_t *right_wall = body_init_with_info(
+  body_t *right_wall = body_init_with_polygon(
       shape_rectangle((vector_t){EXTERIOR_WALL_THICKNESS, screen_size.y}),
       INFINITY, WALL_COLOR, BODY_TYPE_WALL);
   body_set_centroid(right_wall, right_wall_centroid);
+  body_set_static(right_wall);
   scene_add_body(scene, right_wall);
 
   vector_t wall_positions[] = {
@@ -70,7 +74,7 @@ void map_add_walls(scene_t *scene, vector_t screen_size) {
 
   // Generate walls
   for (size_t i = 0; i < NUM_INTERIOR_WALLS; i++) {
-    body_t *interior_wall = body_init_with_info(
+    body_t *interior_wall = body_init_with_polygon(
         shape_rectangle(wall_sizes[i]), INFINITY, WALL_COLOR, BODY_TYPE_WALL);
     if (wall_sizes[i].y == LARGE_INTERIOR_WALL_SIZE.y) {
         body_set_image(interior_wall, "wall_large", 1.0);
@@ -82,23 +86,29 @@ void map_add_walls(scene_t *scene, vector_t screen_size) {
 
     body_set_rotation(interior_wall, horizontal[i] ? (PI / 2.0) : 0.0);
 
+    body_set_static(interior_wall);
     scene_add_body(scene, interior_wall);
   }
 }
 
 
-static bool obstacle_collides (body_t *obstacle, scene_t *scene) {
-    size_t num_bodies = scene_bodies(scene);
-    for (size_t i = 0; i < num_bodies; i++) {
-      body_t *body = scene_get_body(scene, i);
-      if (body != obstacle) {
-        collision_info_t collision = body_collide(obstacle, body);
-        if (collision.collided) {
-          return true;
-        }
-      }
+typedef struct {
+    body_t *obstacle;
+    bool collides;
+} overlap_aux_t;
+
+static void check_overlap (body_t *body, overlap_aux_t *aux) {
+    if (body != aux->obstacle && !aux->collides) {
+        aux->collides = body_collide(aux->obstacle, body).collided;
     }
-    return false;
+}
+
+// only the bodies near the obstacle are tested, using the scene's broad phase
+static bool obstacle_collides (body_t *obstacle, scene_t *scene) {
+    overlap_aux_t aux = {obstacle, false};
+    scene_query_aabb(scene, body_get_aabb(obstacle), NULL,
+                     (scene_query_func_t)check_overlap, &aux);
+    return aux.collides;
 }
 
 static void move_obstacle_to_random_point (body_t *obstacle, vector_t screen_size) {
@@ -110,8 +120,8 @@ static void move_obstacle_to_random_point (body_t *obstacle, vector_t screen_siz
 void map_init_obstacles(scene_t *scene, vector_t screen_size, size_t num_obstacles) {
     for (size_t i = 0; i < NUM_OBSTACLES; i ++) {
         body_t *obstacle =
-        body_init_with_info(shape_rectangle(OBSTACLE_SIZE), OBSTACLE_MASS,
-                            COLOR_WHITE, BODY_TYPE_OBSTACLE);
+        body_init_with_polygon(shape_rectangle(OBSTACLE_SIZE), OBSTACLE_MASS,
+                               COLOR_WHITE, BODY_TYPE_OBSTACLE);
         const char *barricadeImages[] = {"barricadeWood", "barricadeMetal", "crateWood"};
         const char *barricadeImage = barricadeImages[rand() % 3];
         body_set_image(obstacle, barricadeImage, 0.5);
@@ -123,14 +133,12 @@ void map_init_obstacles(scene_t *scene, vector_t screen_size, size_t num_obstacl
 }
 
 void map_reset_obstacles(scene_t *scene, vector_t screen_size, size_t num_obstacles) {
-    size_t num_bodies = scene_bodies(scene);
+    size_t num_bodies = scene_type_bodies(scene, BODY_TYPE_OBSTACLE);
     for (size_t i = 0; i < num_bodies; i++) {
-        body_t *body = scene_get_body(scene, i);
-        if (body->type == BODY_TYPE_OBSTACLE) {
+        body_t *body = scene_get_type_body(scene, BODY_TYPE_OBSTACLE, i);
+        move_obstacle_to_random_point(body, screen_size);
+        while (obstacle_collides(body, scene)) {
             move_obstacle_to_random_point(body, screen_size);
-            while (obstacle_collides(body, scene)) {
-                move_obstacle_to_random_point(body, screen_size);
-            }
         }
     }
 }
@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <pair_table.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <util.h>
+
+static const size_t MIN_CAPACITY = 16;
+static const size_t GROWTH_FACTOR = 2;
+
+typedef struct {
+  uintptr_t key1; // 0 if the slot is empty
+  uintptr_t key2;
+  void *value;
+} pair_entry_t;
+
+struct pair_table {
+  size_t size;
+  size_t capacity; // always a power of 2
+  pair_entry_t *entries;
+};
+
+static size_t pair_hash(uintptr_t key1, uintptr_t key2) {
+  // splitmix64 finalizer over both keys
+  uint64_t h = (uint64_t)key1 * 0x9E3779B97F4A7C15ULL ^ (uint64_t)key2;
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+  return (size_t)h;
+}
+
+// keys are stored in address order, so the pair is unordered
+static void order_keys(const void *key1, const void *key2, uintptr_t *first,
+                       uintptr_t *second) {
+  uintptr_t a = (uintptr_t)key1;
+  uintptr_t b = (uintptr_t)key2;
+  *first = a < b ? a : b;
+  *second = a < b ? b : a;
+}
+
+static pair_entry_t *find_slot(pair_entry_t *entries, size_t capacity,
+                               uintptr_t key1, uintptr_t key2) {
+  size_t mask = capacity - 1;
+  size_t i = pair_hash(key1, key2) & mask;
+  while (entries[i].key1 != 0 &&
+         (entries[i].key1 != key1 || entries[i].key2 != key2)) {
+    i = (i + 1) & mask;
+  }
+  return &entries[i];
+}
+
+pair_table_t *pair_table_init(size_t initial_size) {
+  size_t capacity = MIN_CAPACITY;
+  // keep the load factor at most 1/2
+  while (capacity < initial_size * 2) {
+    capacity *= GROWTH_FACTOR;
+  }
+  pair_table_t *table = malloc_safe(sizeof(pair_table_t));
+  table->size = 0;
+  table->capacity = capacity;
+  table->entries = calloc(capacity, sizeof(pair_entry_t));
+  assert(table->entries != NULL);
+  return table;
+}
+
+void pair_table_free(pair_table_t *table) {
+  free(table->entries);
+  free(table);
+}
+
+size_t pair_table_size(pair_table_t *table) { return table->size; }
+
+void *pair_table_get(pair_table_t *table, const void *key1, const void *key2) {
+  uintptr_t first, second;
+  order_keys(key1, key2, &first, &second);
+  return find_slot(table->entries, table->capacity, first, second)->value;
+}
+
+static void pair_table_grow(pair_table_t *table) {
+  size_t new_capacity = table->capacity * GROWTH_FACTOR;
+  pair_entry_t *new_entries = calloc(new_capacity, sizeof(pair_entry_t));
+  assert(new_entries != NULL);
+  for (size_t i = 0; i < table->capacity; i++) {
+    pair_entry_t *entry = &table->entries[i];
+    if (entry->key1 != 0) {
+      *find_slot(new_entries, new_capacity, entry->key1, entry->key2) = *entry;
+    }
+  }
+  free(table->entries);
+  table->entries = new_entries;
+  table->capacity = new_capacity;
+}
+
+void pair_table_put(pair_table_t *table, const void *key1, const void *key2,
+                    void *value) {
+  assert(key1 != NULL && key2 != NULL);
+  assert(value != NULL);
+  if ((table->size + 1) * 2 > table->capacity) {
+    pair_table_grow(table);
+  }
+  uintptr_t first, second;
+  order_keys(key1, key2, &first, &second);
+  pair_entry_t *slot =
+      find_slot(table->entries, table->capacity, first, second);
+  if (slot->key1 == 0) {
+    table->size++;
+  }
+  *slot = (pair_entry_t){first, second, value};
+}
+
+void *pair_table_remove(pair_table_t *table, const void *key1,
+                        const void *key2) {
+  uintptr_t first, second;
+  order_keys(key1, key2, &first, &second);
+  pair_entry_t *slot =
+      find_slot(table->entries, table->capacity, first, second);
+  if (slot->key1 == 0) {
+    return NULL;
+  }
+  void *value = slot->value;
+  table->size--;
+
+  // backward-shift deletion, so lookups never need tombstones
+  size_t mask = table->capacity - 1;
+  size_t hole = slot - table->entries;
+  size_t i = (hole + 1) & mask;
+  while (table->entries[i].key1 != 0) {
+    pair_entry_t *entry = &table->entries[i];
+    size_t home = pair_hash(entry->key1, entry->key2) & mask;
+    // move the entry into the hole if the hole lies between its home and i
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      table->entries[hole] = *entry;
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+  table->entries[hole] = (pair_entry_t){0, 0, NULL};
+  return value;
+}
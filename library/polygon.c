@@ -1,26 +1,93 @@
+#include <math.h>
 #include <polygon.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util.h>
 
-double polygon_area(list_t *polygon) {
+polygon_t *poly_init(size_t size) {
+  polygon_t *polygon = malloc_safe(sizeof(polygon_t));
+  polygon->size = size;
+  polygon->vertices = malloc_safe(size * sizeof(vector_t));
+  return polygon;
+}
+
+void poly_free(polygon_t *polygon) {
+  free(polygon->vertices);
+  free(polygon);
+}
+
+polygon_t *poly_copy(polygon_t *polygon) {
+  polygon_t *copy = poly_init(polygon->size);
+  memcpy(copy->vertices, polygon->vertices, polygon->size * sizeof(vector_t));
+  return copy;
+}
+
+polygon_t *poly_from_list(list_t *list) {
+  const size_t num_vertices = list_size(list);
+  polygon_t *polygon = poly_init(num_vertices);
+  for (size_t i = 0; i < num_vertices; i++) {
+    polygon->vertices[i] = *(vector_t *)list_get(list, i);
+  }
+  return polygon;
+}
+
+polygon_t poly_from_list_buffer(list_t *list, vector_t *buffer) {
+  const size_t num_vertices = list_size(list);
+  polygon_t polygon = {num_vertices, buffer};
+  if (num_vertices > POLY_BUFFER_SIZE) {
+    polygon.vertices = malloc_safe(num_vertices * sizeof(vector_t));
+  }
+  for (size_t i = 0; i < num_vertices; i++) {
+    polygon.vertices[i] = *(vector_t *)list_get(list, i);
+  }
+  return polygon;
+}
+
+void poly_release_buffer(polygon_t *polygon, vector_t *buffer) {
+  if (polygon->vertices != buffer) {
+    free(polygon->vertices);
+  }
+}
+
+list_t *poly_to_list(polygon_t *polygon) {
+  list_t *list = list_init(polygon->size, free);
+  for (size_t i = 0; i < polygon->size; i++) {
+    vector_t *vertex = malloc_safe(sizeof(vector_t));
+    *vertex = polygon->vertices[i];
+    list_add(list, vertex);
+  }
+  return list;
+}
+
+// writes the vertices of a polygon back into a list of the same size
+static void poly_store_list(polygon_t *polygon, list_t *list) {
+  for (size_t i = 0; i < polygon->size; i++) {
+    *(vector_t *)list_get(list, i) = polygon->vertices[i];
+  }
+}
+
+double poly_area(polygon_t *polygon) {
   double sum = 0.0;
-  const size_t num_vertices = list_size(polygon);
+  const size_t num_vertices = polygon->size;
+  const vector_t *vertices = polygon->vertices;
   for (size_t i = 0; i < num_vertices; i++) {
     // see https://en.wikipedia.org/wiki/Shoelace_formula#Shoelace_formula
-    sum += vec_cross(*(vector_t *)list_get(polygon, i),
-                     *(vector_t *)list_get(polygon, (i + 1) % num_vertices));
+    sum += vec_cross(vertices[i], vertices[(i + 1) % num_vertices]);
   }
   return sum / 2.0;
 }
 
-vector_t polygon_centroid(list_t *polygon) {
+vector_t poly_centroid(polygon_t *polygon) {
   // formula from https://en.wikipedia.org/wiki/Centroid#Of_a_polygon
 
   vector_t sum_vec = VEC_ZERO;
 
-  const size_t num_vertices = list_size(polygon);
+  const size_t num_vertices = polygon->size;
+  const vector_t *vertices = polygon->vertices;
   for (size_t i = 0; i < num_vertices; i++) {
-    vector_t vertex1 = *(vector_t *)list_get(polygon, i);
-    vector_t vertex2 = *(vector_t *)list_get(polygon, (i + 1) % num_vertices);
+    vector_t vertex1 = vertices[i];
+    vector_t vertex2 = vertices[(i + 1) % num_vertices];
 
     // calculate the part inside the sum
     vector_t vector_term = vec_add(vertex1, vertex2);
@@ -28,27 +95,63 @@ vector_t polygon_centroid(list_t *polygon) {
     sum_vec = vec_add(sum_vec, vec_multiply(scalar_term, vector_term));
   }
 
-  double coeff = 1.0 / (6.0 * polygon_area(polygon));
+  double coeff = 1.0 / (6.0 * poly_area(polygon));
   return vec_multiply(coeff, sum_vec);
 }
 
-void polygon_translate(list_t *polygon, vector_t translation) {
-  const size_t num_vertices = list_size(polygon);
-  for (size_t i = 0; i < num_vertices; i++) {
-    vector_t *vertex = list_get(polygon, i);
-    *vertex = vec_add(*vertex, translation);
+void poly_translate(polygon_t *polygon, vector_t translation) {
+  vector_t *vertices = polygon->vertices;
+  for (size_t i = 0; i < polygon->size; i++) {
+    vertices[i] = vec_add(vertices[i], translation);
   }
 }
 
-void polygon_rotate(list_t *polygon, double angle, vector_t point) {
+void poly_rotate(polygon_t *polygon, double angle, vector_t point) {
   // in order to rotate around a point,
   // we translate the polygon such that the point is the origin
   // then, we rotate about the origin, and translate back
-  polygon_translate(polygon, vec_negate(point));
-  const size_t num_vertices = list_size(polygon);
-  for (size_t i = 0; i < num_vertices; i++) {
-    vector_t *vertex = list_get(polygon, i);
-    *vertex = vec_rotate(*vertex, angle);
+  double sin_theta = sin(angle);
+  double cos_theta = cos(angle);
+  vector_t *vertices = polygon->vertices;
+  for (size_t i = 0; i < polygon->size; i++) {
+    vector_t v = vec_subtract(vertices[i], point);
+    v = (vector_t){v.x * cos_theta - v.y * sin_theta,
+                   v.x * sin_theta + v.y * cos_theta};
+    vertices[i] = vec_add(v, point);
   }
-  polygon_translate(polygon, point);
-}
\ No newline at end of file
+}
+
+// The list-based functions below copy the vertices into a stack buffer,
+// so they share the contiguous kernels without allocating for small shapes
+
+double polygon_area(list_t *polygon) {
+  vector_t buffer[POLY_BUFFER_SIZE];
+  polygon_t copy = poly_from_list_buffer(polygon, buffer);
+  double area = poly_area(&copy);
+  poly_release_buffer(&copy, buffer);
+  return area;
+}
+
+vector_t polygon_centroid(list_t *polygon) {
+  vector_t buffer[POLY_BUFFER_SIZE];
+  polygon_t copy = poly_from_list_buffer(polygon, buffer);
+  vector_t centroid = poly_centroid(&copy);
+  poly_release_buffer(&copy, buffer);
+  return centroid;
+}
+
+void polygon_translate(list_t *polygon, vector_t translation) {
+  vector_t buffer[POLY_BUFFER_SIZE];
+  polygon_t copy = poly_from_list_buffer(polygon, buffer);
+  poly_translate(&copy, translation);
+  poly_store_list(&copy, polygon);
+  poly_release_buffer(&copy, buffer);
+}
+
+void polygon_rotate(list_t *polygon, double angle, vector_t point) {
+  vector_t buffer[POLY_BUFFER_SIZE];
+  polygon_t copy = poly_from_list_buffer(polygon, buffer);
+  poly_rotate(&copy, angle, point);
+  poly_store_list(&copy, polygon);
+  poly_release_buffer(&copy, buffer);
+}
@@ -0,0 +1,199 @@
+#include <assert.h>
+#include <math.h>
+#include <projection.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+// AVX2 is compiled in per function, so the rest of the library
+// still runs on any x86-64 CPU; it is only used if the CPU supports it
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// the number of axes each kernel projects onto per pass over the vertices
+#define PROJECTION_BATCH 4
+
+typedef void (*project_kernel_t)(const vector_t *vertices, size_t size,
+                                 const vector_t *axes, size_t num_axes,
+                                 projection_range_t *ranges);
+
+static projection_impl_t current_impl;
+static bool impl_chosen = false;
+
+// these match the semantics of the SIMD min and max instructions,
+// so every implementation computes bit-identical ranges
+static double min_of(double a, double b) { return a < b ? a : b; }
+static double max_of(double a, double b) { return a > b ? a : b; }
+
+// the kernels multiply and add separately, so this must not be fused into
+// an FMA either; the Makefile builds with -ffp-contract=off to prevent it
+static void project_scalar(const vector_t *vertices, size_t size,
+                           const vector_t *axes, size_t num_axes,
+                           projection_range_t *ranges) {
+  for (size_t i = 0; i < size; i++) {
+    for (size_t k = 0; k < num_axes; k++) {
+      double projection = vertices[i].x * axes[k].x + vertices[i].y * axes[k].y;
+      ranges[k].min = min_of(projection, ranges[k].min);
+      ranges[k].max = max_of(projection, ranges[k].max);
+    }
+  }
+}
+
+#ifdef HAVE_SSE2
+static void project_sse2(const vector_t *vertices, size_t size,
+                         const vector_t *axes, size_t num_axes,
+                         projection_range_t *ranges) {
+  __m128d axis_x[PROJECTION_BATCH], axis_y[PROJECTION_BATCH];
+  __m128d mins[PROJECTION_BATCH], maxs[PROJECTION_BATCH];
+  for (size_t k = 0; k < num_axes; k++) {
+    axis_x[k] = _mm_set1_pd(axes[k].x);
+    axis_y[k] = _mm_set1_pd(axes[k].y);
+    mins[k] = _mm_set1_pd(INFINITY);
+    maxs[k] = _mm_set1_pd(-INFINITY);
+  }
+
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    __m128d vertex1 = _mm_loadu_pd(&vertices[i].x);
+    __m128d vertex2 = _mm_loadu_pd(&vertices[i + 1].x);
+    __m128d xs = _mm_unpacklo_pd(vertex1, vertex2);
+    __m128d ys = _mm_unpackhi_pd(vertex1, vertex2);
+    for (size_t k = 0; k < num_axes; k++) {
+      __m128d projection = _mm_add_pd(_mm_mul_pd(xs, axis_x[k]),
+                                      _mm_mul_pd(ys, axis_y[k]));
+      mins[k] = _mm_min_pd(projection, mins[k]);
+      maxs[k] = _mm_max_pd(projection, maxs[k]);
+    }
+  }
+
+  for (size_t k = 0; k < num_axes; k++) {
+    double lanes[2];
+    _mm_storeu_pd(lanes, mins[k]);
+    ranges[k].min = min_of(min_of(lanes[0], lanes[1]), ranges[k].min);
+    _mm_storeu_pd(lanes, maxs[k]);
+    ranges[k].max = max_of(max_of(lanes[0], lanes[1]), ranges[k].max);
+  }
+  project_scalar(&vertices[i], size - i, axes, num_axes, ranges);
+}
+#endif
+
+#ifdef HAVE_AVX2
+TARGET_AVX2
+static void project_avx2(const vector_t *vertices, size_t size,
+                         const vector_t *axes, size_t num_axes,
+                         projection_range_t *ranges) {
+  __m256d axis_x[PROJECTION_BATCH], axis_y[PROJECTION_BATCH];
+  __m256d mins[PROJECTION_BATCH], maxs[PROJECTION_BATCH];
+  for (size_t k = 0; k < num_axes; k++) {
+    axis_x[k] = _mm256_set1_pd(axes[k].x);
+    axis_y[k] = _mm256_set1_pd(axes[k].y);
+    mins[k] = _mm256_set1_pd(INFINITY);
+    maxs[k] = _mm256_set1_pd(-INFINITY);
+  }
+
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    // each load holds two vertices; unpacking interleaves them as
+    // (x0, x2, x1, x3) and (y0, y2, y1, y3), which keeps the lanes matched
+    __m256d vertices12 = _mm256_loadu_pd(&vertices[i].x);
+    __m256d vertices34 = _mm256_loadu_pd(&vertices[i + 2].x);
+    __m256d xs = _mm256_unpacklo_pd(vertices12, vertices34);
+    __m256d ys = _mm256_unpackhi_pd(vertices12, vertices34);
+    for (size_t k = 0; k < num_axes; k++) {
+      // a separate multiply and add, not an FMA, to round like the others
+      __m256d projection = _mm256_add_pd(_mm256_mul_pd(xs, axis_x[k]),
+                                         _mm256_mul_pd(ys, axis_y[k]));
+      mins[k] = _mm256_min_pd(projection, mins[k]);
+      maxs[k] = _mm256_max_pd(projection, maxs[k]);
+    }
+  }
+
+  for (size_t k = 0; k < num_axes; k++) {
+    __m128d min = _mm_min_pd(_mm256_castpd256_pd128(mins[k]),
+                             _mm256_extractf128_pd(mins[k], 1));
+    __m128d max = _mm_max_pd(_mm256_castpd256_pd128(maxs[k]),
+                             _mm256_extractf128_pd(maxs[k], 1));
+    double lanes[2];
+    _mm_storeu_pd(lanes, min);
+    ranges[k].min = min_of(min_of(lanes[0], lanes[1]), ranges[k].min);
+    _mm_storeu_pd(lanes, max);
+    ranges[k].max = max_of(max_of(lanes[0], lanes[1]), ranges[k].max);
+  }
+  project_scalar(&vertices[i], size - i, axes, num_axes, ranges);
+}
+#endif
+
+bool projection_impl_supported(projection_impl_t impl) {
+  switch (impl) {
+  case PROJECTION_SCALAR:
+    return true;
+  case PROJECTION_SSE2:
+#ifdef HAVE_SSE2
+    return true;
+#else
+    return false;
+#endif
+  case PROJECTION_AVX2:
+#ifdef HAVE_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+projection_impl_t projection_get_impl(void) {
+  if (!impl_chosen) {
+    if (projection_impl_supported(PROJECTION_AVX2)) {
+      current_impl = PROJECTION_AVX2;
+    } else if (projection_impl_supported(PROJECTION_SSE2)) {
+      current_impl = PROJECTION_SSE2;
+    } else {
+      current_impl = PROJECTION_SCALAR;
+    }
+    impl_chosen = true;
+  }
+  return current_impl;
+}
+
+void projection_set_impl(projection_impl_t impl) {
+  assert(projection_impl_supported(impl));
+  current_impl = impl;
+  impl_chosen = true;
+}
+
+static project_kernel_t get_kernel(void) {
+  switch (projection_get_impl()) {
+#ifdef HAVE_AVX2
+  case PROJECTION_AVX2:
+    return project_avx2;
+#endif
+#ifdef HAVE_SSE2
+  case PROJECTION_SSE2:
+    return project_sse2;
+#endif
+  default:
+    return project_scalar;
+  }
+}
+
+void poly_project(polygon_t *polygon, const vector_t *axes, size_t num_axes,
+                  projection_range_t *ranges) {
+  project_kernel_t kernel = get_kernel();
+  for (size_t k = 0; k < num_axes; k++) {
+    ranges[k] = (projection_range_t){INFINITY, -INFINITY};
+  }
+  for (size_t start = 0; start < num_axes; start += PROJECTION_BATCH) {
+    size_t count = num_axes - start < PROJECTION_BATCH ? num_axes - start
+                                                        : PROJECTION_BATCH;
+    kernel(polygon->vertices, polygon->size, &axes[start], count,
+           &ranges[start]);
+  }
+}
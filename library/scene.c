@@ -1,28 +1,166 @@
+#include <aabb_tree.h>
+#include <assert.h>
 #include <list.h>
+#include <math.h>
+#include <pair_table.h>
 #include <scene.h>
+#include <spatial_hash.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <sweep_prune.h>
+#include <thread_pool.h>
 #include <util.h>
 
 static const size_t INITIAL_LIST_CAPACITY = 100; // approx number of bodies
+static const double DEFAULT_GRID_CELL_SIZE = 64.0;
+// every type starts on the first layer, colliding with every layer
+static const uint32_t DEFAULT_LAYERS = 1;
+static const uint32_t DEFAULT_MASK = UINT32_MAX;
+// how far past its bounding box a body can move before its leaf in the
+// AABB tree broad phase has to be moved
+static const double TREE_MARGIN = 2.0;
+// the grid can't move single bodies, so queries check the bodies that
+// changed since it was built themselves, until more than one in this many
+// bodies have changed
+static const size_t GRID_STALE_FRACTION = 8;
+static const size_t DEFAULT_SOLVER_ITERATIONS = 8;
+static const double DEFAULT_TICK_RATE = 60.0;
+static const size_t DEFAULT_MAX_STEPS = 5;
+static const size_t GROWTH_FACTOR = 2;
+// bodies approaching slower than this do not bounce,
+// so resting contacts do not jitter
+static const double RESTITUTION_THRESHOLD = 0.5;
+// the fraction of the penetration removed each solver iteration,
+// and the penetration left alone so resting bodies stay in contact
+static const double CORRECTION_PERCENT = 0.8;
+static const double CORRECTION_SLOP = 0.01;
+
+// an entry in a body's intrusive list of things that depend on it
+struct scene_link {
+  body_t *body;
+  void *owner; // the force_info_t or collision_entry_t using the body
+  bool owner_is_collision;
+  scene_link_t *prev;
+  scene_link_t *next;
+};
 
 typedef struct {
   force_creator_t forcer;
   void *aux;
   free_func_t freer;
   list_t *bodies;
+  scene_link_t *links; // one per body in bodies
+  bool removed;
 } force_info_t;
 
 static void force_info_free(force_info_t *force_info) {
   if (force_info->bodies) {
     list_free(force_info->bodies);
   }
+  free(force_info->links);
   if (force_info->freer && force_info->aux) {
     force_info->freer(force_info->aux);
   }
   free(force_info);
 }
 
+typedef struct collision_entry {
+  body_t *body1;
+  body_t *body2;
+  // exactly one of the handlers is set
+  collision_handler_t handler;
+  contact_handler_t contact_handler;
+  void *aux;
+  free_func_t freer;
+  // next collision registered on the same pair of bodies
+  struct collision_entry *next;
+  scene_link_t links[2];
+  bool removed;
+} collision_entry_t;
+
+typedef struct collision_rule {
+  const char *type1;
+  const char *type2;
+  // exactly one of the handlers is set
+  collision_handler_t handler;
+  contact_handler_t contact_handler;
+  void *aux;
+  free_func_t freer;
+  // next rule registered on the same pair of types
+  struct collision_rule *next;
+} collision_rule_t;
+
+// a pair of bodies that the narrow phase tested during the last tick
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+  size_t last_tested_tick;
+  size_t last_collided_tick;
+  // the axis that last separated the bodies, or that they collided along
+  vector_t separating_axis;
+  // the simplex GJK last ended with, if the pair uses COLLISION_ENGINE_GJK
+  gjk_simplex_t simplex;
+  // the impulse the solver applied from body1 to body2 last tick
+  double normal_impulse;
+} contact_t;
+
+// a pair of colliding bodies the contact solver resolves this tick
+typedef struct {
+  contact_t *contact;
+  // the bodies in the contact's order, and the axis from body1 to body2
+  body_t *body1;
+  body_t *body2;
+  vector_t axis;
+  double depth;
+  double inverse_mass1;
+  double inverse_mass2;
+  // the relative velocity along the axis the bodies should separate at
+  double target_velocity;
+  // the total impulse applied from body1 to body2 this tick
+  double impulse;
+  // where the bodies were when they were tested
+  vector_t centroid1;
+  vector_t centroid2;
+} solver_contact_t;
+
+// a fast body the sweep moved to its point of impact this tick
+typedef struct {
+  body_t *body;
+  // the fraction of its path the body covered to get there
+  double toi;
+} swept_body_t;
+
+// a type of body, and the bodies in the scene that have it
+typedef struct {
+  const char *name;
+  size_t id;
+  uint32_t layers;
+  uint32_t mask;
+  // in the order they were added, including removed bodies until reaped
+  list_t *bodies;
+  size_t num_removed;
+} body_type_t;
+
+static void body_type_free(body_type_t *type) {
+  list_free(type->bodies);
+  free(type);
+}
+
+static void collision_entry_free(collision_entry_t *entry) {
+  if (entry->freer && entry->aux) {
+    entry->freer(entry->aux);
+  }
+  free(entry);
+}
+
+static void collision_rule_free(collision_rule_t *rule) {
+  if (rule->freer && rule->aux) {
+    rule->freer(rule->aux);
+  }
+  free(rule);
+}
+
 void scene_text_to_draw_free(text_to_draw_t *text_to_draw) {
   free((void*) text_to_draw->text);
   free(text_to_draw);
@@ -31,7 +169,81 @@ void scene_text_to_draw_free(text_to_draw_t *text_to_draw) {
 
 struct scene {
   list_t *bodies;
+  // the bodies' physics state, in the same order as bodies
+  body_store_t *body_store;
   list_t *force_creators;
+  list_t *collisions;
+  // maps each pair of bodies to the first collision registered on them
+  pair_table_t *collision_pairs;
+  list_t *collision_rules;
+  // maps each pair of types to the first rule registered on them
+  pair_table_t *rule_pairs;
+  list_t *contacts;
+  pair_table_t *contact_pairs;
+  // the contacts added by contact handlers during this tick
+  solver_contact_t *solver_contacts;
+  size_t num_solver_contacts;
+  size_t solver_contacts_capacity;
+  size_t solver_iterations;
+  // the same contacts grouped by island (see scene_build_islands()),
+  // with island i made of island_contacts[island_starts[i]] up to
+  // island_contacts[island_starts[i + 1]]
+  solver_contact_t *island_contacts;
+  size_t island_contacts_capacity;
+  size_t *island_starts;
+  size_t island_starts_capacity;
+  size_t num_islands;
+  // scratch space for building the islands
+  size_t *island_parents;
+  size_t island_parents_capacity;
+  size_t *contact_islands;
+  size_t contact_islands_capacity;
+  // solves the islands, with no workers unless scene_set_solver_threads()
+  thread_pool_t *solver_pool;
+  // the fast bodies swept into other bodies during this tick
+  swept_body_t *swept_bodies;
+  size_t num_swept_bodies;
+  size_t swept_bodies_capacity;
+  // the length of the current tick, or sub-step (see scene_substep())
+  double dt;
+  // the fixed tick length and catch-up limit of scene_step_fixed(),
+  // the real time not yet simulated, and how far it is into the next tick
+  double fixed_dt;
+  size_t max_steps;
+  double accumulator;
+  double interpolation;
+  // bodies slower than sleep_velocity for sleep_time seconds fall asleep
+  double sleep_velocity;
+  double sleep_time;
+  // bodies move at most substep_travel times their smallest extent per
+  // sub-step of a tick, up to max_substeps, and substeps is how many
+  // the last tick took
+  double substep_travel;
+  size_t max_substeps;
+  size_t substeps;
+  // every type of body added so far, indexed by type id;
+  // untyped bodies have id 0
+  list_t *types;
+  // maps each type to its body_type_t (keyed twice, as pair_table needs)
+  pair_table_t *type_ids;
+  collision_engine_t collision_engine;
+  // maps pairs of types to the collision_engine_t chosen for them
+  pair_table_t *engine_pairs;
+  list_t *engine_overrides;
+  spatial_hash_t *broad_phase;
+  // static and sleeping bodies, only rebuilt when one is added or removed,
+  // or a body falls asleep or wakes up
+  spatial_hash_t *static_broad_phase;
+  bool static_dirty;
+  // used instead of the grids above when broad_phase_kind is BROAD_PHASE_SAP
+  // or BROAD_PHASE_TREE; hold every body in the scene, resting or not
+  broad_phase_t broad_phase_kind;
+  sweep_prune_t *sweep_prune;
+  aabb_tree_t *tree;
+  // set while the tick reads the broad phase, when queries from collision
+  // handlers must not update it
+  bool broad_phase_in_use;
+  size_t tick;
   list_t *texts_to_draw;
   list_t *images_to_draw;
 };
@@ -39,8 +251,61 @@ struct scene {
 scene_t *scene_init(void) {
   scene_t *scene = malloc_safe(sizeof(scene_t));
   scene->bodies = list_init(INITIAL_LIST_CAPACITY, (free_func_t)body_free);
+  scene->body_store = body_store_init(INITIAL_LIST_CAPACITY);
   scene->force_creators =
       list_init(INITIAL_LIST_CAPACITY, (free_func_t)force_info_free);
+  scene->collisions =
+      list_init(INITIAL_LIST_CAPACITY, (free_func_t)collision_entry_free);
+  scene->collision_pairs = pair_table_init(INITIAL_LIST_CAPACITY);
+  scene->collision_rules =
+      list_init(INITIAL_LIST_CAPACITY, (free_func_t)collision_rule_free);
+  scene->rule_pairs = pair_table_init(INITIAL_LIST_CAPACITY);
+  scene->contacts = list_init(INITIAL_LIST_CAPACITY, free);
+  scene->contact_pairs = pair_table_init(INITIAL_LIST_CAPACITY);
+  scene->solver_contacts =
+      malloc_safe(INITIAL_LIST_CAPACITY * sizeof(solver_contact_t));
+  scene->num_solver_contacts = 0;
+  scene->solver_contacts_capacity = INITIAL_LIST_CAPACITY;
+  scene->solver_iterations = DEFAULT_SOLVER_ITERATIONS;
+  scene->island_contacts =
+      malloc_safe(INITIAL_LIST_CAPACITY * sizeof(solver_contact_t));
+  scene->island_contacts_capacity = INITIAL_LIST_CAPACITY;
+  scene->swept_bodies =
+      malloc_safe(INITIAL_LIST_CAPACITY * sizeof(swept_body_t));
+  scene->num_swept_bodies = 0;
+  scene->swept_bodies_capacity = INITIAL_LIST_CAPACITY;
+  scene->island_starts = malloc_safe(INITIAL_LIST_CAPACITY * sizeof(size_t));
+  scene->island_starts_capacity = INITIAL_LIST_CAPACITY;
+  scene->num_islands = 0;
+  scene->island_parents = malloc_safe(INITIAL_LIST_CAPACITY * sizeof(size_t));
+  scene->island_parents_capacity = INITIAL_LIST_CAPACITY;
+  scene->contact_islands = malloc_safe(INITIAL_LIST_CAPACITY * sizeof(size_t));
+  scene->contact_islands_capacity = INITIAL_LIST_CAPACITY;
+  scene->solver_pool = thread_pool_init(0);
+  scene->dt = 0;
+  scene->fixed_dt = 1.0 / DEFAULT_TICK_RATE;
+  scene->max_steps = DEFAULT_MAX_STEPS;
+  scene->accumulator = 0;
+  scene->interpolation = 1;
+  scene->sleep_velocity = 0;
+  scene->sleep_time = 0;
+  scene->substep_travel = 0;
+  scene->max_substeps = 1;
+  scene->substeps = 0;
+  scene->types = list_init(INITIAL_LIST_CAPACITY, (free_func_t)body_type_free);
+  scene->type_ids = pair_table_init(INITIAL_LIST_CAPACITY);
+  scene_type_id(scene, NULL);
+  scene->collision_engine = COLLISION_ENGINE_SAT;
+  scene->engine_pairs = pair_table_init(INITIAL_LIST_CAPACITY);
+  scene->engine_overrides = list_init(INITIAL_LIST_CAPACITY, free);
+  scene->broad_phase = spatial_hash_init(DEFAULT_GRID_CELL_SIZE);
+  scene->static_broad_phase = spatial_hash_init(DEFAULT_GRID_CELL_SIZE);
+  scene->static_dirty = false;
+  scene->broad_phase_kind = BROAD_PHASE_GRID;
+  scene->sweep_prune = sweep_prune_init();
+  scene->tree = aabb_tree_init(TREE_MARGIN);
+  scene->broad_phase_in_use = false;
+  scene->tick = 0;
   scene->texts_to_draw = list_init(INITIAL_LIST_CAPACITY, (free_func_t)scene_text_to_draw_free);
   scene->images_to_draw = list_init(INITIAL_LIST_CAPACITY, (free_func_t)free);
   return scene;
@@ -48,7 +313,29 @@ scene_t *scene_init(void) {
 
 void scene_free(scene_t *scene) {
   list_free(scene->bodies);
+  body_store_free(scene->body_store);
   list_free(scene->force_creators);
+  list_free(scene->collisions);
+  pair_table_free(scene->collision_pairs);
+  list_free(scene->collision_rules);
+  pair_table_free(scene->rule_pairs);
+  list_free(scene->contacts);
+  pair_table_free(scene->contact_pairs);
+  free(scene->solver_contacts);
+  free(scene->island_contacts);
+  free(scene->swept_bodies);
+  free(scene->island_starts);
+  free(scene->island_parents);
+  free(scene->contact_islands);
+  thread_pool_free(scene->solver_pool);
+  list_free(scene->types);
+  pair_table_free(scene->type_ids);
+  pair_table_free(scene->engine_pairs);
+  list_free(scene->engine_overrides);
+  spatial_hash_free(scene->broad_phase);
+  spatial_hash_free(scene->static_broad_phase);
+  sweep_prune_free(scene->sweep_prune);
+  aabb_tree_free(scene->tree);
   list_free(scene->texts_to_draw);
   list_free(scene->images_to_draw);
   free(scene);
@@ -60,41 +347,241 @@ body_t *scene_get_body(scene_t *scene, size_t index) {
   return list_get(scene->bodies, index);
 }
 
+// whether a body belongs in the static broad phase
+static bool body_is_resting(body_t *body) {
+  return body_is_static(body) || body_is_asleep(body);
+}
+
+// adds a body to the broad phase that is kept between ticks, if there is one
+static void scene_broad_phase_insert(scene_t *scene, body_t *body) {
+  aabb_t bounds = body_get_aabb(body);
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    body->broad_phase_proxy =
+        sweep_prune_insert(scene->sweep_prune, body, bounds);
+  } else if (scene->broad_phase_kind == BROAD_PHASE_TREE) {
+    body->broad_phase_proxy = aabb_tree_insert(scene->tree, body, bounds);
+  } else {
+    return;
+  }
+  body->has_broad_phase_proxy = true;
+}
+
+static void scene_broad_phase_remove(scene_t *scene, body_t *body) {
+  if (!body->has_broad_phase_proxy) {
+    return;
+  }
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    sweep_prune_remove(scene->sweep_prune, body->broad_phase_proxy);
+  } else {
+    aabb_tree_remove(scene->tree, body->broad_phase_proxy);
+  }
+  body->has_broad_phase_proxy = false;
+}
+
+size_t scene_type_id(scene_t *scene, const char *type) {
+  // untyped bodies share the type made by scene_init()
+  if (!type && list_size(scene->types) > 0) {
+    return 0;
+  }
+  body_type_t *existing =
+      type ? pair_table_get(scene->type_ids, type, type) : NULL;
+  if (existing) {
+    return existing->id;
+  }
+  body_type_t *body_type = malloc_safe(sizeof(body_type_t));
+  body_type->name = type;
+  body_type->id = list_size(scene->types);
+  body_type->layers = DEFAULT_LAYERS;
+  body_type->mask = DEFAULT_MASK;
+  body_type->bodies = list_init(INITIAL_LIST_CAPACITY, NULL);
+  body_type->num_removed = 0;
+  list_add(scene->types, body_type);
+  if (type) {
+    pair_table_put(scene->type_ids, type, type, body_type);
+  }
+  return body_type->id;
+}
+
+static body_type_t *scene_get_type(scene_t *scene, const char *type) {
+  return list_get(scene->types, scene_type_id(scene, type));
+}
+
+// like scene_get_type(), but returns NULL for a type the scene hasn't seen,
+// so read-only lookups don't add it
+static body_type_t *scene_find_type(scene_t *scene, const char *type) {
+  if (!type) {
+    return list_get(scene->types, 0);
+  }
+  return pair_table_get(scene->type_ids, type, type);
+}
+
+void scene_set_type_layers(scene_t *scene, const char *type, uint32_t layers,
+                           uint32_t mask) {
+  body_type_t *body_type = scene_get_type(scene, type);
+  body_type->layers = layers;
+  body_type->mask = mask;
+}
+
+size_t scene_type_bodies(scene_t *scene, const char *type) {
+  body_type_t *body_type = scene_find_type(scene, type);
+  return body_type ? list_size(body_type->bodies) : 0;
+}
+
+body_t *scene_get_type_body(scene_t *scene, const char *type, size_t index) {
+  body_type_t *body_type = scene_find_type(scene, type);
+  // a type the scene hasn't seen has no bodies, so no index is valid
+  assert(body_type);
+  return list_get(body_type->bodies, index);
+}
+
+// the type of a body in the scene
+static body_type_t *scene_body_type(scene_t *scene, body_t *body) {
+  return list_get(scene->types, body->type_id);
+}
+
+// whether each body's type is on a layer the other's type collides with
+static bool scene_layers_collide(scene_t *scene, body_t *body1,
+                                 body_t *body2) {
+  body_type_t *type1 = scene_body_type(scene, body1);
+  body_type_t *type2 = scene_body_type(scene, body2);
+  return (type1->layers & type2->mask) && (type2->layers & type1->mask);
+}
+
 void scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
+  body->type_id = scene_type_id(scene, body->type);
+  list_add(scene_body_type(scene, body)->bodies, body);
+  body_store_add(scene->body_store, body);
+  // a new body is drawn where it was added, not where it was created
+  body_save_transform(body);
+  body->broad_phase_resting = body_is_resting(body);
+  if (body->broad_phase_resting) {
+    scene->static_dirty = true;
+  }
+  scene_broad_phase_insert(scene, body);
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
   body_remove(list_get(scene->bodies, index));
 }
 
-static void scene_remove_body_real(scene_t *scene, size_t index) {
-  body_t *removed_body = list_remove(scene->bodies, index);
+static void scene_unlink_collision(scene_t *scene, collision_entry_t *entry) {
+  collision_entry_t *head =
+      pair_table_get(scene->collision_pairs, entry->body1, entry->body2);
+  if (head == entry) {
+    if (entry->next) {
+      pair_table_put(scene->collision_pairs, entry->body1, entry->body2,
+                     entry->next);
+    } else {
+      pair_table_remove(scene->collision_pairs, entry->body1, entry->body2);
+    }
+  } else {
+    while (head->next != entry) {
+      head = head->next;
+    }
+    head->next = entry->next;
+  }
+}
 
-  // remove force creator if one of its bodies is removed
-  size_t num_forcers = list_size(scene->force_creators);
-  for (size_t forcer_num = 0; forcer_num < num_forcers; forcer_num++) {
-    force_info_t *force_info = list_get(scene->force_creators, forcer_num);
-
-    bool remove_forcer = false;
-    if (force_info->bodies) {
-      size_t num_forcer_bodies = list_size(force_info->bodies);
-      for (size_t body_num = 0; body_num < num_forcer_bodies; body_num++) {
-        if (list_get(force_info->bodies, body_num) == removed_body) {
-          remove_forcer = true;
-          break;
-        }
+static void scene_link_init(scene_link_t *link, body_t *body, void *owner,
+                            bool owner_is_collision) {
+  link->body = body;
+  link->owner = owner;
+  link->owner_is_collision = owner_is_collision;
+  link->prev = NULL;
+  link->next = body->scene_links;
+  if (body->scene_links) {
+    body->scene_links->prev = link;
+  }
+  body->scene_links = link;
+}
+
+static void scene_link_remove(scene_link_t *link) {
+  if (link->prev) {
+    link->prev->next = link->next;
+  } else {
+    link->body->scene_links = link->next;
+  }
+  if (link->next) {
+    link->next->prev = link->prev;
+  }
+}
+
+/**
+ * Marks everything that depends on a removed body for removal,
+ * and unlinks it from the other bodies it depends on.
+ * The marked entries are freed in one pass by scene_compact().
+ */
+static void scene_unlink_body(scene_t *scene, body_t *body) {
+  while (body->scene_links) {
+    scene_link_t *link = body->scene_links;
+    if (link->owner_is_collision) {
+      collision_entry_t *entry = link->owner;
+      scene_unlink_collision(scene, entry);
+      scene_link_remove(&entry->links[0]);
+      scene_link_remove(&entry->links[1]);
+      entry->removed = true;
+    } else {
+      force_info_t *force_info = link->owner;
+      size_t num_links = list_size(force_info->bodies);
+      for (size_t i = 0; i < num_links; i++) {
+        scene_link_remove(&force_info->links[i]);
       }
+      force_info->removed = true;
     }
+  }
+}
+
+static bool force_info_is_removed(force_info_t *force_info) {
+  return force_info->removed;
+}
 
-    if (remove_forcer) {
-      force_info_free(list_remove(scene->force_creators, forcer_num));
-      forcer_num--;
-      num_forcers--;
+static bool collision_entry_is_removed(collision_entry_t *entry) {
+  return entry->removed;
+}
+
+/**
+ * Frees the elements of a list for which is_removed() returns true,
+ * keeping the order of the rest. Runs in a single pass over the list.
+ */
+static void compact_list(list_t *list, bool (*is_removed)(void *),
+                         free_func_t freer) {
+  size_t size = list_size(list);
+  size_t kept = 0;
+  for (size_t i = 0; i < size; i++) {
+    void *element = list_get(list, i);
+    if (is_removed(element)) {
+      if (freer) {
+        freer(element);
+      }
+    } else {
+      list_set(list, kept, element);
+      kept++;
     }
   }
+  while (list_size(list) > kept) {
+    list_remove(list, list_size(list) - 1);
+  }
+}
 
-  body_free(removed_body);
+static void scene_compact(scene_t *scene) {
+  compact_list(scene->force_creators, (bool (*)(void *))force_info_is_removed,
+               (free_func_t)force_info_free);
+  compact_list(scene->collisions,
+               (bool (*)(void *))collision_entry_is_removed,
+               (free_func_t)collision_entry_free);
+  // before the removed bodies are freed
+  body_store_compact(scene->body_store);
+  size_t num_types = list_size(scene->types);
+  for (size_t i = 0; i < num_types; i++) {
+    body_type_t *type = list_get(scene->types, i);
+    if (type->num_removed > 0) {
+      compact_list(type->bodies, (bool (*)(void *))body_is_removed, NULL);
+      type->num_removed = 0;
+    }
+  }
+  compact_list(scene->bodies, (bool (*)(void *))body_is_removed,
+               (free_func_t)body_free);
 }
 
 void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
@@ -110,9 +597,177 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
   force_info->aux = aux;
   force_info->freer = freer;
   force_info->bodies = bodies;
+  force_info->links = NULL;
+  force_info->removed = false;
+  if (bodies && list_size(bodies) > 0) {
+    size_t num_bodies = list_size(bodies);
+    force_info->links = malloc_safe(num_bodies * sizeof(scene_link_t));
+    for (size_t i = 0; i < num_bodies; i++) {
+      scene_link_init(&force_info->links[i], list_get(bodies, i), force_info,
+                      false);
+    }
+  }
   list_add(scene->force_creators, force_info);
 }
 
+static void scene_add_entry(scene_t *scene, body_t *body1, body_t *body2,
+                            collision_handler_t handler,
+                            contact_handler_t contact_handler, void *aux,
+                            free_func_t freer) {
+  collision_entry_t *entry = malloc_safe(sizeof(collision_entry_t));
+  entry->body1 = body1;
+  entry->body2 = body2;
+  entry->handler = handler;
+  entry->contact_handler = contact_handler;
+  entry->aux = aux;
+  entry->freer = freer;
+  entry->next = NULL;
+  entry->removed = false;
+  scene_link_init(&entry->links[0], body1, entry, true);
+  scene_link_init(&entry->links[1], body2, entry, true);
+  // handlers on the same pair are called in registration order
+  collision_entry_t *head =
+      pair_table_get(scene->collision_pairs, body1, body2);
+  if (head) {
+    while (head->next) {
+      head = head->next;
+    }
+    head->next = entry;
+  } else {
+    pair_table_put(scene->collision_pairs, body1, body2, entry);
+  }
+  list_add(scene->collisions, entry);
+}
+
+static void scene_add_rule(scene_t *scene, const char *type1,
+                           const char *type2, collision_handler_t handler,
+                           contact_handler_t contact_handler, void *aux,
+                           free_func_t freer) {
+  collision_rule_t *rule = malloc_safe(sizeof(collision_rule_t));
+  rule->type1 = type1;
+  rule->type2 = type2;
+  rule->handler = handler;
+  rule->contact_handler = contact_handler;
+  rule->aux = aux;
+  rule->freer = freer;
+  rule->next = NULL;
+  collision_rule_t *head = pair_table_get(scene->rule_pairs, type1, type2);
+  if (head) {
+    while (head->next) {
+      head = head->next;
+    }
+    head->next = rule;
+  } else {
+    pair_table_put(scene->rule_pairs, type1, type2, rule);
+  }
+  list_add(scene->collision_rules, rule);
+}
+
+void scene_add_collision(scene_t *scene, body_t *body1, body_t *body2,
+                         collision_handler_t handler, void *aux,
+                         free_func_t freer) {
+  scene_add_entry(scene, body1, body2, handler, NULL, aux, freer);
+}
+
+void scene_add_collision_rule(scene_t *scene, const char *type1,
+                              const char *type2, collision_handler_t handler,
+                              void *aux, free_func_t freer) {
+  scene_add_rule(scene, type1, type2, handler, NULL, aux, freer);
+}
+
+void scene_add_contact(scene_t *scene, body_t *body1, body_t *body2,
+                       contact_handler_t handler, void *aux,
+                       free_func_t freer) {
+  scene_add_entry(scene, body1, body2, NULL, handler, aux, freer);
+}
+
+void scene_add_contact_rule(scene_t *scene, const char *type1,
+                            const char *type2, contact_handler_t handler,
+                            void *aux, free_func_t freer) {
+  scene_add_rule(scene, type1, type2, NULL, handler, aux, freer);
+}
+
+void scene_set_solver_iterations(scene_t *scene, size_t iterations) {
+  assert(iterations > 0);
+  scene->solver_iterations = iterations;
+}
+
+void scene_set_solver_threads(scene_t *scene, size_t num_threads) {
+  assert(num_threads > 0);
+  thread_pool_free(scene->solver_pool);
+  // the thread calling scene_tick() solves islands too
+  scene->solver_pool = thread_pool_init(num_threads - 1);
+}
+
+void scene_set_fixed_step(scene_t *scene, double tick_rate, size_t max_steps) {
+  assert(tick_rate > 0 && max_steps > 0);
+  scene->fixed_dt = 1.0 / tick_rate;
+  scene->max_steps = max_steps;
+}
+
+void scene_set_sleeping(scene_t *scene, double sleep_velocity,
+                        double sleep_time) {
+  assert(sleep_velocity >= 0 && sleep_time >= 0);
+  scene->sleep_velocity = sleep_velocity;
+  scene->sleep_time = sleep_time;
+}
+
+void scene_set_substepping(scene_t *scene, double max_travel,
+                           size_t max_substeps) {
+  assert(max_travel >= 0 && max_substeps > 0);
+  scene->substep_travel = max_travel;
+  scene->max_substeps = max_substeps;
+}
+
+size_t scene_get_substeps(scene_t *scene) { return scene->substeps; }
+
+void scene_set_integrator(scene_t *scene, integrator_t integrator) {
+  scene->body_store->integrator = integrator;
+}
+
+void scene_set_grid_cell_size(scene_t *scene, double cell_size) {
+  spatial_hash_free(scene->broad_phase);
+  scene->broad_phase = spatial_hash_init(cell_size);
+  spatial_hash_free(scene->static_broad_phase);
+  scene->static_broad_phase = spatial_hash_init(cell_size);
+  scene->static_dirty = true;
+}
+
+void scene_set_broad_phase(scene_t *scene, broad_phase_t broad_phase) {
+  if (broad_phase == scene->broad_phase_kind) {
+    return;
+  }
+  size_t num_bodies = scene_bodies(scene);
+  for (size_t i = 0; i < num_bodies; i++) {
+    scene_broad_phase_remove(scene, scene_get_body(scene, i));
+  }
+  scene->broad_phase_kind = broad_phase;
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (!body_is_removed(body)) {
+      scene_broad_phase_insert(scene, body);
+    }
+  }
+  scene->static_dirty = true;
+}
+
+void scene_set_collision_engine(scene_t *scene, collision_engine_t engine) {
+  scene->collision_engine = engine;
+}
+
+void scene_set_type_collision_engine(scene_t *scene, const char *type1,
+                                     const char *type2,
+                                     collision_engine_t engine) {
+  collision_engine_t *override =
+      pair_table_get(scene->engine_pairs, type1, type2);
+  if (!override) {
+    override = malloc_safe(sizeof(collision_engine_t));
+    pair_table_put(scene->engine_pairs, type1, type2, override);
+    list_add(scene->engine_overrides, override);
+  }
+  *override = engine;
+}
+
 void scene_draw_text(scene_t *scene, const char *text, vector_t top_left, rgb_color_t color) {
   text_to_draw_t *to_draw = malloc_safe(sizeof(text_to_draw_t));
   to_draw->text = strdup_safe(text);
@@ -138,22 +793,1059 @@ list_t *scene_get_images_to_draw(scene_t *scene) {
   return scene->images_to_draw;
 }
 
-void scene_tick(scene_t *scene, double dt) {
+/**
+ * Gets the state kept for a pair of bodies the narrow phase is testing
+ * during the current tick, creating it if the pair was not tested last tick.
+ */
+static contact_t *scene_get_contact(scene_t *scene, body_t *body1,
+                                    body_t *body2) {
+  contact_t *contact = pair_table_get(scene->contact_pairs, body1, body2);
+  if (!contact) {
+    contact = malloc_safe(sizeof(contact_t));
+    contact->body1 = body1;
+    contact->body2 = body2;
+    contact->last_collided_tick = 0;
+    contact->separating_axis = VEC_ZERO;
+    contact->simplex = (gjk_simplex_t){0};
+    contact->normal_impulse = 0;
+    pair_table_put(scene->contact_pairs, body1, body2, contact);
+    list_add(scene->contacts, contact);
+  }
+  contact->last_tested_tick = scene->tick;
+  return contact;
+}
+
+/**
+ * Forgets pairs the broad phase stopped reporting this tick or that involve
+ * a removed body, so a freed body's address can never match a stale contact.
+ */
+static void scene_prune_contacts(scene_t *scene) {
+  size_t num_contacts = list_size(scene->contacts);
+  for (size_t i = 0; i < num_contacts; i++) {
+    contact_t *contact = list_get(scene->contacts, i);
+    if (contact->last_tested_tick != scene->tick ||
+        body_is_removed(contact->body1) || body_is_removed(contact->body2)) {
+      pair_table_remove(scene->contact_pairs, contact->body1, contact->body2);
+      // order does not matter, so fill the gap with the last contact
+      contact_t *last = list_remove(scene->contacts, num_contacts - 1);
+      if (i < num_contacts - 1) {
+        list_set(scene->contacts, i, last);
+      }
+      free(contact);
+      i--;
+      num_contacts--;
+    }
+  }
+}
+
+/**
+ * Calls a contact handler every tick the bodies collide,
+ * or a collision handler only when they start colliding.
+ * Swept collisions are found after the contact solver has run,
+ * so they only call collision handlers.
+ */
+static void scene_call_handler(collision_handler_t handler,
+                               contact_handler_t contact_handler, void *aux,
+                               body_t *body1, body_t *body2,
+                               const collision_info_t *collision,
+                               bool was_colliding) {
+  if (contact_handler) {
+    contact_handler(body1, body2, collision, aux);
+  } else if (!was_colliding) {
+    handler(body1, body2, collision->axis, aux);
+  }
+}
+
+/**
+ * Finds the first collision and rule registered on a pair of bodies.
+ * Returns whether there are any.
+ */
+static bool scene_get_handlers(scene_t *scene, body_t *body1, body_t *body2,
+                               collision_entry_t **entry,
+                               collision_rule_t **rule) {
+  *entry = pair_table_get(scene->collision_pairs, body1, body2);
+  *rule = NULL;
+  if (body1->type && body2->type) {
+    *rule = pair_table_get(scene->rule_pairs, body1->type, body2->type);
+  }
+  return *entry || *rule;
+}
+
+/**
+ * Calls the handlers registered on a pair of colliding bodies,
+ * given the collision seen from body1.
+ */
+static void scene_call_handlers(collision_entry_t *entry,
+                                collision_rule_t *rule, body_t *body1,
+                                body_t *body2, const collision_info_t *info,
+                                bool was_colliding) {
+  // the same collision seen from body2; the contact points do not change
+  collision_info_t flipped = *info;
+  flipped.axis = vec_negate(info->axis);
+  for (; entry; entry = entry->next) {
+    if (entry->body1 == body1) {
+      scene_call_handler(entry->handler, entry->contact_handler, entry->aux,
+                         body1, body2, info, was_colliding);
+    } else {
+      scene_call_handler(entry->handler, entry->contact_handler, entry->aux,
+                         body2, body1, &flipped, was_colliding);
+    }
+  }
+  for (; rule; rule = rule->next) {
+    if (rule->type1 == body1->type) {
+      scene_call_handler(rule->handler, rule->contact_handler, rule->aux,
+                         body1, body2, info, was_colliding);
+    } else {
+      scene_call_handler(rule->handler, rule->contact_handler, rule->aux,
+                         body2, body1, &flipped, was_colliding);
+    }
+  }
+}
+
+// narrow phase for one pair of bodies found by the broad phase
+static void scene_collide_pair(body_t *body1, body_t *body2, scene_t *scene) {
+  collision_entry_t *entry;
+  collision_rule_t *rule;
+  if (!scene_layers_collide(scene, body1, body2) ||
+      !scene_get_handlers(scene, body1, body2, &entry, &rule)) {
+    return;
+  }
+
+  contact_t *contact = scene_get_contact(scene, body1, body2);
+  collision_engine_t engine = scene->collision_engine;
+  if (body1->type && body2->type) {
+    collision_engine_t *override =
+        pair_table_get(scene->engine_pairs, body1->type, body2->type);
+    if (override) {
+      engine = *override;
+    }
+  }
+  collision_info_t info;
+  if (engine == COLLISION_ENGINE_GJK) {
+    // the cached simplex indexes the contact's bodies in their order
+    bool swapped = contact->body1 != body1;
+    info = body_collide_gjk(contact->body1, contact->body2, &contact->simplex);
+    if (swapped) {
+      info.axis = vec_negate(info.axis);
+    }
+  } else {
+    info = body_collide_cached(body1, body2, &contact->separating_axis);
+  }
+  if (!info.collided) {
+    contact->normal_impulse = 0;
+    return;
+  }
+  bool was_colliding = contact->last_collided_tick + 1 == scene->tick;
+  contact->last_collided_tick = scene->tick;
+  scene_call_handlers(entry, rule, body1, body2, &info, was_colliding);
+}
+
+static double inverse_mass(body_t *body) {
+  double mass = body_get_mass(body);
+  return mass == INFINITY ? 0 : 1 / mass;
+}
+
+// the velocity a body will have after this tick
+static vector_t solver_velocity(body_t *body, double inverse_mass, double dt) {
+  // bodies that cannot move are shared between islands, so they are only read
+  if (inverse_mass == 0) {
+    return body_get_velocity(body);
+  }
+  return body_get_next_velocity(body, dt);
+}
+
+// the velocity body2 is moving away from body1 at after this tick
+static double separating_velocity(solver_contact_t *solver_contact,
+                                  double dt) {
+  vector_t velocity1 = solver_velocity(solver_contact->body1,
+                                       solver_contact->inverse_mass1, dt);
+  vector_t velocity2 = solver_velocity(solver_contact->body2,
+                                       solver_contact->inverse_mass2, dt);
+  return vec_dot(vec_subtract(velocity2, velocity1), solver_contact->axis);
+}
+
+// applies an impulse from body1 to body2 along the axis
+static void apply_solver_impulse(solver_contact_t *solver_contact,
+                                 double impulse) {
+  vector_t impulse_vector = vec_multiply(impulse, solver_contact->axis);
+  if (solver_contact->inverse_mass1 > 0) {
+    body_add_impulse(solver_contact->body1, vec_negate(impulse_vector));
+  }
+  if (solver_contact->inverse_mass2 > 0) {
+    body_add_impulse(solver_contact->body2, impulse_vector);
+  }
+}
+
+/**
+ * Grows an array to hold at least a given number of elements.
+ *
+ * @return the array, which may have moved
+ */
+static void *reserve(void *array, size_t *capacity, size_t needed,
+                     size_t element_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  while (*capacity < needed) {
+    *capacity *= GROWTH_FACTOR;
+  }
+  return realloc_safe(array, *capacity * element_size);
+}
+
+void scene_add_solver_contact(scene_t *scene, body_t *body1, body_t *body2,
+                              const collision_info_t *collision,
+                              double elasticity) {
+  contact_t *contact = pair_table_get(scene->contact_pairs, body1, body2);
+  assert(contact && contact->last_tested_tick == scene->tick);
+  double inverse_mass1 = inverse_mass(body1);
+  double inverse_mass2 = inverse_mass(body2);
+  if (inverse_mass1 + inverse_mass2 == 0) {
+    return;
+  }
+
+  scene->solver_contacts = reserve(
+      scene->solver_contacts, &scene->solver_contacts_capacity,
+      scene->num_solver_contacts + 1, sizeof(solver_contact_t));
+  solver_contact_t *solver_contact =
+      &scene->solver_contacts[scene->num_solver_contacts++];
+  // the warm starting impulse is kept in the contact's order
+  vector_t axis = collision->axis;
+  if (contact->body1 != body1) {
+    body_t *swap = body1;
+    body1 = body2;
+    body2 = swap;
+    double swap_mass = inverse_mass1;
+    inverse_mass1 = inverse_mass2;
+    inverse_mass2 = swap_mass;
+    axis = vec_negate(axis);
+  }
+  *solver_contact = (solver_contact_t){
+      .contact = contact,
+      .body1 = body1,
+      .body2 = body2,
+      .axis = axis,
+      .depth = collision->depth,
+      .inverse_mass1 = inverse_mass1,
+      .inverse_mass2 = inverse_mass2,
+      .target_velocity = 0,
+      .impulse = 0,
+      .centroid1 = body_get_centroid(body1),
+      .centroid2 = body_get_centroid(body2),
+  };
+  double velocity = separating_velocity(solver_contact, scene->dt);
+  if (velocity < -RESTITUTION_THRESHOLD) {
+    solver_contact->target_velocity = -elasticity * velocity;
+  }
+}
+
+/**
+ * Resolves the contacts of one island with sequential impulses:
+ * each iteration pushes every pair of bodies towards its target velocity,
+ * keeping the total impulse on each pair pushing the bodies apart.
+ * Then moves the bodies out of each other the same way.
+ * Only touches the island's own bodies, so islands can be solved at once.
+ */
+static void scene_solve_island(scene_t *scene, size_t island) {
+  solver_contact_t *contacts =
+      &scene->island_contacts[scene->island_starts[island]];
+  size_t num_contacts =
+      scene->island_starts[island + 1] - scene->island_starts[island];
+  // start from last tick's impulses, which are usually nearly right
+  for (size_t i = 0; i < num_contacts; i++) {
+    contacts[i].impulse = contacts[i].contact->normal_impulse;
+    apply_solver_impulse(&contacts[i], contacts[i].impulse);
+  }
+  for (size_t iteration = 0; iteration < scene->solver_iterations;
+       iteration++) {
+    for (size_t i = 0; i < num_contacts; i++) {
+      solver_contact_t *contact = &contacts[i];
+      double velocity = separating_velocity(contact, scene->dt);
+      double delta = (contact->target_velocity - velocity) /
+                     (contact->inverse_mass1 + contact->inverse_mass2);
+      double impulse = fmax(contact->impulse + delta, 0);
+      apply_solver_impulse(contact, impulse - contact->impulse);
+      contact->impulse = impulse;
+    }
+  }
+  for (size_t i = 0; i < num_contacts; i++) {
+    contacts[i].contact->normal_impulse = contacts[i].impulse;
+  }
+
+  for (size_t iteration = 0; iteration < scene->solver_iterations;
+       iteration++) {
+    for (size_t i = 0; i < num_contacts; i++) {
+      solver_contact_t *contact = &contacts[i];
+      // the depth left after the corrections so far
+      vector_t moved1 =
+          vec_subtract(body_get_centroid(contact->body1), contact->centroid1);
+      vector_t moved2 =
+          vec_subtract(body_get_centroid(contact->body2), contact->centroid2);
+      double depth =
+          contact->depth - vec_dot(vec_subtract(moved2, moved1), contact->axis);
+      if (depth <= CORRECTION_SLOP) {
+        continue;
+      }
+      vector_t correction = vec_multiply(
+          CORRECTION_PERCENT * (depth - CORRECTION_SLOP) /
+              (contact->inverse_mass1 + contact->inverse_mass2),
+          contact->axis);
+      if (contact->inverse_mass1 > 0) {
+        body_set_centroid(
+            contact->body1,
+            vec_subtract(body_get_centroid(contact->body1),
+                         vec_multiply(contact->inverse_mass1, correction)));
+      }
+      if (contact->inverse_mass2 > 0) {
+        body_set_centroid(
+            contact->body2,
+            vec_add(body_get_centroid(contact->body2),
+                    vec_multiply(contact->inverse_mass2, correction)));
+      }
+    }
+  }
+}
+
+// finds the root of a node in the union-find forest, halving its path
+static size_t island_find(size_t *parents, size_t node) {
+  while (parents[node] != node) {
+    parents[node] = parents[parents[node]];
+    node = parents[node];
+  }
+  return node;
+}
+
+// numbers a body the first time it is seen in a contact
+static void island_number_body(body_t *body, double inverse_mass,
+                               size_t *num_nodes) {
+  if (inverse_mass > 0 && body->island_node == SIZE_MAX) {
+    body->island_node = (*num_nodes)++;
+  }
+}
+
+/**
+ * Splits the contacts added this tick into islands: groups of contacts
+ * connected through bodies that can move. Bodies that cannot move
+ * (e.g. walls) do not connect islands, since the solver never changes them.
+ * Fills island_contacts with the contacts grouped by island,
+ * keeping their order within each island, so solving the islands one by one
+ * gives exactly the same results as solving all the contacts together.
+ */
+static void scene_build_islands(scene_t *scene) {
+  size_t num_contacts = scene->num_solver_contacts;
+  solver_contact_t *contacts = scene->solver_contacts;
+  for (size_t i = 0; i < num_contacts; i++) {
+    contacts[i].body1->island_node = SIZE_MAX;
+    contacts[i].body2->island_node = SIZE_MAX;
+  }
+  size_t num_nodes = 0;
+  for (size_t i = 0; i < num_contacts; i++) {
+    island_number_body(contacts[i].body1, contacts[i].inverse_mass1,
+                       &num_nodes);
+    island_number_body(contacts[i].body2, contacts[i].inverse_mass2,
+                       &num_nodes);
+  }
+
+  // each node's parent, and then the island of each root
+  scene->island_parents =
+      reserve(scene->island_parents, &scene->island_parents_capacity,
+              2 * num_nodes, sizeof(size_t));
+  size_t *parents = scene->island_parents;
+  size_t *root_islands = &scene->island_parents[num_nodes];
+  for (size_t i = 0; i < num_nodes; i++) {
+    parents[i] = i;
+    root_islands[i] = SIZE_MAX;
+  }
+  for (size_t i = 0; i < num_contacts; i++) {
+    if (contacts[i].inverse_mass1 > 0 && contacts[i].inverse_mass2 > 0) {
+      size_t root1 = island_find(parents, contacts[i].body1->island_node);
+      size_t root2 = island_find(parents, contacts[i].body2->island_node);
+      if (root1 < root2) {
+        parents[root2] = root1;
+      } else {
+        parents[root1] = root2;
+      }
+    }
+  }
+
+  // islands are numbered in the order of their first contact
+  scene->contact_islands =
+      reserve(scene->contact_islands, &scene->contact_islands_capacity,
+              num_contacts, sizeof(size_t));
+  scene->num_islands = 0;
+  for (size_t i = 0; i < num_contacts; i++) {
+    body_t *body = contacts[i].inverse_mass1 > 0 ? contacts[i].body1
+                                                 : contacts[i].body2;
+    size_t root = island_find(parents, body->island_node);
+    if (root_islands[root] == SIZE_MAX) {
+      root_islands[root] = scene->num_islands++;
+    }
+    scene->contact_islands[i] = root_islands[root];
+  }
+
+  // a counting sort of the contacts by island
+  scene->island_starts =
+      reserve(scene->island_starts, &scene->island_starts_capacity,
+              scene->num_islands + 1, sizeof(size_t));
+  size_t *starts = scene->island_starts;
+  for (size_t i = 0; i <= scene->num_islands; i++) {
+    starts[i] = 0;
+  }
+  for (size_t i = 0; i < num_contacts; i++) {
+    starts[scene->contact_islands[i] + 1]++;
+  }
+  for (size_t i = 0; i < scene->num_islands; i++) {
+    starts[i + 1] += starts[i];
+  }
+  scene->island_contacts =
+      reserve(scene->island_contacts, &scene->island_contacts_capacity,
+              num_contacts, sizeof(solver_contact_t));
+  // starts[island] is used as the next free slot, then shifted back
+  for (size_t i = 0; i < num_contacts; i++) {
+    scene->island_contacts[starts[scene->contact_islands[i]]++] = contacts[i];
+  }
+  for (size_t i = scene->num_islands; i > 0; i--) {
+    starts[i] = starts[i - 1];
+  }
+  starts[0] = 0;
+}
+
+// solves the contacts added this tick, one island per job
+static void scene_solve_contacts(scene_t *scene) {
+  if (scene->num_solver_contacts == 0) {
+    return;
+  }
+  scene_build_islands(scene);
+  thread_pool_run(scene->solver_pool, (thread_pool_job_t)scene_solve_island,
+                  scene, scene->num_islands);
+  scene->num_solver_contacts = 0;
+}
+
+typedef struct {
+  scene_t *scene;
+  body_t *body;
+} static_query_aux_t;
+
+static void scene_collide_static(body_t *static_body, static_query_aux_t *aux) {
+  scene_collide_pair(aux->body, static_body, aux->scene);
+}
+
+static void scene_rebuild_static(scene_t *scene) {
+  spatial_hash_clear(scene->static_broad_phase);
+  size_t num_bodies = scene_bodies(scene);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body->broad_phase_resting && !body_is_removed(body)) {
+      spatial_hash_insert(scene->static_broad_phase, body, body_get_aabb(body));
+    }
+  }
+  scene->static_dirty = false;
+}
+
+/**
+ * Brings the broad phase up to date with where the bodies are now.
+ * Only the moving bodies are put back in the grid, and only the bodies
+ * that left their boxes are moved in the sweep and prune or AABB tree.
+ */
+static void scene_update_broad_phase(scene_t *scene) {
+  size_t num_bodies = scene_bodies(scene);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    bool resting = body_is_resting(body);
+    if (resting != body->broad_phase_resting) {
+      body->broad_phase_resting = resting;
+      scene->static_dirty = true;
+    }
+  }
+
+  if (scene->broad_phase_kind == BROAD_PHASE_GRID) {
+    if (scene->static_dirty) {
+      scene_rebuild_static(scene);
+    }
+    spatial_hash_clear(scene->broad_phase);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_t *body = scene_get_body(scene, i);
+      if (!body->broad_phase_resting) {
+        spatial_hash_insert(scene->broad_phase, body, body_get_aabb(body));
+      }
+    }
+    body_store_clear_changed(scene->body_store);
+    return;
+  }
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    // sleeping bodies are updated too, since they moved on the tick
+    // they fell asleep
+    if (body_is_static(body)) {
+      continue;
+    }
+    if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+      sweep_prune_update(scene->sweep_prune, body->broad_phase_proxy,
+                         body_get_aabb(body));
+    } else {
+      aabb_tree_move(scene->tree, body->broad_phase_proxy, body_get_aabb(body));
+    }
+  }
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    sweep_prune_update_pairs(scene->sweep_prune, NULL, NULL, NULL);
+  }
+  body_store_clear_changed(scene->body_store);
+}
+
+/**
+ * Brings the sweep and prune or AABB tree up to date by moving only
+ * the bodies that changed since it was last updated.
+ */
+static void scene_refresh_changed(scene_t *scene) {
+  body_store_t *store = scene->body_store;
+  for (size_t i = 0; i < store->num_changed; i++) {
+    body_t *body = store->changed[i];
+    bool resting = body_is_resting(body);
+    if (resting != body->broad_phase_resting) {
+      body->broad_phase_resting = resting;
+      scene->static_dirty = true;
+    }
+    if (!body->has_broad_phase_proxy || body_is_static(body)) {
+      continue;
+    }
+    if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+      sweep_prune_update(scene->sweep_prune, body->broad_phase_proxy,
+                         body_get_aabb(body));
+    } else {
+      aabb_tree_move(scene->tree, body->broad_phase_proxy, body_get_aabb(body));
+    }
+  }
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    sweep_prune_update_pairs(scene->sweep_prune, NULL, NULL, NULL);
+  }
+  body_store_clear_changed(store);
+}
+
+/**
+ * Calls a function with every body in the broad phase whose box overlaps
+ * the given one. Some of the bodies may not overlap it themselves.
+ */
+static void scene_query_broad_phase(scene_t *scene, aabb_t bounds,
+                                    scene_query_func_t func, void *aux) {
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    sweep_prune_query(scene->sweep_prune, bounds, (sweep_query_func_t)func,
+                      aux);
+  } else if (scene->broad_phase_kind == BROAD_PHASE_TREE) {
+    aabb_tree_query(scene->tree, bounds, (aabb_tree_query_func_t)func, aux);
+  } else {
+    spatial_hash_query(scene->broad_phase, bounds, (spatial_query_func_t)func,
+                       aux);
+    spatial_hash_query(scene->static_broad_phase, bounds,
+                       (spatial_query_func_t)func, aux);
+  }
+}
+
+// resting bodies are only tested against the bodies that are moving
+static void scene_collide_sap_pair(body_t *body1, body_t *body2,
+                                   scene_t *scene) {
+  if (!body1->broad_phase_resting || !body2->broad_phase_resting) {
+    scene_collide_pair(body1, body2, scene);
+  }
+}
+
+// collides a moving body with the bodies whose leaves its bounding box hits
+static void scene_collide_tree_candidate(body_t *other,
+                                         static_query_aux_t *aux) {
+  body_t *body = aux->body;
+  // pairs of moving bodies are found from both sides, so only keep one
+  if (other == body || (!other->broad_phase_resting &&
+                        other->broad_phase_proxy < body->broad_phase_proxy)) {
+    return;
+  }
+  // leaves are larger than the bodies in them
+  if (aabb_overlaps(body_get_aabb(body), body_get_aabb(other))) {
+    scene_collide_pair(body, other, aux->scene);
+  }
+}
+
+static void scene_handle_collisions(scene_t *scene) {
+  if (list_size(scene->collisions) == 0 &&
+      list_size(scene->collision_rules) == 0) {
+    return;
+  }
+  scene_update_broad_phase(scene);
+
+  size_t num_bodies = scene_bodies(scene);
+  if (scene->broad_phase_kind == BROAD_PHASE_SAP) {
+    sweep_prune_find_pairs(scene->sweep_prune,
+                           (sweep_pair_func_t)scene_collide_sap_pair, scene);
+  } else if (scene->broad_phase_kind == BROAD_PHASE_TREE) {
+    static_query_aux_t aux = {scene, NULL};
+    for (size_t i = 0; i < num_bodies; i++) {
+      aux.body = scene_get_body(scene, i);
+      if (!aux.body->broad_phase_resting) {
+        aabb_tree_query(scene->tree, body_get_aabb(aux.body),
+                        (aabb_tree_query_func_t)scene_collide_tree_candidate,
+                        &aux);
+      }
+    }
+  } else {
+    spatial_hash_find_pairs(scene->broad_phase,
+                            (spatial_pair_func_t)scene_collide_pair, scene);
+    // resting bodies are only tested against the bodies that are moving
+    if (spatial_hash_size(scene->static_broad_phase) > 0) {
+      static_query_aux_t aux = {scene, NULL};
+      for (size_t i = 0; i < num_bodies; i++) {
+        aux.body = scene_get_body(scene, i);
+        if (!aux.body->broad_phase_resting) {
+          spatial_hash_query(scene->static_broad_phase,
+                             body_get_aabb(aux.body),
+                             (spatial_query_func_t)scene_collide_static, &aux);
+        }
+      }
+    }
+  }
+  scene_prune_contacts(scene);
+}
+
+// how far a body will move during this tick (see body_tick())
+static vector_t tick_displacement(body_t *body, double dt) {
+  if (body_is_resting(body)) {
+    return VEC_ZERO;
+  }
+  return body_get_tick_displacement(body, dt);
+}
+
+/**
+ * Finds when a moving circle first touches a body
+ * (see find_circle_polygon_toi()).
+ */
+static double body_cast(body_t *body, vector_t start, vector_t displacement,
+                        double radius, collision_info_t *collision) {
+  if (body->shape_kind == BODY_SHAPE_CIRCLE) {
+    return find_circle_toi(start, displacement, radius,
+                           body_get_centroid(body), body->bounding_radius,
+                           collision);
+  }
+  return find_circle_polygon_toi(start, displacement, radius,
+                                 body_get_shape_unsafe(body), collision);
+}
+
+// the earliest impact found so far along a fast body's path
+typedef struct {
+  scene_t *scene;
+  body_t *body;
+  vector_t start;
+  vector_t displacement;
+  double toi;
+  body_t *target;
+  collision_info_t collision;
+} sweep_aux_t;
+
+static void scene_sweep_candidate(body_t *other, sweep_aux_t *aux) {
+  body_t *body = aux->body;
+  collision_entry_t *entry;
+  collision_rule_t *rule;
+  if (other == body || body_is_removed(other) ||
+      !scene_layers_collide(aux->scene, body, other) ||
+      !scene_get_handlers(aux->scene, body, other, &entry, &rule)) {
+    return;
+  }
+  // the narrow phase has already handled bodies that are touching
+  contact_t *contact = pair_table_get(aux->scene->contact_pairs, body, other);
+  if (contact && contact->last_collided_tick == aux->scene->tick) {
+    return;
+  }
+
+  vector_t displacement = vec_subtract(
+      aux->displacement, tick_displacement(other, aux->scene->dt));
+  collision_info_t collision;
+  double toi = body_cast(other, aux->start, displacement,
+                         body->bounding_radius, &collision);
+  // overlaps at the start are left to the narrow phase next tick
+  if (toi > 0 && toi < aux->toi) {
+    aux->toi = toi;
+    aux->target = other;
+    aux->collision = collision;
+  }
+}
+
+/**
+ * Sweeps a fast body along the path it is about to travel this tick.
+ * If it would touch a body it has collision handlers with,
+ * moves it to the first point of impact and calls those handlers,
+ * which may change its velocity (directly, or through the contact solver)
+ * before it covers the rest of the tick (see scene_rewind_swept()).
+ */
+static void scene_sweep_body(scene_t *scene, body_t *body) {
+  vector_t displacement = tick_displacement(body, scene->dt);
+  if (displacement.x == 0 && displacement.y == 0) {
+    return;
+  }
+  vector_t start_pos = body_get_centroid(body);
+  sweep_aux_t aux = {scene, body, start_pos, displacement, INFINITY, NULL};
+  aabb_t start = body_get_aabb(body);
+  aabb_t swept = {
+      {start.min.x + fmin(displacement.x, 0),
+       start.min.y + fmin(displacement.y, 0)},
+      {start.max.x + fmax(displacement.x, 0),
+       start.max.y + fmax(displacement.y, 0)}};
+  scene_query_broad_phase(scene, swept,
+                          (scene_query_func_t)scene_sweep_candidate, &aux);
+  if (!aux.target) {
+    return;
+  }
+
+  body_set_centroid(body,
+                    vec_add(start_pos, vec_multiply(aux.toi, displacement)));
+  scene->swept_bodies =
+      reserve(scene->swept_bodies, &scene->swept_bodies_capacity,
+              scene->num_swept_bodies + 1, sizeof(swept_body_t));
+  scene->swept_bodies[scene->num_swept_bodies++] =
+      (swept_body_t){body, aux.toi};
+  // the bodies are not touching yet this tick, so this is a new collision.
+  // Recording it stops the narrow phase reporting it again next tick.
+  contact_t *contact = scene_get_contact(scene, body, aux.target);
+  contact->last_collided_tick = scene->tick;
+  collision_entry_t *entry;
+  collision_rule_t *rule;
+  scene_get_handlers(scene, body, aux.target, &entry, &rule);
+  scene_call_handlers(entry, rule, body, aux.target, &aux.collision, false);
+}
+
+/**
+ * A fast body moved to its point of impact has already covered toi of its
+ * path this tick, so it should only travel for the remaining 1 - toi of the
+ * tick, at the velocity it leaves the impact with (the one the handlers and
+ * solver left it). The integration always takes a whole step, averaging the
+ * old and new velocities for INTEGRATOR_VERLET, so this shifts the body
+ * to where that step ends up at the right place.
+ */
+static void scene_rewind_swept(scene_t *scene) {
+  for (size_t i = 0; i < scene->num_swept_bodies; i++) {
+    swept_body_t *swept = &scene->swept_bodies[i];
+    body_t *body = swept->body;
+    if (body_is_removed(body) || body_is_resting(body)) {
+      continue;
+    }
+    vector_t rest = vec_multiply((1 - swept->toi) * scene->dt,
+                                 body_get_next_velocity(body, scene->dt));
+    vector_t step = body_get_tick_displacement(body, scene->dt);
+    body_set_centroid(body, vec_add(body_get_centroid(body),
+                                    vec_subtract(rest, step)));
+  }
+  scene->num_swept_bodies = 0;
+}
+
+static void scene_sweep_fast_bodies(scene_t *scene) {
+  if (list_size(scene->collisions) == 0 &&
+      list_size(scene->collision_rules) == 0) {
+    return;
+  }
+  size_t num_bodies = scene_bodies(scene);
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body->is_fast && !body_is_removed(body) && !body_is_resting(body)) {
+      scene_sweep_body(scene, body);
+    }
+  }
+}
+
+// whether every body a force creator acts on is asleep or static
+static bool force_info_is_resting(force_info_t *force_info) {
+  if (!force_info->bodies || list_size(force_info->bodies) == 0) {
+    return false;
+  }
+  size_t num_bodies = list_size(force_info->bodies);
+  for (size_t i = 0; i < num_bodies; i++) {
+    if (!body_is_resting(list_get(force_info->bodies, i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// puts a body to sleep once it has been slow for long enough
+static void scene_update_sleep(scene_t *scene, body_t *body, double dt) {
+  double spin = fabs(body_get_angular_velocity(body));
+  double speed =
+      vec_magnitude(body_get_velocity(body)) + spin * body->bounding_radius;
+  if (speed >= scene->sleep_velocity) {
+    body->slow_time = 0;
+    return;
+  }
+  body->slow_time += dt;
+  if (body->slow_time >= scene->sleep_time) {
+    body_sleep(body);
+  }
+}
+
+static void scene_substep(scene_t *scene, double dt) {
+  scene->tick++;
+  scene->dt = dt;
+
   size_t num_forcers = list_size(scene->force_creators);
   for (size_t i = 0; i < num_forcers; i++) {
     force_info_t *force_info = list_get(scene->force_creators, i);
-    force_info->forcer(force_info->aux);
+    if (!force_info_is_resting(force_info)) {
+      force_info->forcer(force_info->aux);
+    }
+  }
+
+  scene->broad_phase_in_use = true;
+  scene_handle_collisions(scene);
+  scene_solve_contacts(scene);
+  scene_sweep_fast_bodies(scene);
+  // contact handlers called by the sweep may have added solver contacts
+  scene_solve_contacts(scene);
+  scene->broad_phase_in_use = false;
+
+  scene_rewind_swept(scene);
+  body_store_integrate(scene->body_store, dt);
+
+  // the bodies themselves are only visited to reap or put them to sleep
+  bool any_removed = scene->body_store->num_removed > 0;
+  if (any_removed || scene->sleep_velocity > 0) {
+    size_t num_bodies = scene_bodies(scene);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_t *body = scene_get_body(scene, i);
+      if (body_is_removed(body)) {
+        scene_unlink_body(scene, body);
+        if (body->broad_phase_resting) {
+          scene->static_dirty = true;
+        }
+        scene_broad_phase_remove(scene, body);
+        scene_body_type(scene, body)->num_removed++;
+      } else if (scene->sleep_velocity > 0 && !body_is_resting(body)) {
+        scene_update_sleep(scene, body, dt);
+      }
+    }
+  }
+  if (any_removed) {
+    // handlers called by the sweep may have removed bodies since the
+    // narrow phase pruned contacts, so prune again before freeing them
+    scene_prune_contacts(scene);
+    scene_compact(scene);
   }
+}
 
+// the fewest sub-steps that keep every moving body within its travel limit
+static size_t scene_count_substeps(scene_t *scene, double dt) {
+  double substeps = 1;
   size_t num_bodies = scene_bodies(scene);
   for (size_t i = 0; i < num_bodies; i++) {
     body_t *body = scene_get_body(scene, i);
-    if (body_is_removed(body)) {
-      scene_remove_body_real(scene, i);
-      i--;
-      num_bodies--;
-    } else {
-      body_tick(body, dt);
+    if (body_is_resting(body) || body_is_removed(body)) {
+      continue;
+    }
+    aabb_t aabb = body_get_aabb(body);
+    double extent = fmin(aabb.max.x - aabb.min.x, aabb.max.y - aabb.min.y);
+    double spin = fabs(body_get_angular_velocity(body));
+    double speed =
+        vec_magnitude(body_get_velocity(body)) + spin * body->bounding_radius;
+    if (extent > 0) {
+      substeps = fmax(substeps,
+                      ceil(speed * dt / (scene->substep_travel * extent)));
     }
   }
-}
\ No newline at end of file
+  return substeps < scene->max_substeps ? (size_t)substeps
+                                        : scene->max_substeps;
+}
+
+void scene_tick(scene_t *scene, double dt) {
+  size_t substeps = 1;
+  if (scene->substep_travel > 0 && scene->max_substeps > 1) {
+    substeps = scene_count_substeps(scene, dt);
+  }
+  scene->substeps = substeps;
+  for (size_t i = 0; i < substeps; i++) {
+    scene_substep(scene, dt / substeps);
+  }
+}
+
+size_t scene_step_fixed(scene_t *scene, double frame_dt) {
+  scene->accumulator += frame_dt;
+  size_t steps = 0;
+  while (scene->accumulator >= scene->fixed_dt && steps < scene->max_steps) {
+    size_t num_bodies = scene_bodies(scene);
+    for (size_t i = 0; i < num_bodies; i++) {
+      body_save_transform(scene_get_body(scene, i));
+    }
+    scene_tick(scene, scene->fixed_dt);
+    scene->accumulator -= scene->fixed_dt;
+    steps++;
+  }
+  // after a long hitch, drop the time that could not be caught up on
+  // rather than falling further behind every frame
+  if (scene->accumulator >= scene->fixed_dt) {
+    scene->accumulator = fmod(scene->accumulator, scene->fixed_dt);
+  }
+  scene->interpolation = scene->accumulator / scene->fixed_dt;
+  return steps;
+}
+
+double scene_get_interpolation(scene_t *scene) { return scene->interpolation; }
+
+typedef struct {
+  const char *type;
+  aabb_t bounds;
+  // for radius queries, the circle a body's shape must touch
+  bool use_circle;
+  vector_t center;
+  double radius;
+  scene_query_func_t func;
+  void *aux;
+} query_aux_t;
+
+static bool query_matches(body_t *body, const char *type) {
+  return !body_is_removed(body) && (!type || body->type == type);
+}
+
+static void scene_query_candidate(body_t *body, query_aux_t *aux) {
+  if (!query_matches(body, aux->type) ||
+      !aabb_overlaps(body_get_aabb(body), aux->bounds)) {
+    return;
+  }
+  if (aux->use_circle) {
+    collision_info_t collision =
+        body->shape_kind == BODY_SHAPE_CIRCLE
+            ? find_circle_collision(aux->center, aux->radius,
+                                    body_get_centroid(body),
+                                    body->bounding_radius)
+            : find_circle_polygon_collision(aux->center, aux->radius,
+                                            body_get_shape_unsafe(body));
+    if (!collision.collided) {
+      return;
+    }
+  }
+  aux->func(body, aux->aux);
+}
+
+/**
+ * Brings the broad phase up to date before a query, unless the tick is
+ * reading it. Only the bodies that changed since the last update are
+ * refreshed, so queries between ticks (e.g. after moving a body with
+ * body_set_centroid()) don't rebuild the whole broad phase each time.
+ */
+static void scene_prepare_query(scene_t *scene) {
+  body_store_t *store = scene->body_store;
+  if (scene->broad_phase_in_use) {
+    return;
+  }
+  if (scene->broad_phase_kind != BROAD_PHASE_GRID) {
+    if (store->all_changed) {
+      scene_update_broad_phase(scene);
+    } else if (store->num_changed > 0) {
+      scene_refresh_changed(scene);
+    }
+  } else if (store->all_changed || scene->static_dirty ||
+             store->num_changed * GRID_STALE_FRACTION > scene_bodies(scene)) {
+    scene_update_broad_phase(scene);
+  }
+}
+
+// a query whose grid results skip the bodies with stale cells
+typedef struct {
+  scene_query_func_t func;
+  void *aux;
+} current_query_aux_t;
+
+static void scene_query_unchanged(body_t *body, current_query_aux_t *aux) {
+  if (!body->changed) {
+    aux->func(body, aux->aux);
+  }
+}
+
+/**
+ * Acts like scene_query_broad_phase(), but brings the broad phase up to
+ * date first (see scene_prepare_query()). The grid's cells for the bodies
+ * that changed since it was built are out of date, so those bodies are
+ * checked against the box one by one instead.
+ */
+static void scene_query_current(scene_t *scene, aabb_t bounds,
+                                scene_query_func_t func, void *aux) {
+  scene_prepare_query(scene);
+  body_store_t *store = scene->body_store;
+  if (scene->broad_phase_in_use || store->num_changed == 0) {
+    scene_query_broad_phase(scene, bounds, func, aux);
+    return;
+  }
+  current_query_aux_t current = {func, aux};
+  scene_query_broad_phase(scene, bounds,
+                          (scene_query_func_t)scene_query_unchanged, &current);
+  for (size_t i = 0; i < store->num_changed; i++) {
+    body_t *body = store->changed[i];
+    if (aabb_overlaps(body_get_aabb(body), bounds)) {
+      func(body, aux);
+    }
+  }
+}
+
+void scene_query_aabb(scene_t *scene, aabb_t bounds, const char *type,
+                      scene_query_func_t func, void *aux) {
+  query_aux_t query = {type, bounds, false, VEC_ZERO, 0, func, aux};
+  scene_query_current(scene, bounds,
+                      (scene_query_func_t)scene_query_candidate, &query);
+}
+
+void scene_query_radius(scene_t *scene, vector_t center, double radius,
+                        const char *type, scene_query_func_t func, void *aux) {
+  vector_t extent = {radius, radius};
+  aabb_t bounds = {vec_subtract(center, extent), vec_add(center, extent)};
+  query_aux_t query = {type, bounds, true, center, radius, func, aux};
+  scene_query_current(scene, bounds,
+                      (scene_query_func_t)scene_query_candidate, &query);
+}
+
+// the earliest hit found so far by a cast
+typedef struct {
+  const char *type;
+  vector_t start;
+  vector_t displacement;
+  double radius;
+  double toi;
+  body_t *body;
+  collision_info_t collision;
+} cast_aux_t;
+
+static void scene_cast_candidate(body_t *body, cast_aux_t *aux) {
+  if (!query_matches(body, aux->type)) {
+    return;
+  }
+  collision_info_t collision;
+  double toi =
+      body_cast(body, aux->start, aux->displacement, aux->radius, &collision);
+  if (toi < aux->toi) {
+    aux->toi = toi;
+    aux->body = body;
+    aux->collision = collision;
+  }
+}
+
+scene_hit_t scene_shape_cast(scene_t *scene, vector_t start, double radius,
+                             vector_t direction, double max_distance,
+                             const char *type) {
+  double length = vec_magnitude(direction);
+  assert(length > 0 && isfinite(max_distance) && radius >= 0);
+  vector_t displacement = vec_multiply(max_distance / length, direction);
+  cast_aux_t aux = {type, start, displacement, radius, INFINITY, NULL};
+  vector_t extent = {radius, radius};
+  vector_t end = vec_add(start, displacement);
+  aabb_t swept = {
+      vec_subtract((vector_t){fmin(start.x, end.x), fmin(start.y, end.y)},
+                   extent),
+      vec_add((vector_t){fmax(start.x, end.x), fmax(start.y, end.y)}, extent)};
+  scene_query_current(scene, swept, (scene_query_func_t)scene_cast_candidate,
+                      &aux);
+
+  scene_hit_t hit = {NULL, INFINITY, VEC_ZERO, VEC_ZERO};
+  if (!aux.body) {
+    return hit;
+  }
+  // the collision's axis points from the circle into the body
+  vector_t center = vec_add(start, vec_multiply(aux.toi, displacement));
+  hit.body = aux.body;
+  hit.distance = aux.toi * max_distance;
+  hit.point = vec_add(center, vec_multiply(radius, aux.collision.axis));
+  hit.normal = vec_negate(aux.collision.axis);
+  return hit;
+}
+
+scene_hit_t scene_raycast(scene_t *scene, vector_t start, vector_t direction,
+                          double max_distance, const char *type) {
+  return scene_shape_cast(scene, start, 0, direction, max_distance, type);
+}
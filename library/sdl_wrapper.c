@@ -163,9 +163,9 @@ void sdl_clear(void) {
   SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(list_t *points, rgb_color_t color) {
+void sdl_draw_polygon(polygon_t *polygon, rgb_color_t color) {
   // Check parameters
-  size_t n = list_size(points);
+  size_t n = polygon->size;
   assert(n >= 3);
   assert(0 <= color.r && color.r <= 1);
   assert(0 <= color.g && color.g <= 1);
@@ -182,8 +182,7 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
     // our only polygon is the rectangular health bar
     SDL_Vertex vertices_poly[n];
     for (size_t i = 0; i < n; i++) {
-      vector_t *vertex = list_get(points, i);
-      vector_t pixel = get_window_position(*vertex, window_center);
+      vector_t pixel = get_window_position(polygon->vertices[i], window_center);
       vertices_poly[i] = (SDL_Vertex) {{pixel.x, pixel.y}, {color.r * 255, color.g * 255, color.b * 255, 255}, {0, 0}};
     }
 
@@ -239,14 +238,16 @@ void sdl_render_scene(scene_t *scene) {
     free(to_draw);
   }
 
-  // draw bodies
+  // draw bodies between their last two ticks (see scene_step_fixed())
+  double alpha = scene_get_interpolation(scene);
   size_t body_count = scene_bodies(scene);
   for (size_t i = 0; i < body_count; i++) {
     body_t *body = scene_get_body(scene, i);
     image_t *image = body_get_image(body);
 
     if (image) {
-      vector_t centroid_window = get_window_position(body_get_centroid(body), window_center);
+      vector_t centroid = body_get_interpolated_centroid(body, alpha);
+      vector_t centroid_window = get_window_position(centroid, window_center);
       double scale = body_get_image_scale(body);
       vector_t offset = body_get_image_offset(body);
       SDL_FRect dstrect;
@@ -257,11 +258,16 @@ void sdl_render_scene(scene_t *scene) {
       center.y = dstrect.h / 2.0 + scale * window_scale * -offset.y;  // negative because screen space uses opposite convention
       dstrect.x = centroid_window.x - center.x;
       dstrect.y = centroid_window.y - center.y;
-      double rot = body_get_angle(body) + body_get_image_rotation(body);
+      double rot = body_get_interpolated_angle(body, alpha) +
+                   body_get_image_rotation(body);
       SDL_RenderCopyExF(renderer, image->texture, NULL, &dstrect, -rot / PI * 180.0, &center, 0);
+    } else if (alpha == 1.0 || body_is_static(body) || body_is_asleep(body)) {
+      polygon_t *shape = body_get_shape_unsafe(body);
+      sdl_draw_polygon(shape, body_get_color(body));
     } else {
-      list_t *shape = body_get_shape_unsafe(body);
+      polygon_t *shape = body_get_interpolated_shape(body, alpha);
       sdl_draw_polygon(shape, body_get_color(body));
+      poly_free(shape);
     }
   }
 
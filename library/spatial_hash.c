@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <math.h>
+#include <spatial_hash.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <util.h>
+
+static const size_t INITIAL_CAPACITY = 64;
+static const size_t GROWTH_FACTOR = 2;
+
+typedef struct {
+  void *item;
+  aabb_t bounds;
+} hash_item_t;
+
+// one entry per (cell, item) pair
+typedef struct {
+  long x;
+  long y;
+  size_t item_index;
+} cell_entry_t;
+
+struct spatial_hash {
+  double cell_size;
+  size_t num_items;
+  size_t items_capacity;
+  hash_item_t *items;
+  size_t num_entries;
+  size_t entries_capacity;
+  cell_entry_t *entries;
+  bool sorted;
+};
+
+spatial_hash_t *spatial_hash_init(double cell_size) {
+  assert(cell_size > 0);
+  spatial_hash_t *hash = malloc_safe(sizeof(spatial_hash_t));
+  hash->cell_size = cell_size;
+  hash->num_items = 0;
+  hash->items_capacity = INITIAL_CAPACITY;
+  hash->items = malloc_safe(INITIAL_CAPACITY * sizeof(hash_item_t));
+  hash->num_entries = 0;
+  hash->entries_capacity = INITIAL_CAPACITY;
+  hash->entries = malloc_safe(INITIAL_CAPACITY * sizeof(cell_entry_t));
+  hash->sorted = true;
+  return hash;
+}
+
+void spatial_hash_free(spatial_hash_t *hash) {
+  free(hash->items);
+  free(hash->entries);
+  free(hash);
+}
+
+void spatial_hash_clear(spatial_hash_t *hash) {
+  hash->num_items = 0;
+  hash->num_entries = 0;
+  hash->sorted = true;
+}
+
+size_t spatial_hash_size(spatial_hash_t *hash) { return hash->num_items; }
+
+static long cell_coord(spatial_hash_t *hash, double x) {
+  return (long)floor(x / hash->cell_size);
+}
+
+void spatial_hash_insert(spatial_hash_t *hash, void *item, aabb_t bounds) {
+  if (hash->num_items == hash->items_capacity) {
+    hash->items_capacity *= GROWTH_FACTOR;
+    hash->items =
+        realloc_safe(hash->items, hash->items_capacity * sizeof(hash_item_t));
+  }
+  size_t item_index = hash->num_items++;
+  hash->items[item_index] = (hash_item_t){item, bounds};
+
+  long min_x = cell_coord(hash, bounds.min.x);
+  long max_x = cell_coord(hash, bounds.max.x);
+  long min_y = cell_coord(hash, bounds.min.y);
+  long max_y = cell_coord(hash, bounds.max.y);
+  size_t num_cells = (max_x - min_x + 1) * (max_y - min_y + 1);
+  while (hash->num_entries + num_cells > hash->entries_capacity) {
+    hash->entries_capacity *= GROWTH_FACTOR;
+    hash->entries = realloc_safe(hash->entries, hash->entries_capacity *
+                                                    sizeof(cell_entry_t));
+  }
+  for (long x = min_x; x <= max_x; x++) {
+    for (long y = min_y; y <= max_y; y++) {
+      hash->entries[hash->num_entries++] = (cell_entry_t){x, y, item_index};
+    }
+  }
+  hash->sorted = false;
+}
+
+static int cell_entry_compare(const void *a, const void *b) {
+  const cell_entry_t *entry1 = a;
+  const cell_entry_t *entry2 = b;
+  if (entry1->x != entry2->x) {
+    return entry1->x < entry2->x ? -1 : 1;
+  }
+  if (entry1->y != entry2->y) {
+    return entry1->y < entry2->y ? -1 : 1;
+  }
+  if (entry1->item_index != entry2->item_index) {
+    return entry1->item_index < entry2->item_index ? -1 : 1;
+  }
+  return 0;
+}
+
+// groups the entries by cell, if any were inserted since the last sort
+static void spatial_hash_sort(spatial_hash_t *hash) {
+  if (!hash->sorted) {
+    qsort(hash->entries, hash->num_entries, sizeof(cell_entry_t),
+          cell_entry_compare);
+    hash->sorted = true;
+  }
+}
+
+void spatial_hash_find_pairs(spatial_hash_t *hash, spatial_pair_func_t func,
+                             void *aux) {
+  spatial_hash_sort(hash);
+
+  size_t cell_start = 0;
+  while (cell_start < hash->num_entries) {
+    long x = hash->entries[cell_start].x;
+    long y = hash->entries[cell_start].y;
+    size_t cell_end = cell_start + 1;
+    while (cell_end < hash->num_entries && hash->entries[cell_end].x == x &&
+           hash->entries[cell_end].y == y) {
+      cell_end++;
+    }
+
+    for (size_t i = cell_start; i < cell_end; i++) {
+      hash_item_t *item1 = &hash->items[hash->entries[i].item_index];
+      for (size_t j = i + 1; j < cell_end; j++) {
+        hash_item_t *item2 = &hash->items[hash->entries[j].item_index];
+        if (!aabb_overlaps(item1->bounds, item2->bounds)) {
+          continue;
+        }
+        // items sharing several cells are only reported from the cell
+        // containing the minimum corner of their overlap
+        long owner_x = cell_coord(
+            hash, fmax(item1->bounds.min.x, item2->bounds.min.x));
+        long owner_y = cell_coord(
+            hash, fmax(item1->bounds.min.y, item2->bounds.min.y));
+        if (owner_x == x && owner_y == y) {
+          func(item1->item, item2->item, aux);
+        }
+      }
+    }
+    cell_start = cell_end;
+  }
+}
+
+// index of the first entry in cell (x, y), or of where it would be
+static size_t find_cell_start(spatial_hash_t *hash, long x, long y) {
+  size_t low = 0;
+  size_t high = hash->num_entries;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    cell_entry_t *entry = &hash->entries[mid];
+    if (entry->x < x || (entry->x == x && entry->y < y)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+void spatial_hash_query(spatial_hash_t *hash, aabb_t bounds,
+                        spatial_query_func_t func, void *aux) {
+  spatial_hash_sort(hash);
+
+  long min_x = cell_coord(hash, bounds.min.x);
+  long max_x = cell_coord(hash, bounds.max.x);
+  long min_y = cell_coord(hash, bounds.min.y);
+  long max_y = cell_coord(hash, bounds.max.y);
+  for (long x = min_x; x <= max_x; x++) {
+    for (long y = min_y; y <= max_y; y++) {
+      for (size_t i = find_cell_start(hash, x, y);
+           i < hash->num_entries && hash->entries[i].x == x &&
+           hash->entries[i].y == y;
+           i++) {
+        hash_item_t *item = &hash->items[hash->entries[i].item_index];
+        if (!aabb_overlaps(item->bounds, bounds)) {
+          continue;
+        }
+        // as in spatial_hash_find_pairs(), report each item from one cell
+        long owner_x = cell_coord(hash, fmax(item->bounds.min.x, bounds.min.x));
+        long owner_y = cell_coord(hash, fmax(item->bounds.min.y, bounds.min.y));
+        if (owner_x == x && owner_y == y) {
+          func(item->item, aux);
+        }
+      }
+    }
+  }
+}
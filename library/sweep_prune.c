@@ -0,0 +1,306 @@
+#include <assert.h>
+#include <pair_table.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sweep_prune.h>
+#include <util.h>
+
+static const size_t INITIAL_CAPACITY = 64;
+static const size_t GROWTH_FACTOR = 2;
+static const size_t NUM_AXES = 2;
+
+typedef struct {
+  void *item;
+  aabb_t bounds;
+  bool in_use;
+} proxy_t;
+
+// one end of a bounding box along one axis
+typedef struct {
+  double value;
+  size_t proxy;
+  bool is_max;
+} end_t;
+
+typedef struct {
+  // proxy1 < proxy2
+  size_t proxy1;
+  size_t proxy2;
+  // the pair's index in pairs
+  size_t index;
+} sap_pair_t;
+
+struct sweep_prune {
+  proxy_t *proxies;
+  size_t num_proxies;
+  size_t proxies_capacity;
+  // proxies that were removed and can be reused
+  size_t *free_proxies;
+  size_t num_free;
+  size_t free_capacity;
+  // the ends of every box along x and along y, sorted if sorted is true
+  end_t *ends[2];
+  size_t num_ends;
+  size_t ends_capacity;
+  bool sorted;
+  // the overlapping pairs, and a map from their items to them
+  sap_pair_t **pairs;
+  size_t num_pairs;
+  size_t pairs_capacity;
+  pair_table_t *pair_table;
+  size_t size;
+};
+
+// grows an array to fit at least needed elements
+static void *reserve(void *array, size_t *capacity, size_t needed,
+                     size_t element_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  while (*capacity < needed) {
+    *capacity *= GROWTH_FACTOR;
+  }
+  return realloc_safe(array, *capacity * element_size);
+}
+
+sweep_prune_t *sweep_prune_init(void) {
+  sweep_prune_t *sap = malloc_safe(sizeof(sweep_prune_t));
+  sap->proxies = malloc_safe(INITIAL_CAPACITY * sizeof(proxy_t));
+  sap->num_proxies = 0;
+  sap->proxies_capacity = INITIAL_CAPACITY;
+  sap->free_proxies = malloc_safe(INITIAL_CAPACITY * sizeof(size_t));
+  sap->num_free = 0;
+  sap->free_capacity = INITIAL_CAPACITY;
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    sap->ends[axis] = malloc_safe(2 * INITIAL_CAPACITY * sizeof(end_t));
+  }
+  sap->num_ends = 0;
+  sap->ends_capacity = 2 * INITIAL_CAPACITY;
+  sap->sorted = true;
+  sap->pairs = malloc_safe(INITIAL_CAPACITY * sizeof(sap_pair_t *));
+  sap->num_pairs = 0;
+  sap->pairs_capacity = INITIAL_CAPACITY;
+  sap->pair_table = pair_table_init(INITIAL_CAPACITY);
+  sap->size = 0;
+  return sap;
+}
+
+void sweep_prune_free(sweep_prune_t *sap) {
+  for (size_t i = 0; i < sap->num_pairs; i++) {
+    free(sap->pairs[i]);
+  }
+  free(sap->pairs);
+  pair_table_free(sap->pair_table);
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    free(sap->ends[axis]);
+  }
+  free(sap->free_proxies);
+  free(sap->proxies);
+  free(sap);
+}
+
+size_t sweep_prune_size(sweep_prune_t *sap) { return sap->size; }
+
+static double end_value(aabb_t bounds, size_t axis, bool is_max) {
+  vector_t corner = is_max ? bounds.max : bounds.min;
+  return axis == 0 ? corner.x : corner.y;
+}
+
+size_t sweep_prune_insert(sweep_prune_t *sap, void *item, aabb_t bounds) {
+  size_t proxy;
+  if (sap->num_free > 0) {
+    proxy = sap->free_proxies[--sap->num_free];
+  } else {
+    sap->proxies = reserve(sap->proxies, &sap->proxies_capacity,
+                           sap->num_proxies + 1, sizeof(proxy_t));
+    proxy = sap->num_proxies++;
+  }
+  sap->proxies[proxy] = (proxy_t){item, bounds, true};
+
+  // the new ends start after every other end, as if the box were far
+  // to the right, and are sorted into place by the next update
+  size_t capacity = sap->ends_capacity;
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    capacity = sap->ends_capacity;
+    sap->ends[axis] = reserve(sap->ends[axis], &capacity, sap->num_ends + 2,
+                              sizeof(end_t));
+    end_t *ends = sap->ends[axis];
+    ends[sap->num_ends] = (end_t){end_value(bounds, axis, false), proxy, false};
+    ends[sap->num_ends + 1] =
+        (end_t){end_value(bounds, axis, true), proxy, true};
+  }
+  sap->ends_capacity = capacity;
+  sap->num_ends += 2;
+  sap->sorted = false;
+  sap->size++;
+  return proxy;
+}
+
+void sweep_prune_update(sweep_prune_t *sap, size_t proxy, aabb_t bounds) {
+  assert(proxy < sap->num_proxies && sap->proxies[proxy].in_use);
+  sap->proxies[proxy].bounds = bounds;
+  sap->sorted = false;
+}
+
+static void pair_remove_at(sweep_prune_t *sap, size_t index) {
+  sap_pair_t *pair = sap->pairs[index];
+  pair_table_remove(sap->pair_table, sap->proxies[pair->proxy1].item,
+                    sap->proxies[pair->proxy2].item);
+  // order does not matter, so fill the gap with the last pair
+  sap->num_pairs--;
+  if (index < sap->num_pairs) {
+    sap->pairs[index] = sap->pairs[sap->num_pairs];
+    sap->pairs[index]->index = index;
+  }
+  free(pair);
+}
+
+void sweep_prune_remove(sweep_prune_t *sap, size_t proxy) {
+  assert(proxy < sap->num_proxies && sap->proxies[proxy].in_use);
+  // backwards, so the pairs moved into gaps have already been checked
+  for (size_t i = sap->num_pairs; i-- > 0;) {
+    sap_pair_t *pair = sap->pairs[i];
+    if (pair->proxy1 == proxy || pair->proxy2 == proxy) {
+      pair_remove_at(sap, i);
+    }
+  }
+  // removing ends keeps the others in order
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    end_t *ends = sap->ends[axis];
+    size_t kept = 0;
+    for (size_t i = 0; i < sap->num_ends; i++) {
+      if (ends[i].proxy != proxy) {
+        ends[kept++] = ends[i];
+      }
+    }
+  }
+  sap->num_ends -= 2;
+  sap->proxies[proxy].in_use = false;
+  sap->proxies[proxy].item = NULL;
+  sap->free_proxies = reserve(sap->free_proxies, &sap->free_capacity,
+                              sap->num_free + 1, sizeof(size_t));
+  sap->free_proxies[sap->num_free++] = proxy;
+  sap->size--;
+}
+
+static void pair_add(sweep_prune_t *sap, size_t proxy1, size_t proxy2,
+                     sweep_pair_func_t added, void *aux) {
+  if (proxy1 > proxy2) {
+    size_t temp = proxy1;
+    proxy1 = proxy2;
+    proxy2 = temp;
+  }
+  void *item1 = sap->proxies[proxy1].item;
+  void *item2 = sap->proxies[proxy2].item;
+  if (pair_table_get(sap->pair_table, item1, item2)) {
+    return;
+  }
+  sap_pair_t *pair = malloc_safe(sizeof(sap_pair_t));
+  *pair = (sap_pair_t){proxy1, proxy2, sap->num_pairs};
+  sap->pairs = reserve(sap->pairs, &sap->pairs_capacity, sap->num_pairs + 1,
+                       sizeof(sap_pair_t *));
+  sap->pairs[sap->num_pairs++] = pair;
+  pair_table_put(sap->pair_table, item1, item2, pair);
+  if (added) {
+    added(item1, item2, aux);
+  }
+}
+
+static void pair_remove(sweep_prune_t *sap, size_t proxy1, size_t proxy2,
+                        sweep_pair_func_t removed, void *aux) {
+  sap_pair_t *pair = pair_table_get(sap->pair_table, sap->proxies[proxy1].item,
+                                    sap->proxies[proxy2].item);
+  if (!pair) {
+    return;
+  }
+  void *item1 = sap->proxies[pair->proxy1].item;
+  void *item2 = sap->proxies[pair->proxy2].item;
+  pair_remove_at(sap, pair->index);
+  if (removed) {
+    removed(item1, item2, aux);
+  }
+}
+
+/**
+ * Whether end1 belongs after end2.
+ * At equal values, minimums come first, so boxes that touch overlap.
+ */
+static bool end_after(end_t end1, end_t end2) {
+  return end1.value > end2.value ||
+         (end1.value == end2.value && end1.is_max && !end2.is_max);
+}
+
+/**
+ * Insertion sorts the ends along one axis.
+ * Whenever an end moves left past the end of another box, the boxes
+ * may have started overlapping (a minimum passing a maximum)
+ * or stopped overlapping along this axis (a maximum passing a minimum).
+ */
+static void sort_axis(sweep_prune_t *sap, size_t axis, sweep_pair_func_t added,
+                      sweep_pair_func_t removed, void *aux) {
+  end_t *ends = sap->ends[axis];
+  for (size_t i = 1; i < sap->num_ends; i++) {
+    end_t end = ends[i];
+    size_t j = i;
+    while (j > 0 && end_after(ends[j - 1], end)) {
+      end_t passed = ends[j - 1];
+      if (!end.is_max && passed.is_max) {
+        if (aabb_overlaps(sap->proxies[end.proxy].bounds,
+                          sap->proxies[passed.proxy].bounds)) {
+          pair_add(sap, end.proxy, passed.proxy, added, aux);
+        }
+      } else if (end.is_max && !passed.is_max) {
+        pair_remove(sap, end.proxy, passed.proxy, removed, aux);
+      }
+      ends[j] = passed;
+      j--;
+    }
+    ends[j] = end;
+  }
+}
+
+void sweep_prune_update_pairs(sweep_prune_t *sap, sweep_pair_func_t added,
+                              sweep_pair_func_t removed, void *aux) {
+  if (sap->sorted) {
+    return;
+  }
+  for (size_t axis = 0; axis < NUM_AXES; axis++) {
+    end_t *ends = sap->ends[axis];
+    for (size_t i = 0; i < sap->num_ends; i++) {
+      ends[i].value =
+          end_value(sap->proxies[ends[i].proxy].bounds, axis, ends[i].is_max);
+    }
+    sort_axis(sap, axis, added, removed, aux);
+  }
+  sap->sorted = true;
+}
+
+void sweep_prune_find_pairs(sweep_prune_t *sap, sweep_pair_func_t func,
+                            void *aux) {
+  for (size_t i = 0; i < sap->num_pairs; i++) {
+    sap_pair_t *pair = sap->pairs[i];
+    func(sap->proxies[pair->proxy1].item, sap->proxies[pair->proxy2].item,
+         aux);
+  }
+}
+
+void sweep_prune_query(sweep_prune_t *sap, aabb_t bounds,
+                       sweep_query_func_t func, void *aux) {
+  if (!sap->sorted) {
+    for (size_t proxy = 0; proxy < sap->num_proxies; proxy++) {
+      proxy_t *entry = &sap->proxies[proxy];
+      if (entry->in_use && aabb_overlaps(entry->bounds, bounds)) {
+        func(entry->item, aux);
+      }
+    }
+    return;
+  }
+  // boxes starting after the query box along x cannot overlap it
+  end_t *ends = sap->ends[0];
+  for (size_t i = 0; i < sap->num_ends && ends[i].value <= bounds.max.x; i++) {
+    proxy_t *entry = &sap->proxies[ends[i].proxy];
+    if (!ends[i].is_max && aabb_overlaps(entry->bounds, bounds)) {
+      func(entry->item, aux);
+    }
+  }
+}
@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <thread_pool.h>
+#include <util.h>
+
+// emscripten only provides stubs for pthreads unless built with -pthread
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define THREAD_POOL_NO_THREADS
+#endif
+
+struct thread_pool {
+  pthread_t *workers;
+  size_t num_workers;
+  pthread_mutex_t mutex;
+  // signaled when a batch is submitted or the pool is freed
+  pthread_cond_t batch_ready;
+  // signaled when the last job of a batch finishes
+  pthread_cond_t batch_done;
+  // the current batch, guarded by mutex
+  thread_pool_job_t job;
+  void *aux;
+  size_t num_jobs;
+  size_t next_job;
+  size_t jobs_done;
+  // incremented for each batch, so workers can tell a new batch has started
+  size_t batch;
+  bool stopping;
+};
+
+/**
+ * Runs jobs from the current batch until none are left to hand out.
+ * Must be called with the mutex locked, and returns with it locked.
+ */
+static void run_jobs(thread_pool_t *pool) {
+  while (pool->next_job < pool->num_jobs) {
+    size_t index = pool->next_job++;
+    pthread_mutex_unlock(&pool->mutex);
+    pool->job(pool->aux, index);
+    pthread_mutex_lock(&pool->mutex);
+    pool->jobs_done++;
+    if (pool->jobs_done == pool->num_jobs) {
+      pthread_cond_signal(&pool->batch_done);
+    }
+  }
+}
+
+static void *worker_main(void *arg) {
+  thread_pool_t *pool = arg;
+  pthread_mutex_lock(&pool->mutex);
+  size_t last_batch = pool->batch;
+  while (true) {
+    while (pool->batch == last_batch && !pool->stopping) {
+      pthread_cond_wait(&pool->batch_ready, &pool->mutex);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    last_batch = pool->batch;
+    run_jobs(pool);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+thread_pool_t *thread_pool_init(size_t num_workers) {
+#ifdef THREAD_POOL_NO_THREADS
+  num_workers = 0;
+#endif
+  thread_pool_t *pool = malloc_safe(sizeof(thread_pool_t));
+  pool->workers = malloc_safe((num_workers > 0 ? num_workers : 1) *
+                              sizeof(pthread_t));
+  pool->num_workers = num_workers;
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->batch_ready, NULL);
+  pthread_cond_init(&pool->batch_done, NULL);
+  pool->job = NULL;
+  pool->aux = NULL;
+  pool->num_jobs = 0;
+  pool->next_job = 0;
+  pool->jobs_done = 0;
+  pool->batch = 0;
+  pool->stopping = false;
+  for (size_t i = 0; i < num_workers; i++) {
+    int result = pthread_create(&pool->workers[i], NULL, worker_main, pool);
+    assert(result == 0);
+  }
+  return pool;
+}
+
+void thread_pool_free(thread_pool_t *pool) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->batch_ready);
+  pthread_mutex_unlock(&pool->mutex);
+  for (size_t i = 0; i < pool->num_workers; i++) {
+    pthread_join(pool->workers[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->batch_ready);
+  pthread_cond_destroy(&pool->batch_done);
+  free(pool->workers);
+  free(pool);
+}
+
+size_t thread_pool_workers(thread_pool_t *pool) { return pool->num_workers; }
+
+void thread_pool_run(thread_pool_t *pool, thread_pool_job_t job, void *aux,
+                     size_t num_jobs) {
+  // a single job is not worth waking the workers for
+  if (pool->num_workers == 0 || num_jobs <= 1) {
+    for (size_t i = 0; i < num_jobs; i++) {
+      job(aux, i);
+    }
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  pool->job = job;
+  pool->aux = aux;
+  pool->num_jobs = num_jobs;
+  pool->next_job = 0;
+  pool->jobs_done = 0;
+  pool->batch++;
+  pthread_cond_broadcast(&pool->batch_ready);
+  run_jobs(pool);
+  while (pool->jobs_done < pool->num_jobs) {
+    pthread_cond_wait(&pool->batch_done, &pool->mutex);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+}
@@ -26,8 +26,11 @@ static const double BULLET_RADIUS = 5.0;
 static const double BULLET_OFFSET_RATIO = 1.25;
 static const double BULLET_SPEED = 300.0;
 static const double BULLET_GRAVITY = 150000.0;
-static const char *BODY_TYPE_BULLET = "bullet";
-static const char *BODY_TYPE_TANK = "tank";
+// each tank has its own types, so collision rules can tell the teams apart
+static const char *BODY_TYPE_BULLET_RED = "bullet_red";
+static const char *BODY_TYPE_BULLET_BLUE = "bullet_blue";
+static const char *BODY_TYPE_TANK_RED = "tank_red";
+static const char *BODY_TYPE_TANK_BLUE = "tank_blue";
 
 static const vector_t TANK_SIZE = {40.0, 40.0};
 static const double TANK_MASS = 10.0;
@@ -35,6 +38,9 @@ static const double TANK_DRAG =
     200.0; // very high drag, so slows down almost instantly
 static const double TANK_FORCE = 20000.0;
 static const double TANK_ANGULAR_VEL = M_PI;
+// the physics runs at a fixed rate, whatever the display's frame rate
+static const double TICK_RATE = 60.0; // ticks/sec
+static const size_t MAX_TICKS_PER_FRAME = 5;
 static const vector_t TANK_IMAGE_OFFSET = (vector_t){0.0, 5.0};
 
 static const vector_t TANK1_INITIAL_POSITION = {80.0, 250.0};
@@ -52,6 +58,9 @@ static const rgb_color_t HEALTH_BAR_COLOR = {0.0, .76, 0.0};
 static const int NUM_OBSTACLES = 10;
 static const double OBSTACLE_ELASTICITY = 0.7;
 static const double SHOOT_INTERVAL = 1.40; // sec
+// obstacles pushed around by tanks settle, and are skipped until hit again
+static const double SLEEP_VELOCITY = 1.0; // pixels/sec
+static const double SLEEP_TIME = 0.5; // sec
 
 static const rgb_color_t TEXT_COLOR = {0.392, 0.584, 0.929};
 
@@ -62,6 +71,8 @@ typedef struct tank {
   double shot_cooldown;
   bool *was_shot;
   size_t points;
+  // 1 to drive forward, -1 to reverse, 0 to coast; applied every tick
+  double throttle;
 } tank_t;
 
 struct state {
@@ -70,14 +81,40 @@ struct state {
   tank_t tank_2;
 };
 
-static void create_tank(state_t *state, tank_t *tank, vector_t pos, char *type){
-  tank->body = body_init_with_info(
-      shape_rectangle(TANK_SIZE), TANK_MASS, COLOR_WHITE, BODY_TYPE_TANK);
+// pushes a tank along its heading, once per tick rather than once per frame
+static void tank_drive(tank_t *tank) {
+  if (tank->throttle != 0.0) {
+    vector_t force = vec_rotate((vector_t){tank->throttle * TANK_FORCE, 0.0},
+                                body_get_angle(tank->body));
+    body_add_force(tank->body, force);
+  }
+}
+
+/**
+ * Sets a tank's throttle (see tank_t).
+ * tank_drive() is skipped while the tank is asleep, so driving wakes it.
+ */
+static void tank_set_throttle(tank_t *tank, double throttle) {
+  tank->throttle = throttle;
+  if (throttle != 0.0) {
+    body_wake(tank->body);
+  }
+}
+
+static void create_tank(state_t *state, tank_t *tank, vector_t pos,
+                        const char *type, char *image) {
+  tank->body = body_init_with_polygon(
+      shape_rectangle(TANK_SIZE), TANK_MASS, COLOR_WHITE, type);
   body_set_centroid(tank->body, pos);
-  body_set_image(tank->body, type, .5);
+  body_set_image(tank->body, image, .5);
   body_set_image_rotation(tank->body, PI / 2);
   body_set_image_offset(tank->body, TANK_IMAGE_OFFSET);
   create_drag(state->scene, TANK_DRAG, tank->body);
+  tank->throttle = 0.0;
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, tank->body);
+  scene_add_bodies_force_creator(state->scene, (force_creator_t)tank_drive,
+                                 tank, bodies, NULL);
 }
 
 state_t *emscripten_init() {
@@ -89,10 +126,16 @@ state_t *emscripten_init() {
 
   state_t *state = malloc_safe(sizeof(state_t));
   state->scene = scene_init();
+  scene_set_sleeping(state->scene, SLEEP_VELOCITY, SLEEP_TIME);
+  scene_set_fixed_step(state->scene, TICK_RATE, MAX_TICKS_PER_FRAME);
+  // the map's long walls sit next to small crates and bullets
+  scene_set_broad_phase(state->scene, BROAD_PHASE_TREE);
 
   // creating the tanks
-  create_tank(state, &state->tank_1, TANK1_INITIAL_POSITION, "tank_red");
-  create_tank(state, &state->tank_2, TANK2_INITIAL_POSITION, "tank_blue");
+  create_tank(state, &state->tank_1, TANK1_INITIAL_POSITION,
+              BODY_TYPE_TANK_RED, "tank_red");
+  create_tank(state, &state->tank_2, TANK2_INITIAL_POSITION,
+              BODY_TYPE_TANK_BLUE, "tank_blue");
   body_set_rotation(state->tank_2.body, PI);
   scene_add_body(state->scene, state->tank_1.body);
   scene_add_body(state->scene, state->tank_2.body);
@@ -107,8 +150,8 @@ state_t *emscripten_init() {
   vector_t health_bar_init_size = {
       HEALTH_BAR_MAX_POINTS * HEALTH_BAR_UNIT_LENGTH, HEALTH_BAR_HEIGHT};
   state->tank_1.health_bar =
-      body_init_with_info(shape_rectangle(health_bar_init_size),
-                          HEALTH_BAR_MASS, HEALTH_BAR_COLOR, NULL);
+      body_init_with_polygon(shape_rectangle(health_bar_init_size),
+                             HEALTH_BAR_MASS, HEALTH_BAR_COLOR, NULL);
   vector_t health_bar_1_init_pos =
       vec_add(TANK1_INITIAL_POSITION, HEALTH_BAR_TANK_OFFSET);
   body_set_centroid(state->tank_1.health_bar, health_bar_1_init_pos);
@@ -118,8 +161,8 @@ state_t *emscripten_init() {
   *health2 = HEALTH_BAR_MAX_POINTS;
   state->tank_2.health = health2;
   state->tank_2.health_bar =
-      body_init_with_info(shape_rectangle(health_bar_init_size),
-                          HEALTH_BAR_MASS, HEALTH_BAR_COLOR, NULL);
+      body_init_with_polygon(shape_rectangle(health_bar_init_size),
+                             HEALTH_BAR_MASS, HEALTH_BAR_COLOR, NULL);
   vector_t health_bar_2_init_pos =
       vec_add(TANK2_INITIAL_POSITION, HEALTH_BAR_TANK_OFFSET);
   body_set_centroid(state->tank_2.health_bar, health_bar_2_init_pos);
@@ -136,46 +179,31 @@ state_t *emscripten_init() {
   // add obstacles
   map_init_obstacles(state->scene, SCREEN_SIZE, NUM_OBSTACLES);
 
-  // add collisions
-  size_t num_bodies = scene_bodies(state->scene);
-  for (size_t i = 0; i < num_bodies; i++) {
-    body_t *body_1 = scene_get_body(state->scene, i);
-    bool body_1_is_tank = body_1->type == BODY_TYPE_TANK;
-    bool body_1_is_wall = body_1->type == BODY_TYPE_WALL;
-    bool body_1_is_obstacle = body_1->type == BODY_TYPE_OBSTACLE;
-
-    for (size_t j = i + 1; j < num_bodies; j++) {
-      body_t *body_2 = scene_get_body(state->scene, j);
-      bool body_2_is_tank = body_2->type == BODY_TYPE_TANK;
-      bool body_2_is_wall = body_2->type == BODY_TYPE_WALL;
-      bool body_2_is_obstacle = body_2->type == BODY_TYPE_OBSTACLE;
-
-      // Tank x tank
-      if ((body_1_is_tank && body_2_is_tank)) {
-        create_physics_collision(state->scene, ELASTICITY, body_1, body_2);
-      }
-
-      // Tank x wall
-      if ((body_1_is_tank && body_2_is_wall) ||
-          (body_1_is_wall && body_2_is_tank)) {
-        create_physics_collision(state->scene, ELASTICITY, body_1, body_2);
-      }
-
-      // Tank x obstacle
-      if ((body_1_is_tank && body_2_is_obstacle) ||
-          (body_1_is_obstacle && body_2_is_tank)) {
-        create_physics_collision(state->scene, OBSTACLE_ELASTICITY, body_1,
-                                 body_2);
-      }
-
-      // Obstacle x wall
-      if ((body_1_is_obstacle && body_2_is_wall) ||
-          (body_1_is_wall && body_2_is_obstacle)) {
-        create_physics_collision(state->scene, OBSTACLE_ELASTICITY, body_1,
-                                 body_2);
-      }
-    }
+  // add collisions, once per pair of body types
+  scene_t *scene = state->scene;
+  create_physics_collision_rule(scene, ELASTICITY, BODY_TYPE_TANK_RED,
+                                BODY_TYPE_TANK_BLUE);
+  const char *tank_types[] = {BODY_TYPE_TANK_RED, BODY_TYPE_TANK_BLUE};
+  const char *bullet_types[] = {BODY_TYPE_BULLET_RED, BODY_TYPE_BULLET_BLUE};
+  for (size_t i = 0; i < 2; i++) {
+    create_physics_collision_rule(scene, ELASTICITY, tank_types[i],
+                                  BODY_TYPE_WALL);
+    create_physics_collision_rule(scene, OBSTACLE_ELASTICITY, tank_types[i],
+                                  BODY_TYPE_OBSTACLE);
+    create_bullet_wall_collision_rule(scene, BULLET_ELASTICITY,
+                                      bullet_types[i], BODY_TYPE_WALL);
+    create_bullet_obstacle_collision_rule(scene, BODY_TYPE_OBSTACLE,
+                                          bullet_types[i]);
   }
+  create_physics_collision_rule(scene, OBSTACLE_ELASTICITY, BODY_TYPE_OBSTACLE,
+                                BODY_TYPE_WALL);
+  // bullets only damage the other tank
+  create_bullet_tank_collision_rule(scene, BODY_TYPE_TANK_BLUE,
+                                    BODY_TYPE_BULLET_RED, state->tank_2.health,
+                                    state->tank_2.was_shot);
+  create_bullet_tank_collision_rule(scene, BODY_TYPE_TANK_RED,
+                                    BODY_TYPE_BULLET_BLUE, state->tank_1.health,
+                                    state->tank_1.was_shot);
 
   return state;
 }
@@ -186,23 +214,24 @@ static void update_health_bar(state_t *state, tank_t *tank) {
   if (tank == &state->tank_1) {
     body_remove(state->tank_1.health_bar);
     state->tank_1.health_bar =
-        body_init_with_info(shape_rectangle(health_bar_size), HEALTH_BAR_MASS,
-                            HEALTH_BAR_COLOR, NULL);
+        body_init_with_polygon(shape_rectangle(health_bar_size), HEALTH_BAR_MASS,
+                               HEALTH_BAR_COLOR, NULL);
     scene_add_body(state->scene, state->tank_1.health_bar);
   } else if (tank == &state->tank_2) {
     body_remove(state->tank_2.health_bar);
     state->tank_2.health_bar =
-        body_init_with_info(shape_rectangle(health_bar_size), HEALTH_BAR_MASS,
-                            HEALTH_BAR_COLOR, NULL);
+        body_init_with_polygon(shape_rectangle(health_bar_size), HEALTH_BAR_MASS,
+                               HEALTH_BAR_COLOR, NULL);
     scene_add_body(state->scene, state->tank_2.health_bar);
   }
 }
 
 static void shoot_bullet(state_t *state, tank_t *tank) {
   sound_play("minigun");
+  const char *bullet_type =
+      tank == &state->tank_1 ? BODY_TYPE_BULLET_RED : BODY_TYPE_BULLET_BLUE;
   body_t *bullet =
-      body_init_with_info(shape_circle_create(BULLET_RADIUS), BULLET_MASS,
-                          COLOR_WHITE, BODY_TYPE_BULLET);
+      body_init_circle(BULLET_RADIUS, BULLET_MASS, COLOR_WHITE, bullet_type);
   double angle = body_get_angle(tank->body);
   double bullet_offset = TANK_SIZE.y * BULLET_OFFSET_RATIO / 2;
   bullet->info = malloc_safe(sizeof(size_t));
@@ -215,44 +244,32 @@ static void shoot_bullet(state_t *state, tank_t *tank) {
   body_set_centroid(bullet, (vector_t){bullet_x, bullet_y});
   body_set_velocity(
       bullet, (vector_t){BULLET_SPEED * cos(angle), BULLET_SPEED * sin(angle)});
+  // fast enough to pass through a wall between ticks
+  body_set_fast(bullet);
   
 
   tank->shot_cooldown = SHOOT_INTERVAL;
   if (tank == &state->tank_1) {
-    create_bullet_tank_collision(state->scene, state->tank_2.body, bullet,
-                                 state->tank_2.health, state->tank_2.was_shot);
     create_newtonian_gravity(state->scene, BULLET_GRAVITY, state->tank_2.body,
                              bullet);
     body_set_image(bullet, "barrelBlack_top", .28); // actually red
   } else if (tank == &state->tank_2) {
-    create_bullet_tank_collision(state->scene, state->tank_1.body, bullet,
-                                 state->tank_1.health, state->tank_1.was_shot);
     create_newtonian_gravity(state->scene, BULLET_GRAVITY, state->tank_1.body,
                              bullet);
     body_set_image(bullet, "barrelBlue_top", .28);
   }
 
-  // wall and obstacle collisions
-  size_t num_bodies = scene_bodies(state->scene);
-  for (size_t i = 0; i < num_bodies; i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    if (body->type == BODY_TYPE_WALL) {
-      create_bullet_wall_collision(state->scene, BULLET_ELASTICITY, bullet, body);
-    }
-    if (body->type == BODY_TYPE_OBSTACLE) {
-      create_bullet_obstacle_collision(state->scene, body, bullet);
-    }
-  }
+  // collisions with walls, obstacles and tanks come from the type rules
   scene_add_body(state->scene, bullet);
 
 }
 
 static void clear_bullets(state_t *state) {
-  size_t num_bodies = scene_bodies(state->scene);
-  for (size_t i = 0; i < num_bodies; i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    if (body->type == BODY_TYPE_BULLET) {
-      body_remove(body);
+  const char *bullet_types[] = {BODY_TYPE_BULLET_RED, BODY_TYPE_BULLET_BLUE};
+  for (size_t i = 0; i < 2; i++) {
+    size_t num_bullets = scene_type_bodies(state->scene, bullet_types[i]);
+    for (size_t j = 0; j < num_bullets; j++) {
+      body_remove(scene_get_type_body(state->scene, bullet_types[i], j));
     }
   }
 }
@@ -264,10 +281,13 @@ static void tank_dead(state_t *state, tank_t *tank) {
     state->tank_2.points = state->tank_2.points + 1;
     body_set_centroid(state->tank_1.body, TANK1_INITIAL_POSITION);
     body_set_rotation(state->tank_1.body, 0);
+    // respawn in place instead of sliding across the screen
+    body_save_transform(state->tank_1.body);
   } else if (tank == &state->tank_2) {
     state->tank_1.points = state->tank_1.points + 1;
     body_set_centroid(state->tank_2.body, TANK2_INITIAL_POSITION);
     body_set_rotation(state->tank_2.body, PI);
+    body_save_transform(state->tank_2.body);
   }
   clear_bullets(state);
 }
@@ -284,22 +304,11 @@ static void reset (state_t *state) {
 }
 
 /**
- * rotate, but don't allow rotating into a wall (would cause glitches)
+ * turn at a constant rate: -1 clockwise, 1 counterclockwise, 0 to stop;
+ * if this turns the tank into a wall, the physics collision pushes it back out
 */
-static void tank_rotate(state_t *state, tank_t *tank, double angular_vel, double dt) {
-  double dtheta = angular_vel * dt;
-  body_set_rotation(tank->body, tank->body->angle + dtheta);
-  size_t num_bodies = scene_bodies(state->scene);
-  for (size_t i = 0; i < num_bodies; i++) {
-    body_t *body = scene_get_body(state->scene, i);
-    if (body->type == BODY_TYPE_WALL) {
-      collision_info_t collision = find_collision(body->shape, tank->body->shape);
-      if (collision.collided) {
-        body_set_rotation(tank->body, tank->body->angle - dtheta);
-        break;
-      }
-    }
-  }
+static void tank_turn(tank_t *tank, double direction) {
+  body_set_angular_velocity(tank->body, direction * TANK_ANGULAR_VEL);
 }
 
 static void healthbar_update(state_t *state, tank_t *tank) {
@@ -328,36 +337,36 @@ void emscripten_main(state_t *state) {
 
   // tank forward/backward movement
   if (sdl_get_key_pressed(UP_ARROW)) {
-    vector_t force = vec_rotate((vector_t){TANK_FORCE, 0.0},
-                                body_get_angle(state->tank_2.body));
-    body_add_force(state->tank_2.body, force);
+    tank_set_throttle(&state->tank_2, 1.0);
   } else if (sdl_get_key_pressed(DOWN_ARROW)) {
-    vector_t force = vec_rotate((vector_t){-TANK_FORCE, 0.0},
-                                body_get_angle(state->tank_2.body));
-    body_add_force(state->tank_2.body, force);
+    tank_set_throttle(&state->tank_2, -1.0);
+  } else {
+    tank_set_throttle(&state->tank_2, 0.0);
   }
 
   if (sdl_get_key_pressed('s')) {
-    vector_t force = vec_rotate((vector_t){-TANK_FORCE, 0.0},
-                                body_get_angle(state->tank_1.body));
-    body_add_force(state->tank_1.body, force);
+    tank_set_throttle(&state->tank_1, -1.0);
   } else if (sdl_get_key_pressed('w')) {
-    vector_t force = vec_rotate((vector_t){TANK_FORCE, 0.0},
-                                body_get_angle(state->tank_1.body));
-    body_add_force(state->tank_1.body, force);
+    tank_set_throttle(&state->tank_1, 1.0);
+  } else {
+    tank_set_throttle(&state->tank_1, 0.0);
   }
 
   // tank rotating
   if (sdl_get_key_pressed('d')) {
-    tank_rotate(state, &state->tank_1, -TANK_ANGULAR_VEL, dt);
+    tank_turn(&state->tank_1, -1.0);
   } else if (sdl_get_key_pressed('a')) {
-    tank_rotate(state, &state->tank_1, TANK_ANGULAR_VEL, dt);
+    tank_turn(&state->tank_1, 1.0);
+  } else {
+    tank_turn(&state->tank_1, 0.0);
   }
 
   if (sdl_get_key_pressed(RIGHT_ARROW)) {
-    tank_rotate(state, &state->tank_2, -TANK_ANGULAR_VEL, dt);
+    tank_turn(&state->tank_2, -1.0);
   } else if (sdl_get_key_pressed(LEFT_ARROW)) {
-    tank_rotate(state, &state->tank_2, TANK_ANGULAR_VEL, dt);
+    tank_turn(&state->tank_2, 1.0);
+  } else {
+    tank_turn(&state->tank_2, 0.0);
   }
 
   // bullet shooting
@@ -398,7 +407,7 @@ void emscripten_main(state_t *state) {
       just_reset = false;
   }
 
-  scene_tick(state->scene, dt);
+  scene_step_fixed(state->scene, dt);
   sdl_render_scene(state->scene);
 }
 
@@ -0,0 +1,114 @@
+#include "collision.h"
+#include "gjk.h"
+#include "shape.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Times the separating axis test against GJK/EPA on the shapes from shape.c.
+// Each pair of shapes is tested at many placements, about half colliding,
+// and each engine reports how many placements it found colliding.
+// The star and pacman are not convex; GJK treats them as their convex hulls,
+// so the engines may disagree on them.
+
+static const size_t NUM_PLACEMENTS = 256;
+static const size_t NUM_REPEATS = 40;
+static const double SHAPE_RADIUS = 10;
+
+typedef struct {
+  const char *name;
+  polygon_t *shape;
+} bench_shape_t;
+
+typedef enum { ENGINE_SAT, ENGINE_GJK, ENGINE_GJK_WARM } bench_engine_t;
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// copies of a shape at random positions around the origin
+static polygon_t **place_shapes(polygon_t *shape) {
+  polygon_t **placed = malloc(NUM_PLACEMENTS * sizeof(polygon_t *));
+  for (size_t i = 0; i < NUM_PLACEMENTS; i++) {
+    double distance = random_between(0, 2.5 * SHAPE_RADIUS);
+    double angle = random_between(0, 2 * M_PI);
+    placed[i] = poly_copy(shape);
+    poly_rotate(placed[i], random_between(0, 2 * M_PI), VEC_ZERO);
+    poly_translate(placed[i],
+                   (vector_t){distance * cos(angle), distance * sin(angle)});
+  }
+  return placed;
+}
+
+// returns the average time per test in nanoseconds,
+// and sets collisions to the number of placements found colliding
+static double time_engine(bench_engine_t engine, polygon_t *shape,
+                          polygon_t **placed, size_t *collisions) {
+  // each placement keeps its simplex across repeats, like a contact would
+  gjk_simplex_t *simplices = calloc(NUM_PLACEMENTS, sizeof(gjk_simplex_t));
+  *collisions = 0;
+  clock_t start = clock();
+  for (size_t repeat = 0; repeat < NUM_REPEATS; repeat++) {
+    for (size_t i = 0; i < NUM_PLACEMENTS; i++) {
+      collision_info_t collision;
+      switch (engine) {
+      case ENGINE_SAT:
+        collision = find_polygon_collision(shape, placed[i]);
+        break;
+      case ENGINE_GJK:
+        collision = find_gjk_collision(shape, placed[i]);
+        break;
+      default:
+        collision =
+            find_gjk_collision_cached(shape, placed[i], &simplices[i]);
+      }
+      if (repeat == 0) {
+        *collisions += collision.collided;
+      }
+    }
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  free(simplices);
+  return seconds * 1e9 / (NUM_REPEATS * NUM_PLACEMENTS);
+}
+
+int main() {
+  bench_shape_t shapes[] = {
+      {"rectangle", shape_rectangle((vector_t){SHAPE_RADIUS, SHAPE_RADIUS})},
+      {"star", shape_star_create(8, SHAPE_RADIUS, 0.5 * SHAPE_RADIUS)},
+      {"pacman", shape_pacman_create(SHAPE_RADIUS)},
+      {"circle", shape_circle_create(SHAPE_RADIUS)},
+      {"ellipse",
+       shape_ellipse((vector_t){2 * SHAPE_RADIUS, SHAPE_RADIUS})},
+  };
+  size_t num_shapes = sizeof(shapes) / sizeof(shapes[0]);
+
+  srand(0);
+  printf("%-20s %8s %9s %9s %9s %9s %9s\n", "shapes", "vertices", "SAT ns",
+         "GJK ns", "warm ns", "SAT hits", "GJK hits");
+  for (size_t i = 0; i < num_shapes; i++) {
+    for (size_t j = i; j < num_shapes; j++) {
+      polygon_t *shape = shapes[i].shape;
+      polygon_t **placed = place_shapes(shapes[j].shape);
+      size_t sat_hits, gjk_hits, warm_hits;
+      double sat = time_engine(ENGINE_SAT, shape, placed, &sat_hits);
+      double gjk = time_engine(ENGINE_GJK, shape, placed, &gjk_hits);
+      double warm = time_engine(ENGINE_GJK_WARM, shape, placed, &warm_hits);
+      char names[64];
+      snprintf(names, sizeof(names), "%s/%s", shapes[i].name, shapes[j].name);
+      printf("%-20s %4zu+%-3zu %9.1f %9.1f %9.1f %9zu %9zu\n", names,
+             shape->size, shapes[j].shape->size, sat, gjk, warm, sat_hits,
+             gjk_hits);
+
+      for (size_t k = 0; k < NUM_PLACEMENTS; k++) {
+        poly_free(placed[k]);
+      }
+      free(placed);
+    }
+  }
+
+  for (size_t i = 0; i < num_shapes; i++) {
+    poly_free(shapes[i].shape);
+  }
+}
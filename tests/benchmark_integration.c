@@ -0,0 +1,110 @@
+#include "body.h"
+#include "integration.h"
+#include "shape.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Times ticking a store full of bodies one body_tick() at a time against
+// each implementation of body_store_integrate(), for both integrators.
+// Every tenth body is asleep, like a scene with some settled bodies.
+
+static const size_t NUM_BODIES = 100000;
+static const size_t NUM_TICKS = 50;
+static const double DT = 1.0 / 60;
+static const size_t SLEEP_EVERY = 10;
+
+static const char *IMPL_NAMES[] = {"scalar", "SSE2", "AVX2"};
+static const integration_impl_t IMPLS[] = {
+    INTEGRATION_SCALAR, INTEGRATION_SSE2, INTEGRATION_AVX2};
+static const size_t NUM_IMPLS = sizeof(IMPLS) / sizeof(IMPLS[0]);
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// a little gravity each tick, as a force creator would add
+static void add_forces(body_t **bodies) {
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    if (i % SLEEP_EVERY != 0) {
+      body_add_force(bodies[i], (vector_t){0, -9.8 * body_get_mass(bodies[i])});
+    }
+  }
+}
+
+// returns the average time to integrate one body in nanoseconds;
+// impl is ignored if one_at_a_time is set
+static double time_ticks(body_store_t *store, body_t **bodies,
+                         integrator_t integrator, bool one_at_a_time,
+                         integration_impl_t impl) {
+  store->integrator = integrator;
+  if (!one_at_a_time) {
+    integration_set_impl(impl);
+  }
+  double seconds = 0;
+  for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+    // adding the forces is not timed, since both ways need it
+    add_forces(bodies);
+    clock_t start = clock();
+    if (one_at_a_time) {
+      for (size_t i = 0; i < NUM_BODIES; i++) {
+        if (!body_is_asleep(bodies[i])) {
+          body_tick(bodies[i], DT);
+        }
+      }
+    } else {
+      body_store_integrate(store, DT);
+    }
+    seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+  }
+  return seconds * 1e9 / (NUM_TICKS * NUM_BODIES);
+}
+
+int main() {
+  srand(0);
+  body_store_t *store = body_store_init(NUM_BODIES);
+  body_t **bodies = malloc(NUM_BODIES * sizeof(body_t *));
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    bodies[i] = body_init_with_polygon(shape_rectangle((vector_t){1, 1}),
+                                       random_between(0.5, 2),
+                                       (rgb_color_t){0, 0, 0}, NULL);
+    body_set_centroid(bodies[i], (vector_t){random_between(0, 1000),
+                                            random_between(0, 1000)});
+    body_store_add(store, bodies[i]);
+    body_set_velocity(bodies[i], (vector_t){random_between(-10, 10),
+                                            random_between(-10, 10)});
+    body_set_angular_velocity(bodies[i], random_between(-1, 1));
+    if (i % SLEEP_EVERY == 0) {
+      body_sleep(bodies[i]);
+    }
+  }
+
+  const char *integrator_names[] = {"Verlet", "Euler"};
+  integrator_t integrators[] = {INTEGRATOR_VERLET,
+                                INTEGRATOR_SEMI_IMPLICIT_EULER};
+  printf("%zu bodies, ns per body per tick\n", NUM_BODIES);
+  printf("%-10s %10s", "integrator", "body_tick");
+  for (size_t i = 0; i < NUM_IMPLS; i++) {
+    printf(" %9s", IMPL_NAMES[i]);
+  }
+  printf("\n");
+  for (size_t j = 0; j < 2; j++) {
+    printf("%-10s %10.2f", integrator_names[j],
+           time_ticks(store, bodies, integrators[j], true, 0));
+    for (size_t i = 0; i < NUM_IMPLS; i++) {
+      if (integration_impl_supported(IMPLS[i])) {
+        printf(" %9.2f",
+               time_ticks(store, bodies, integrators[j], false, IMPLS[i]));
+      } else {
+        printf(" %9s", "-");
+      }
+    }
+    printf("\n");
+  }
+
+  body_store_free(store);
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    body_free(bodies[i]);
+  }
+  free(bodies);
+}
@@ -0,0 +1,181 @@
+#include "aabb_tree.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct {
+  size_t count;
+  int *items[16];
+} items_t;
+
+static void record_item(void *item, void *aux) {
+  items_t *items = aux;
+  assert(items->count < 16);
+  items->items[items->count++] = item;
+}
+
+static bool has_item(items_t *items, int *item) {
+  for (size_t i = 0; i < items->count; i++) {
+    if (items->items[i] == item) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static aabb_t box(double min_x, double min_y, double max_x, double max_y) {
+  return (aabb_t){{min_x, min_y}, {max_x, max_y}};
+}
+
+void test_aabb_tree_query() {
+  int a, b, c;
+  aabb_tree_t *tree = aabb_tree_init(0);
+  aabb_tree_insert(tree, &a, box(0, 0, 10, 10));
+  size_t proxy_b = aabb_tree_insert(tree, &b, box(20, 0, 30, 10));
+  // a long wall next to small boxes
+  aabb_tree_insert(tree, &c, box(-500, 20, 500, 21));
+  assert(aabb_tree_size(tree) == 3);
+
+  items_t items = {0};
+  aabb_tree_query(tree, box(8, 8, 22, 12), record_item, &items);
+  assert(items.count == 2 && has_item(&items, &a) && has_item(&items, &b));
+  items.count = 0;
+  aabb_tree_query(tree, box(400, 15, 401, 25), record_item, &items);
+  assert(items.count == 1 && has_item(&items, &c));
+
+  aabb_tree_remove(tree, proxy_b);
+  assert(aabb_tree_size(tree) == 2);
+  items.count = 0;
+  aabb_tree_query(tree, box(8, 8, 22, 12), record_item, &items);
+  assert(items.count == 1 && has_item(&items, &a));
+  aabb_tree_free(tree);
+}
+
+// Small moves stay inside a leaf's margin and do not change the tree
+void test_aabb_tree_move() {
+  int a;
+  aabb_tree_t *tree = aabb_tree_init(1);
+  size_t proxy = aabb_tree_insert(tree, &a, box(0, 0, 10, 10));
+  aabb_t fat = aabb_tree_get_fat_bounds(tree, proxy);
+  assert(vec_isclose(fat.min, (vector_t){-1, -1}));
+  assert(vec_isclose(fat.max, (vector_t){11, 11}));
+
+  assert(!aabb_tree_move(tree, proxy, box(0.5, -0.5, 10.5, 9.5)));
+  fat = aabb_tree_get_fat_bounds(tree, proxy);
+  assert(vec_isclose(fat.min, (vector_t){-1, -1}));
+
+  assert(aabb_tree_move(tree, proxy, box(100, 100, 110, 110)));
+  fat = aabb_tree_get_fat_bounds(tree, proxy);
+  assert(vec_isclose(fat.min, (vector_t){99, 99}));
+  items_t items = {0};
+  aabb_tree_query(tree, box(0, 0, 10, 10), record_item, &items);
+  assert(items.count == 0);
+  aabb_tree_query(tree, box(105, 105, 106, 106), record_item, &items);
+  assert(items.count == 1 && has_item(&items, &a));
+  aabb_tree_free(tree);
+}
+
+// Inserting boxes in sorted order would make a list without rotations
+void test_aabb_tree_balanced() {
+  const size_t NUM_BOXES = 1024;
+  int items[NUM_BOXES];
+  size_t proxies[NUM_BOXES];
+  aabb_tree_t *tree = aabb_tree_init(0.1);
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    proxies[i] = aabb_tree_insert(tree, &items[i], box(i, 0, i + 1, 1));
+  }
+  assert(aabb_tree_size(tree) == NUM_BOXES);
+  assert(aabb_tree_height(tree) <= 2 * log2(NUM_BOXES));
+
+  for (size_t i = 0; i < NUM_BOXES; i += 2) {
+    aabb_tree_remove(tree, proxies[i]);
+  }
+  assert(aabb_tree_size(tree) == NUM_BOXES / 2);
+  assert(aabb_tree_height(tree) <= 2 * log2(NUM_BOXES / 2));
+  for (size_t i = 1; i < NUM_BOXES; i += 2) {
+    aabb_tree_remove(tree, proxies[i]);
+  }
+  assert(aabb_tree_size(tree) == 0 && aabb_tree_height(tree) == 0);
+  aabb_tree_free(tree);
+}
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+static void count_item(void *item, void *count) { (*(size_t *)count)++; }
+
+// Random boxes moving around are found exactly where their leaves are
+void test_aabb_tree_matches_brute_force() {
+  const size_t NUM_BOXES = 100;
+  srand(0);
+  int items[NUM_BOXES];
+  aabb_t bounds[NUM_BOXES];
+  size_t proxies[NUM_BOXES];
+  bool inserted[NUM_BOXES];
+  aabb_tree_t *tree = aabb_tree_init(0.5);
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    double x = random_between(0, 100);
+    double y = random_between(0, 100);
+    // sizes vary a lot, like walls and bullets
+    double size = i % 10 == 0 ? random_between(20, 80) : random_between(1, 5);
+    bounds[i] = box(x, y, x + size, y + 1);
+    proxies[i] = aabb_tree_insert(tree, &items[i], bounds[i]);
+    inserted[i] = true;
+  }
+
+  for (size_t step = 0; step < 100; step++) {
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      if (rand() % 50 == 0) {
+        if (inserted[i]) {
+          aabb_tree_remove(tree, proxies[i]);
+        } else {
+          proxies[i] = aabb_tree_insert(tree, &items[i], bounds[i]);
+        }
+        inserted[i] = !inserted[i];
+      }
+      if (inserted[i]) {
+        vector_t move = {random_between(-1, 1), random_between(-1, 1)};
+        bounds[i].min = vec_add(bounds[i].min, move);
+        bounds[i].max = vec_add(bounds[i].max, move);
+        aabb_tree_move(tree, proxies[i], bounds[i]);
+      }
+    }
+
+    aabb_t query = box(random_between(0, 80), random_between(0, 80), 0, 0);
+    query.max = vec_add(query.min, (vector_t){20, 20});
+    size_t expected = 0;
+    size_t num_inserted = 0;
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      if (inserted[i]) {
+        num_inserted++;
+        aabb_t fat = aabb_tree_get_fat_bounds(tree, proxies[i]);
+        expected += aabb_overlaps(fat, query);
+      }
+    }
+    size_t count = 0;
+    aabb_tree_query(tree, query, count_item, &count);
+    assert(count == expected);
+    assert(aabb_tree_size(tree) == num_inserted);
+    assert(aabb_tree_height(tree) <= 2 * log2(num_inserted));
+  }
+  aabb_tree_free(tree);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_aabb_tree_query)
+  DO_TEST(test_aabb_tree_move)
+  DO_TEST(test_aabb_tree_balanced)
+  DO_TEST(test_aabb_tree_matches_brute_force)
+
+  puts("aabb_tree_test PASS");
+}
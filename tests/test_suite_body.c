@@ -199,7 +199,177 @@ void test_body_remove() {
   body_free(body);
 }
 
+// A store ticks its bodies exactly like body_tick(),
+// and the bodies' getters and setters use the store's copy of their state
+void test_body_store() {
+  const size_t NUM_BODIES = 10;
+  const double DT = 0.01;
+  // too small at first, so the store has to grow
+  body_store_t *store = body_store_init(2);
+  body_t *stored[NUM_BODIES];
+  body_t *loose[NUM_BODIES];
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    stored[i] = body_init_circle(1, i + 1, (rgb_color_t){0, 0, 0}, NULL);
+    loose[i] = body_init_circle(1, i + 1, (rgb_color_t){0, 0, 0}, NULL);
+    body_set_centroid(stored[i], (vector_t){i, 0});
+    body_set_centroid(loose[i], (vector_t){i, 0});
+    body_store_add(store, stored[i]);
+    assert(stored[i]->store == store && stored[i]->slot == i);
+    body_set_velocity(stored[i], (vector_t){1, i});
+    body_set_velocity(loose[i], (vector_t){1, i});
+    body_set_angular_velocity(stored[i], 0.1 * i);
+    body_set_angular_velocity(loose[i], 0.1 * i);
+  }
+  assert(store->size == NUM_BODIES);
+  body_sleep(stored[3]);
+  body_sleep(loose[3]);
+  body_remove(stored[5]);
+  body_remove(loose[5]);
+  assert(store->num_removed == 1);
+
+  for (int step = 0; step < 100; step++) {
+    for (size_t i = 0; i < NUM_BODIES; i++) {
+      body_add_force(stored[i], (vector_t){i, -1});
+      body_add_force(loose[i], (vector_t){i, -1});
+      if (step == 0) {
+        body_add_impulse(stored[i], (vector_t){-1, 0});
+        body_add_impulse(loose[i], (vector_t){-1, 0});
+      }
+    }
+    // the forces woke up the sleeping body
+    body_sleep(stored[3]);
+    body_sleep(loose[3]);
+    body_store_integrate(store, DT);
+    for (size_t i = 0; i < NUM_BODIES; i++) {
+      if (!body_is_removed(loose[i]) && !body_is_asleep(loose[i])) {
+        body_tick(loose[i], DT);
+      }
+    }
+  }
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    assert(vec_equal(body_get_centroid(stored[i]),
+                     body_get_centroid(loose[i])));
+    assert(vec_equal(body_get_velocity(stored[i]),
+                     body_get_velocity(loose[i])));
+    assert(body_get_angle(stored[i]) == body_get_angle(loose[i]));
+    // the cached bounds follow the bodies the store moved
+    aabb_t bounds = body_get_aabb(stored[i]);
+    assert(vec_isclose(vec_multiply(0.5, vec_add(bounds.min, bounds.max)),
+                       body_get_centroid(loose[i])));
+  }
+
+  // compacting keeps the order, and gives the removed body its state back
+  body_store_compact(store);
+  assert(store->size == NUM_BODIES - 1 && store->num_removed == 0);
+  assert(stored[5]->store == NULL);
+  assert(vec_equal(body_get_centroid(stored[5]), (vector_t){5, 0}));
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    if (i != 5) {
+      assert(store->bodies[stored[i]->slot] == stored[i]);
+      assert(stored[i]->slot == (i < 5 ? i : i - 1));
+      assert(vec_equal(body_get_centroid(stored[i]),
+                       body_get_centroid(loose[i])));
+    }
+  }
+
+  body_store_free(store);
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    body_free(stored[i]);
+    body_free(loose[i]);
+  }
+}
+
+// Under constant forces, Verlet is exact and Euler moves a little further,
+// whether the bodies are ticked in one pass or one at a time
+void test_store_integrators() {
+  const double DT = 0.1;
+  const int STEPS = 10;
+  const vector_t FORCE = {2, -4};
+  integrator_t integrators[] = {INTEGRATOR_VERLET,
+                                INTEGRATOR_SEMI_IMPLICIT_EULER};
+  for (size_t i = 0; i < 2; i++) {
+    body_store_t *batched = body_store_init(1);
+    body_store_t *single = body_store_init(1);
+    batched->integrator = integrators[i];
+    single->integrator = integrators[i];
+    body_t *body1 = body_init_circle(1, 2, (rgb_color_t){0, 0, 0}, NULL);
+    body_t *body2 = body_init_circle(1, 2, (rgb_color_t){0, 0, 0}, NULL);
+    body_store_add(batched, body1);
+    body_store_add(single, body2);
+    for (int step = 0; step < STEPS; step++) {
+      body_add_force(body1, FORCE);
+      body_add_force(body2, FORCE);
+      vector_t predicted = body_get_tick_displacement(body1, DT);
+      vector_t before = body_get_centroid(body1);
+      body_store_integrate(batched, DT);
+      body_tick(body2, DT);
+      assert(vec_isclose(vec_subtract(body_get_centroid(body1), before),
+                         predicted));
+    }
+    assert(vec_equal(body_get_centroid(body1), body_get_centroid(body2)));
+    assert(vec_equal(body_get_velocity(body1), body_get_velocity(body2)));
+
+    // a = F / m = (1, -2), after t = 1 second
+    assert(vec_isclose(body_get_velocity(body1), (vector_t){1, -2}));
+    vector_t expected = integrators[i] == INTEGRATOR_VERLET
+                            ? (vector_t){0.5, -1}
+                            // a * dt^2 * (1 + 2 + ... + STEPS)
+                            : (vector_t){0.55, -1.1};
+    assert(vec_isclose(body_get_centroid(body1), expected));
+    body_store_free(batched);
+    body_store_free(single);
+    body_free(body1);
+    body_free(body2);
+  }
+}
+
+// A store lists each body that changed once, until the list is cleared
+void test_store_changed() {
+  body_store_t *store = body_store_init(4);
+  body_t *bodies[4];
+  for (size_t i = 0; i < 4; i++) {
+    bodies[i] = body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, NULL);
+    body_store_add(store, bodies[i]);
+  }
+  // adding the bodies changed them
+  assert(store->num_changed == 4 && !store->all_changed);
+  body_store_clear_changed(store);
+  assert(store->num_changed == 0 && !bodies[0]->changed);
+
+  body_set_centroid(bodies[1], (vector_t){1, 2});
+  body_set_rotation(bodies[1], 1);
+  body_sleep(bodies[2]);
+  body_set_velocity(bodies[3], VEC_ZERO);
+  assert(store->num_changed == 2);
+  assert(store->changed[0] == bodies[1] && store->changed[1] == bodies[2]);
+  assert(bodies[1]->changed && !bodies[3]->changed);
+
+  // integrating moves the bodies without listing them
+  body_store_clear_changed(store);
+  body_set_velocity(bodies[0], (vector_t){1, 0});
+  body_store_integrate(store, 1);
+  assert(store->all_changed);
+  body_set_centroid(bodies[3], VEC_ZERO);
+  assert(store->num_changed == 0);
+  body_store_clear_changed(store);
+  assert(!store->all_changed);
+
+  // compacting forgets the removed bodies
+  body_remove(bodies[0]);
+  assert(store->num_changed == 1);
+  body_store_compact(store);
+  assert(store->num_changed == 0 && store->all_changed);
+  assert(!bodies[0]->changed);
+
+  body_store_free(store);
+  for (size_t i = 0; i < 4; i++) {
+    body_free(bodies[i]);
+  }
+}
+
+// The fourth argument is the body's type; bodies no longer carry info
 void test_body_info() {
+  static const char *TYPE = "type";
   list_t *shape = list_init(3, free);
   vector_t *v = malloc(sizeof(*v));
   *v = (vector_t){+1, 0};
@@ -210,41 +380,13 @@ void test_body_info() {
   v = malloc(sizeof(*v));
   *v = (vector_t){-1, 0};
   list_add(shape, v);
-  int *info = malloc(sizeof(*info));
-  *info = 123;
-  body_t *body =
-      body_init_with_info(shape, 1, (rgb_color_t){0, 0, 0}, info, NULL);
-  assert(*(int *)body_get_info(body) == 123);
+  body_t *body = body_init_with_info(shape, 1, (rgb_color_t){0, 0, 0}, TYPE);
+  assert(body->type == TYPE);
+  assert(body_get_info(body) == NULL);
   body_free(body);
-  free(info);
-}
 
-void test_body_info_freer() {
-  list_t *shape = list_init(3, free);
-  vector_t *v = malloc(sizeof(*v));
-  *v = (vector_t){+1, 0};
-  list_add(shape, v);
-  v = malloc(sizeof(*v));
-  *v = (vector_t){0, +1};
-  list_add(shape, v);
-  v = malloc(sizeof(*v));
-  *v = (vector_t){-1, 0};
-  list_add(shape, v);
-  list_t *info = list_init(3, free);
-  int *info_elem = malloc(sizeof(*info_elem));
-  *info_elem = 10;
-  list_add(info, info_elem);
-  info_elem = malloc(sizeof(*info_elem));
-  *info_elem = 20;
-  list_add(info, info_elem);
-  info_elem = malloc(sizeof(*info_elem));
-  *info_elem = 30;
-  list_add(info, info_elem);
-  body_t *body = body_init_with_info(shape, 1, (rgb_color_t){0, 0, 0}, info,
-                                     (free_func_t)list_free);
-  assert(*(int *)list_get(body_get_info(body), 0) == 10);
-  assert(*(int *)list_get(body_get_info(body), 1) == 20);
-  assert(*(int *)list_get(body_get_info(body), 2) == 30);
+  body = body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, NULL);
+  assert(body->type == NULL);
   body_free(body);
 }
 
@@ -263,8 +405,10 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_infinite_mass)
   DO_TEST(test_forces)
   DO_TEST(test_body_remove)
+  DO_TEST(test_body_store)
+  DO_TEST(test_store_integrators)
+  DO_TEST(test_store_changed)
   DO_TEST(test_body_info)
-  DO_TEST(test_body_info_freer)
 
   puts("body_test PASS");
 }
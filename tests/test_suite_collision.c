@@ -42,6 +42,287 @@ void test_collision() {
   list_free(triangle3);
 }
 
+static polygon_t *make_square(double half_size) {
+  polygon_t *square = poly_init(4);
+  square->vertices[0] = (vector_t){-half_size, -half_size};
+  square->vertices[1] = (vector_t){half_size, -half_size};
+  square->vertices[2] = (vector_t){half_size, half_size};
+  square->vertices[3] = (vector_t){-half_size, half_size};
+  return square;
+}
+
+void test_circle_collision() {
+  collision_info_t collision =
+      find_circle_collision((vector_t){0, 0}, 1, (vector_t){3, 4}, 3.9);
+  assert(!collision.collided);
+  collision = find_circle_collision((vector_t){0, 0}, 1, (vector_t){3, 4}, 4);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0.6, 0.8}));
+  collision = find_circle_collision((vector_t){3, 4}, 1, (vector_t){0, 0}, 4);
+  assert(vec_isclose(collision.axis, (vector_t){-0.6, -0.8}));
+}
+
+void test_circle_polygon_collision() {
+  polygon_t *square = make_square(1);
+
+  // facing an edge
+  collision_info_t collision =
+      find_circle_polygon_collision((vector_t){2.5, 0}, 1, square);
+  assert(!collision.collided);
+  collision = find_circle_polygon_collision((vector_t){1.5, 0.5}, 1, square);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+
+  // near a corner, where the edge normals alone would report a collision
+  collision = find_circle_polygon_collision((vector_t){1.8, 1.8}, 1, square);
+  assert(!collision.collided);
+  collision = find_circle_polygon_collision((vector_t){1.6, 1.6}, 1, square);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){-M_SQRT1_2, -M_SQRT1_2}));
+
+  // the circle's center inside the polygon
+  collision = find_circle_polygon_collision((vector_t){0, -0.5}, 0.1, square);
+  assert(collision.collided);
+  poly_free(square);
+}
+
+void test_circle_toi() {
+  collision_info_t collision;
+  double toi = find_circle_toi((vector_t){-5, 0}, (vector_t){10, 0}, 1,
+                               VEC_ZERO, 1, &collision);
+  assert(isclose(toi, 0.3));
+  assert(collision.collided);
+  assert(isclose(collision.depth, 0));
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  assert(vec_isclose(collision.contacts[0], (vector_t){-1, 0}));
+
+  // passing by, moving away, and not moving far enough
+  toi = find_circle_toi((vector_t){-5, 2.5}, (vector_t){10, 0}, 1, VEC_ZERO,
+                        1, &collision);
+  assert(toi == INFINITY && !collision.collided);
+  toi = find_circle_toi((vector_t){-5, 0}, (vector_t){-10, 0}, 1, VEC_ZERO, 1,
+                        &collision);
+  assert(toi == INFINITY);
+  toi = find_circle_toi((vector_t){-5, 0}, (vector_t){2, 0}, 1, VEC_ZERO, 1,
+                        &collision);
+  assert(toi == INFINITY);
+
+  // already overlapping
+  toi = find_circle_toi((vector_t){-1, 0}, (vector_t){10, 0}, 1, VEC_ZERO, 1,
+                        &collision);
+  assert(toi == 0 && collision.collided);
+}
+
+void test_circle_polygon_toi() {
+  polygon_t *square = make_square(1);
+
+  // hitting an edge
+  collision_info_t collision;
+  double toi = find_circle_polygon_toi((vector_t){-5, 0.5}, (vector_t){10, 0},
+                                       1, square, &collision);
+  assert(isclose(toi, 0.3));
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  assert(vec_isclose(collision.contacts[0], (vector_t){-1, 0.5}));
+
+  // hitting a corner, past the end of the pushed out edge
+  toi = find_circle_polygon_toi((vector_t){-5, 1.5}, (vector_t){10, 0}, 1,
+                                square, &collision);
+  double corner_x = -1 - sqrt(0.75);
+  assert(isclose(toi, (corner_x + 5) / 10));
+  assert(vec_isclose(collision.axis, (vector_t){sqrt(0.75), -0.5}));
+  assert(vec_isclose(collision.contacts[0], (vector_t){-1, 1}));
+
+  // passing by, and stopping short
+  toi = find_circle_polygon_toi((vector_t){-5, 2.5}, (vector_t){10, 0}, 1,
+                                square, &collision);
+  assert(toi == INFINITY && !collision.collided);
+  toi = find_circle_polygon_toi((vector_t){-5, 0}, (vector_t){2, 0}, 1,
+                                square, &collision);
+  assert(toi == INFINITY);
+
+  // already overlapping
+  toi = find_circle_polygon_toi((vector_t){-1.5, 0}, (vector_t){10, 0}, 1,
+                                square, &collision);
+  assert(toi == 0 && collision.collided);
+  poly_free(square);
+
+  // a thin wall the circle would jump over between its start and end
+  polygon_t *wall = poly_init(4);
+  wall->vertices[0] = (vector_t){0, -5};
+  wall->vertices[1] = (vector_t){0.1, -5};
+  wall->vertices[2] = (vector_t){0.1, 5};
+  wall->vertices[3] = (vector_t){0, 5};
+  vector_t end = {5, 0};
+  assert(!find_circle_polygon_collision(end, 1, wall).collided);
+  toi = find_circle_polygon_toi((vector_t){-5, 0}, (vector_t){10, 0}, 1, wall,
+                                &collision);
+  assert(isclose(toi, 0.4));
+  poly_free(wall);
+}
+
+void test_polygon_get_box() {
+  box_t box;
+  polygon_t *square = make_square(2);
+  poly_rotate(square, 0.3, VEC_ZERO);
+  poly_translate(square, (vector_t){5, -1});
+  assert(polygon_get_box(square, &box));
+  assert(vec_isclose(box.center, (vector_t){5, -1}));
+  assert(vec_isclose(box.axis, (vector_t){cos(0.3), sin(0.3)}));
+  assert(vec_isclose(box.half_size, (vector_t){2, 2}));
+
+  // a parallelogram is not a box
+  square->vertices[2].x += 1;
+  square->vertices[3].x += 1;
+  assert(!polygon_get_box(square, &box));
+  poly_free(square);
+
+  polygon_t *triangle = poly_init(3);
+  for (size_t i = 0; i < 3; i++) {
+    triangle->vertices[i] = triangle1_points[i];
+  }
+  assert(!polygon_get_box(triangle, &box));
+  poly_free(triangle);
+}
+
+void test_box_collision() {
+  box_t box1 = {{0, 0}, {1, 0}, {2, 1}};
+  // a square rotated by 45 degrees, whose corner points at box1
+  box_t box2 = {{3.5, 0}, {M_SQRT1_2, M_SQRT1_2}, {1, 1}};
+  assert(!find_box_collision(box1, box2).collided);
+  box2.center.x = 3.3;
+  collision_info_t collision = find_box_collision(box1, box2);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  collision = find_box_collision(box2, box1);
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+
+  // the same boxes as polygons take the same path
+  polygon_t *square = make_square(1);
+  poly_rotate(square, M_PI / 4, VEC_ZERO);
+  poly_translate(square, (vector_t){3.3, 0});
+  polygon_t *rectangle = make_square(1);
+  for (size_t i = 0; i < 4; i++) {
+    rectangle->vertices[i].x *= 2;
+  }
+  collision = find_polygon_collision(rectangle, square);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  poly_free(square);
+  poly_free(rectangle);
+}
+
+void test_circle_box_collision() {
+  box_t box = {{0, 0}, {0, 1}, {1, 2}};
+  // beside the box's long side, which lies along x after the rotation
+  assert(!find_circle_box_collision((vector_t){0, 2.1}, 1, box).collided);
+  collision_info_t collision =
+      find_circle_box_collision((vector_t){0, 1.9}, 1, box);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0, -1}));
+  // near a corner
+  assert(!find_circle_box_collision((vector_t){2.8, 1.8}, 1, box).collided);
+  collision = find_circle_box_collision((vector_t){2.6, 1.6}, 1, box);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){-M_SQRT1_2, -M_SQRT1_2}));
+  // inside, closest to the left side
+  collision = find_circle_box_collision((vector_t){-1.5, 0.2}, 0.1, box);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+}
+
+void test_cached_axis() {
+  polygon_t *triangle1 = poly_init(3);
+  polygon_t *triangle2 = poly_init(3);
+  for (size_t i = 0; i < 3; i++) {
+    triangle1->vertices[i] = triangle1_points[i];
+    triangle2->vertices[i] = triangle2_points[i];
+  }
+  // the full search stores the separating axis
+  vector_t axis_cache = VEC_ZERO;
+  assert(!find_polygon_collision_cached(triangle1, triangle2, &axis_cache)
+              .collided);
+  assert(isclose(vec_magnitude(axis_cache), 1));
+  vector_t separating_axis = axis_cache;
+  // which is still used while it separates the shapes
+  assert(!find_polygon_collision_cached(triangle1, triangle2, &axis_cache)
+              .collided);
+  assert(vec_equal(axis_cache, separating_axis));
+
+  // a stale axis falls back to the full search
+  poly_translate(triangle2, (vector_t){-0.3, -0.3});
+  collision_info_t collision =
+      find_polygon_collision_cached(triangle1, triangle2, &axis_cache);
+  assert(collision.collided);
+  assert(vec_equal(axis_cache, collision.axis));
+  collision_info_t uncached = find_polygon_collision(triangle1, triangle2);
+  assert(vec_equal(uncached.axis, collision.axis));
+  poly_free(triangle1);
+  poly_free(triangle2);
+
+  box_t box1 = {{0, 0}, {1, 0}, {1, 1}};
+  box_t box2 = {{3, 0}, {1, 0}, {1, 1}};
+  axis_cache = (vector_t){0, 1};
+  assert(!find_box_collision_cached(box1, box2, &axis_cache).collided);
+  assert(vec_isclose(axis_cache, (vector_t){1, 0}));
+  box2.center.x = 1.5;
+  assert(find_box_collision_cached(box1, box2, &axis_cache).collided);
+}
+
+static bool has_contact(collision_info_t collision, vector_t point) {
+  for (size_t i = 0; i < collision.num_contacts; i++) {
+    if (vec_isclose(collision.contacts[i], point)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void test_contacts() {
+  // overlapping edges give two contacts, the ends of their overlap
+  polygon_t *square1 = make_square(1);
+  polygon_t *square2 = make_square(1);
+  poly_translate(square2, (vector_t){1.5, 0.5});
+  collision_info_t collision = find_polygon_collision(square1, square2);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  assert(isclose(collision.depth, 0.5));
+  assert(collision.num_contacts == 2);
+  assert(has_contact(collision, (vector_t){0.5, -0.5}));
+  assert(has_contact(collision, (vector_t){0.5, 1}));
+
+  // a corner poking into an edge gives one contact
+  polygon_t *diamond = make_square(M_SQRT1_2);
+  poly_rotate(diamond, M_PI / 4, VEC_ZERO);
+  poly_translate(diamond, (vector_t){0, 1.8});
+  collision = find_polygon_collision(square1, diamond);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0, 1}));
+  assert(isclose(collision.depth, 0.2));
+  assert(collision.num_contacts == 1);
+  assert(vec_isclose(collision.contacts[0], (vector_t){0, 0.8}));
+  // the axis points from the first shape to the second either way
+  collision = find_polygon_collision(diamond, square1);
+  assert(vec_isclose(collision.axis, (vector_t){0, -1}));
+  assert(isclose(collision.depth, 0.2));
+  poly_free(diamond);
+
+  // circles touch at the deepest point of the first circle
+  collision = find_circle_collision(VEC_ZERO, 1, (vector_t){1.5, 0}, 1);
+  assert(isclose(collision.depth, 0.5));
+  assert(collision.num_contacts == 1);
+  assert(vec_isclose(collision.contacts[0], (vector_t){1, 0}));
+  collision = find_circle_polygon_collision((vector_t){2.5, 0}, 2, square1);
+  assert(isclose(collision.depth, 0.5));
+  assert(vec_isclose(collision.contacts[0], (vector_t){0.5, 0}));
+  box_t box = {VEC_ZERO, {1, 0}, {1, 1}};
+  collision = find_circle_box_collision((vector_t){0.5, 0}, 1, box);
+  assert(isclose(collision.depth, 1.5));
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+  poly_free(square1);
+  poly_free(square2);
+}
+
 int main(int argc, char **argv) {
   // Run all tests? True if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -52,6 +333,15 @@ int main(int argc, char **argv) {
   }
 
   DO_TEST(test_collision)
+  DO_TEST(test_circle_collision)
+  DO_TEST(test_circle_polygon_collision)
+  DO_TEST(test_circle_toi)
+  DO_TEST(test_circle_polygon_toi)
+  DO_TEST(test_polygon_get_box)
+  DO_TEST(test_box_collision)
+  DO_TEST(test_circle_box_collision)
+  DO_TEST(test_cached_axis)
+  DO_TEST(test_contacts)
 
   puts("collision_test PASS");
 }
\ No newline at end of file
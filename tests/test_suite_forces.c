@@ -1,4 +1,5 @@
 #include "forces.h"
+#include "shape.h"
 #include "test_util.h"
 #include <assert.h>
 #include <math.h>
@@ -129,6 +130,96 @@ void test_collisions() {
   scene_free(scene);
 }
 
+// Tests that a body is bounced off a wall once, then pushed out of it
+void test_physics_collision() {
+  scene_t *scene = scene_init();
+  body_t *wall = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, wall);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body, (vector_t){1.5, 0});
+  body_set_velocity(body, (vector_t){-1, 0});
+  scene_add_body(scene, body);
+  create_physics_collision(scene, 1, wall, body);
+
+  scene_tick(scene, 0.01);
+  assert(vec_isclose(body_get_velocity(body), (vector_t){1, 0}));
+  // the body keeps its velocity while it is separating
+  body_set_velocity(body, VEC_ZERO);
+  for (int i = 0; i < 20; i++) {
+    scene_tick(scene, 0.01);
+  }
+  assert(vec_isclose(body_get_velocity(body), VEC_ZERO));
+  vector_t centroid = body_get_centroid(body);
+  assert(centroid.x > 1.98 && centroid.x <= 2);
+  assert(isclose(centroid.y, 0));
+  assert(vec_isclose(body_get_centroid(wall), VEC_ZERO));
+  scene_free(scene);
+}
+
+// Tests that a fast bullet bounces off a thin wall instead of passing it
+void test_bullet_bounce() {
+  scene_t *scene = scene_init();
+  body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){0.2, 10}),
+                                        INFINITY, (rgb_color_t){0, 0, 0},
+                                        NULL);
+  body_set_static(wall);
+  scene_add_body(scene, wall);
+  body_t *bullet = body_init_circle(0.5, 1, (rgb_color_t){0, 0, 0}, NULL);
+  size_t *bounces = malloc(sizeof(size_t));
+  *bounces = 0;
+  bullet->info = bounces;
+  bullet->freer = free;
+  body_set_centroid(bullet, (vector_t){-3, 0});
+  body_set_velocity(bullet, (vector_t){100, 0});
+  body_set_fast(bullet);
+  scene_add_body(scene, bullet);
+  create_bullet_wall_collision(scene, 1, bullet, wall);
+
+  scene_tick(scene, 0.1);
+  assert(*bounces == 1);
+  assert(vec_isclose(body_get_velocity(bullet), (vector_t){-100, 0}));
+  assert(body_get_centroid(bullet).x <= -0.6);
+  for (int i = 0; i < 5; i++) {
+    scene_tick(scene, 0.1);
+  }
+  assert(*bounces == 1);
+  assert(body_get_centroid(bullet).x < -30);
+  scene_free(scene);
+}
+
+void push_left(void *body) { body_add_force(body, (vector_t){-10, 0}); }
+
+// Tests that a body pushing another into a wall comes to rest at 30 Hz
+void test_stacked_collisions() {
+  const double DT = 1.0 / 30;
+  scene_t *scene = scene_init();
+  body_t *wall = body_init(make_shape(), INFINITY, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, wall);
+  body_t *middle = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(middle, (vector_t){2, 0});
+  scene_add_body(scene, middle);
+  body_t *pusher = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(pusher, (vector_t){4.5, 0});
+  body_set_velocity(pusher, (vector_t){-5, 0});
+  scene_add_body(scene, pusher);
+  scene_add_force_creator(scene, push_left, pusher, NULL);
+  create_physics_collision(scene, 0, wall, middle);
+  create_physics_collision(scene, 0, middle, pusher);
+  create_physics_collision(scene, 0, wall, pusher);
+
+  for (int i = 0; i < 90; i++) {
+    scene_tick(scene, DT);
+  }
+  double middle_x = body_get_centroid(middle).x;
+  double pusher_x = body_get_centroid(pusher).x;
+  assert(middle_x > 1.95 && middle_x <= 2);
+  assert(pusher_x - middle_x > 1.95 && pusher_x - middle_x <= 2);
+  assert(vec_magnitude(body_get_velocity(middle)) < 0.5);
+  assert(vec_magnitude(body_get_velocity(pusher)) < 0.5);
+  assert(vec_isclose(body_get_centroid(wall), VEC_ZERO));
+  scene_free(scene);
+}
+
 // Tests that force creators properly register their list of affected bodies.
 // If they don't, asan will report a heap-use-after-free failure.
 void test_forces_removed() {
@@ -162,6 +253,9 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_spring_sinusoid)
   DO_TEST(test_energy_conservation)
   DO_TEST(test_collisions)
+  DO_TEST(test_physics_collision)
+  DO_TEST(test_bullet_bounce)
+  DO_TEST(test_stacked_collisions)
   DO_TEST(test_forces_removed)
 
   puts("forces_test PASS");
@@ -0,0 +1,126 @@
+#include "collision.h"
+#include "gjk.h"
+#include "shape.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// a regular polygon with a random number of sides, radius, and rotation
+static polygon_t *random_polygon(vector_t center, double radius) {
+  size_t size = 3 + rand() % 10;
+  double rotation = random_between(0, 2 * M_PI);
+  polygon_t *polygon = poly_init(size);
+  for (size_t i = 0; i < size; i++) {
+    double angle = rotation + 2 * M_PI * i / size;
+    polygon->vertices[i] = vec_add(
+        center, (vector_t){radius * cos(angle), radius * sin(angle)});
+  }
+  return polygon;
+}
+
+void test_gjk_rectangles() {
+  polygon_t *rectangle1 = shape_rectangle((vector_t){4, 2});
+  polygon_t *rectangle2 = shape_rectangle((vector_t){4, 2});
+  poly_translate(rectangle2, (vector_t){5, 0});
+  assert(!find_gjk_collision(rectangle1, rectangle2).collided);
+
+  // touching along an edge counts as colliding, like the separating axis test
+  poly_translate(rectangle2, (vector_t){-1, 0});
+  assert(find_gjk_collision(rectangle1, rectangle2).collided);
+
+  // overlapping less in x than in y
+  poly_translate(rectangle2, (vector_t){-0.5, 0.2});
+  collision_info_t collision = find_gjk_collision(rectangle1, rectangle2);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  collision = find_gjk_collision(rectangle2, rectangle1);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){-1, 0}));
+
+  // overlapping less in y than in x
+  poly_translate(rectangle2, (vector_t){-3, 1.5});
+  collision = find_gjk_collision(rectangle1, rectangle2);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){0, 1}));
+  poly_free(rectangle1);
+  poly_free(rectangle2);
+}
+
+// GJK and the separating axis test must agree on random convex polygons
+void test_gjk_matches_sat() {
+  srand(0);
+  for (size_t i = 0; i < 2000; i++) {
+    double radius1 = random_between(1, 5);
+    double radius2 = random_between(1, 5);
+    double distance = random_between(0, 1.2 * (radius1 + radius2));
+    double angle = random_between(0, 2 * M_PI);
+    vector_t center2 = {distance * cos(angle), distance * sin(angle)};
+    polygon_t *polygon1 = random_polygon(VEC_ZERO, radius1);
+    polygon_t *polygon2 = random_polygon(center2, radius2);
+
+    collision_info_t sat = find_polygon_collision(polygon1, polygon2);
+    collision_info_t gjk = find_gjk_collision(polygon1, polygon2);
+    assert(sat.collided == gjk.collided);
+    // the separating axis test measures overlaps between projections,
+    // which is not the depth when one projection contains the other,
+    // so only compare the axes when neither shape may be inside the other
+    if (gjk.collided && distance > fmax(radius1, radius2)) {
+      assert(vec_within(1e-6, sat.axis, gjk.axis));
+      assert(within(1e-6, sat.depth, gjk.depth));
+      assert(vec_dot(gjk.axis, center2) > 0);
+    }
+    poly_free(polygon1);
+    poly_free(polygon2);
+  }
+}
+
+// Starting from a cached simplex gives the same results as starting over
+void test_gjk_warm_start() {
+  srand(1);
+  polygon_t *polygon1 = random_polygon(VEC_ZERO, 3);
+  polygon_t *polygon2 = random_polygon((vector_t){-10, 0.5}, 2);
+  gjk_simplex_t simplex = {0};
+  for (size_t i = 0; i < 200; i++) {
+    poly_translate(polygon2, (vector_t){0.1, 0});
+    poly_rotate(polygon2, 0.05, poly_centroid(polygon2));
+    collision_info_t cold = find_gjk_collision(polygon1, polygon2);
+    collision_info_t warm =
+        find_gjk_collision_cached(polygon1, polygon2, &simplex);
+    assert(simplex.size >= 1 && simplex.size <= 3);
+    assert(cold.collided == warm.collided);
+    if (cold.collided) {
+      assert(vec_within(1e-6, cold.axis, warm.axis));
+    }
+  }
+
+  // a simplex cached for bigger shapes is ignored
+  simplex = (gjk_simplex_t){1, {100, 0, 0}, {0, 0, 0}};
+  collision_info_t collision =
+      find_gjk_collision_cached(polygon1, polygon2, &simplex);
+  assert(collision.collided ==
+         find_gjk_collision(polygon1, polygon2).collided);
+  assert(simplex.indices1[0] < polygon1->size);
+  poly_free(polygon1);
+  poly_free(polygon2);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_gjk_rectangles)
+  DO_TEST(test_gjk_matches_sat)
+  DO_TEST(test_gjk_warm_start)
+
+  puts("gjk_test PASS");
+}
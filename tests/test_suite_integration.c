@@ -0,0 +1,171 @@
+#include "integration.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BODIES 19
+
+static const integration_impl_t IMPLS[] = {
+    INTEGRATION_SCALAR, INTEGRATION_SSE2, INTEGRATION_AVX2};
+static const size_t NUM_IMPLS = sizeof(IMPLS) / sizeof(IMPLS[0]);
+static const integrator_t INTEGRATORS[] = {INTEGRATOR_VERLET,
+                                           INTEGRATOR_SEMI_IMPLICIT_EULER};
+
+// the arrays behind a batch
+typedef struct {
+  double mass[MAX_BODIES];
+  vector_t vel[MAX_BODIES];
+  vector_t pos[MAX_BODIES];
+  double angular_vel[MAX_BODIES];
+  double angle[MAX_BODIES];
+  vector_t net_force[MAX_BODIES];
+  vector_t net_impulse[MAX_BODIES];
+  bool active[MAX_BODIES];
+  bool moved[MAX_BODIES];
+} bodies_t;
+
+static integration_batch_t make_batch(bodies_t *bodies, size_t size) {
+  return (integration_batch_t){size,
+                               bodies->mass,
+                               bodies->vel,
+                               bodies->pos,
+                               bodies->angular_vel,
+                               bodies->angle,
+                               bodies->net_force,
+                               bodies->net_impulse,
+                               bodies->active,
+                               bodies->moved};
+}
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// some bodies are at rest, so they should not be marked as moved
+static vector_t random_vector() {
+  if (rand() % 4 == 0) {
+    return VEC_ZERO;
+  }
+  return (vector_t){random_between(-100, 100), random_between(-100, 100)};
+}
+
+static void randomize(bodies_t *bodies) {
+  // zeroes the padding too, so whole states can be compared
+  memset(bodies, 0, sizeof(bodies_t));
+  for (size_t i = 0; i < MAX_BODIES; i++) {
+    bodies->mass[i] = rand() % 8 == 0 ? INFINITY : random_between(0.1, 10);
+    bodies->vel[i] = random_vector();
+    bodies->pos[i] = random_vector();
+    bodies->angular_vel[i] = rand() % 2 == 0 ? 0 : random_between(-5, 5);
+    bodies->angle[i] = random_between(-M_PI, M_PI);
+    bodies->net_force[i] = random_vector();
+    bodies->net_impulse[i] = random_vector();
+    bodies->active[i] = rand() % 3 != 0;
+    bodies->moved[i] = false;
+  }
+}
+
+// compares every bit, so even -0 and 0 differ
+static bool same_bits(bodies_t *bodies1, bodies_t *bodies2) {
+  return memcmp(bodies1, bodies2, sizeof(bodies_t)) == 0;
+}
+
+void test_default_impl() {
+  integration_impl_t impl = integration_get_impl();
+  assert(integration_impl_supported(impl));
+}
+
+// Under constant forces, Verlet is exact and Euler moves a little further
+void test_integrators() {
+  const double DT = 0.1;
+  const int STEPS = 10;
+  vector_t expected[] = {{0.5, -1}, {0.55, -1.1}};
+  for (size_t i = 0; i < NUM_IMPLS; i++) {
+    if (!integration_impl_supported(IMPLS[i])) {
+      continue;
+    }
+    integration_set_impl(IMPLS[i]);
+    for (size_t j = 0; j < 2; j++) {
+      bodies_t bodies = {0};
+      bodies.mass[0] = 2;
+      bodies.active[0] = true;
+      integration_batch_t batch = make_batch(&bodies, 1);
+      for (int step = 0; step < STEPS; step++) {
+        bodies.net_force[0] = (vector_t){2, -4};
+        integrate_batch(&batch, INTEGRATORS[j], DT);
+      }
+      // a = F / m = (1, -2), after t = 1 second
+      assert(vec_isclose(bodies.vel[0], (vector_t){1, -2}));
+      assert(vec_isclose(bodies.pos[0], expected[j]));
+      assert(vec_equal(bodies.net_force[0], VEC_ZERO));
+      assert(bodies.moved[0]);
+    }
+  }
+}
+
+// Every implementation must give exactly the scalar state,
+// for any number of bodies (including the leftover ones),
+// and leave inactive bodies exactly as they were
+void test_impls_match_scalar() {
+  srand(0);
+  for (size_t size = 0; size <= MAX_BODIES; size++) {
+    for (size_t j = 0; j < 2; j++) {
+      bodies_t initial;
+      randomize(&initial);
+      bodies_t expected;
+      memcpy(&expected, &initial, sizeof(bodies_t));
+      integration_set_impl(INTEGRATION_SCALAR);
+      integration_batch_t batch = make_batch(&expected, size);
+      integrate_batch(&batch, INTEGRATORS[j], 1.0 / 60);
+      for (size_t i = 0; i < size; i++) {
+        if (!initial.active[i]) {
+          assert(!expected.moved[i]);
+          assert(vec_equal(expected.pos[i], initial.pos[i]));
+          assert(vec_equal(expected.net_force[i], initial.net_force[i]));
+        }
+      }
+
+      for (size_t i = 0; i < NUM_IMPLS; i++) {
+        if (!integration_impl_supported(IMPLS[i])) {
+          continue;
+        }
+        bodies_t bodies;
+        memcpy(&bodies, &initial, sizeof(bodies_t));
+        integration_set_impl(IMPLS[i]);
+        batch = make_batch(&bodies, size);
+        integrate_batch(&batch, INTEGRATORS[j], 1.0 / 60);
+        assert(same_bits(&bodies, &expected));
+      }
+    }
+  }
+}
+
+// Verlet moves at the average of the velocities, and Euler at the new one
+void test_displacement() {
+  vector_t vel = {3, -1};
+  vector_t new_vel = {5, 1};
+  assert(vec_equal(integrator_displacement(INTEGRATOR_VERLET, vel, new_vel, 2),
+                   (vector_t){8, 0}));
+  assert(vec_equal(integrator_displacement(INTEGRATOR_SEMI_IMPLICIT_EULER, vel,
+                                           new_vel, 2),
+                   (vector_t){10, 2}));
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_default_impl)
+  DO_TEST(test_integrators)
+  DO_TEST(test_impls_match_scalar)
+  DO_TEST(test_displacement)
+
+  puts("integration_test PASS");
+}
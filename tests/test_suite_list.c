@@ -151,6 +151,25 @@ void test_list_large_add_remove() {
   list_free(l);
 }
 
+// Replace elements in place
+void test_list_set() {
+  list_t *l = list_init(2, free);
+  vector_t *v1 = malloc(sizeof(*v1));
+  *v1 = (vector_t){1, 1};
+  list_add(l, v1);
+  vector_t *v2 = malloc(sizeof(*v2));
+  *v2 = (vector_t){2, 2};
+  list_add(l, v2);
+  vector_t *v3 = malloc(sizeof(*v3));
+  *v3 = (vector_t){3, 3};
+  assert(list_set(l, 0, v3) == v1);
+  free(v1);
+  assert(list_size(l) == 2);
+  assert(list_get(l, 0) == v3);
+  assert(list_get(l, 1) == v2);
+  list_free(l);
+}
+
 typedef struct {
   list_t *list;
   size_t index;
@@ -205,6 +224,7 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_list_small)
   DO_TEST(test_list_large_get_set)
   DO_TEST(test_list_large_add_remove)
+  DO_TEST(test_list_set)
   DO_TEST(test_empty_remove)
   DO_TEST(test_null_values)
 
@@ -0,0 +1,75 @@
+#include "pair_table.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+void test_pair_table_unordered() {
+  pair_table_t *table = pair_table_init(0);
+  int a, b, c;
+  int value1, value2;
+  assert(pair_table_size(table) == 0);
+  assert(pair_table_get(table, &a, &b) == NULL);
+  pair_table_put(table, &a, &b, &value1);
+  assert(pair_table_size(table) == 1);
+  assert(pair_table_get(table, &a, &b) == &value1);
+  assert(pair_table_get(table, &b, &a) == &value1);
+  assert(pair_table_get(table, &a, &c) == NULL);
+  // Replace the value through the reversed pair
+  pair_table_put(table, &b, &a, &value2);
+  assert(pair_table_size(table) == 1);
+  assert(pair_table_get(table, &a, &b) == &value2);
+  assert(pair_table_remove(table, &a, &b) == &value2);
+  assert(pair_table_size(table) == 0);
+  assert(pair_table_get(table, &a, &b) == NULL);
+  assert(pair_table_remove(table, &a, &b) == NULL);
+  pair_table_free(table);
+}
+
+// Many entries force the table to grow and exercise removal with collisions
+void test_pair_table_large() {
+  const size_t N = 200;
+  int *keys = malloc(N * sizeof(int));
+  pair_table_t *table = pair_table_init(4);
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j += 7) {
+      pair_table_put(table, &keys[i], &keys[j], &keys[j]);
+    }
+  }
+  size_t expected = pair_table_size(table);
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j += 7) {
+      assert(pair_table_get(table, &keys[j], &keys[i]) == &keys[j]);
+    }
+  }
+  // Remove every other pair, then check the rest are still there
+  for (size_t i = 0; i < N; i += 2) {
+    for (size_t j = i + 1; j < N; j += 7) {
+      assert(pair_table_remove(table, &keys[i], &keys[j]) == &keys[j]);
+      expected--;
+    }
+  }
+  assert(pair_table_size(table) == expected);
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = i + 1; j < N; j += 7) {
+      void *value = pair_table_get(table, &keys[i], &keys[j]);
+      assert(value == (i % 2 == 0 ? NULL : &keys[j]));
+    }
+  }
+  pair_table_free(table);
+  free(keys);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_pair_table_unordered)
+  DO_TEST(test_pair_table_large)
+
+  puts("pair_table_test PASS");
+}
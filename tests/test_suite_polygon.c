@@ -225,6 +225,75 @@ void test_weird_rotate() {
   vec_list_free(w);
 }
 
+void test_poly_from_list() {
+  list_t *sq = make_square();
+  polygon_t *poly = poly_from_list(sq);
+  assert(poly->size == 4);
+  for (size_t i = 0; i < 4; i++) {
+    assert(vec_equal(poly->vertices[i], *vec_list_get(sq, i)));
+  }
+  assert(isclose(poly_area(poly), 4));
+  assert(vec_isclose(poly_centroid(poly), VEC_ZERO));
+
+  list_t *list = poly_to_list(poly);
+  assert(vec_list_size(list) == 4);
+  for (size_t i = 0; i < 4; i++) {
+    assert(vec_equal(*vec_list_get(list, i), poly->vertices[i]));
+  }
+  vec_list_free(list);
+  poly_free(poly);
+  vec_list_free(sq);
+}
+
+// Small lists are copied into the buffer, and longer ones to the heap
+void test_poly_from_list_buffer() {
+  vector_t buffer[POLY_BUFFER_SIZE];
+  list_t *sq = make_square();
+  polygon_t poly = poly_from_list_buffer(sq, buffer);
+  assert(poly.size == 4 && poly.vertices == buffer);
+  for (size_t i = 0; i < 4; i++) {
+    assert(vec_equal(poly.vertices[i], *vec_list_get(sq, i)));
+  }
+  poly_release_buffer(&poly, buffer);
+  vec_list_free(sq);
+
+  list_t *long_list = vec_list_init(POLY_BUFFER_SIZE + 1);
+  for (size_t i = 0; i < POLY_BUFFER_SIZE + 1; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = (vector_t){i, -(double)i};
+    vec_list_add(long_list, v);
+  }
+  poly = poly_from_list_buffer(long_list, buffer);
+  assert(poly.size == POLY_BUFFER_SIZE + 1 && poly.vertices != buffer);
+  for (size_t i = 0; i < poly.size; i++) {
+    assert(vec_equal(poly.vertices[i], *vec_list_get(long_list, i)));
+  }
+  poly_release_buffer(&poly, buffer);
+  vec_list_free(long_list);
+}
+
+void test_poly_translate_rotate() {
+  list_t *w = make_weird();
+  polygon_t *poly = poly_from_list(w);
+  polygon_t *copy = poly_copy(poly);
+  poly_translate(poly, (vector_t){-10, -20});
+  assert(vec_equal(copy->vertices[0], *vec_list_get(w, 0)));
+  assert(vec_isclose(poly->vertices[1], (vector_t){-6, -19}));
+  assert(vec_isclose(poly->vertices[4], (vector_t){-11, -28}));
+
+  // Rotate 90 degrees around (0, 2)
+  poly_rotate(copy, M_PI / 2, (vector_t){0, 2});
+  assert(vec_isclose(copy->vertices[0], (vector_t){2, 2}));
+  assert(vec_isclose(copy->vertices[3], (vector_t){-3, -3}));
+  assert(isclose(poly_area(copy), 23));
+  assert(vec_isclose(poly_centroid(copy),
+                     (vector_t){143.0 / 46.0, 53.0 / 138.0}));
+
+  poly_free(copy);
+  poly_free(poly);
+  vec_list_free(w);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests? True if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -246,6 +315,9 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_weird_area_centroid)
   DO_TEST(test_weird_translate)
   DO_TEST(test_weird_rotate)
+  DO_TEST(test_poly_from_list)
+  DO_TEST(test_poly_from_list_buffer)
+  DO_TEST(test_poly_translate_rotate)
 
   puts("polygon_test PASS");
 }
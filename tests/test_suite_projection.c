@@ -0,0 +1,94 @@
+#include "projection.h"
+#include "shape.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+static const projection_impl_t IMPLS[] = {PROJECTION_SCALAR, PROJECTION_SSE2,
+                                          PROJECTION_AVX2};
+static const size_t NUM_IMPLS = sizeof(IMPLS) / sizeof(IMPLS[0]);
+
+static double random_coordinate() {
+  return (double)rand() / RAND_MAX * 200 - 100;
+}
+
+// Projects onto axes from a rectangle, which the expected ranges are easy for
+void test_project_rectangle() {
+  polygon_t *rectangle = shape_rectangle((vector_t){4, 6});
+  poly_translate(rectangle, (vector_t){1, 2});
+  vector_t axes[] = {{1, 0}, {0, 1}, {-1, 0}, {M_SQRT1_2, M_SQRT1_2}, {0, -1}};
+  projection_range_t ranges[5];
+  for (size_t i = 0; i < NUM_IMPLS; i++) {
+    if (!projection_impl_supported(IMPLS[i])) {
+      continue;
+    }
+    projection_set_impl(IMPLS[i]);
+    poly_project(rectangle, axes, 5, ranges);
+    assert(ranges[0].min == -1 && ranges[0].max == 3);
+    assert(ranges[1].min == -1 && ranges[1].max == 5);
+    assert(ranges[2].min == -3 && ranges[2].max == 1);
+    assert(within(1e-9, ranges[3].min, -M_SQRT2));
+    assert(within(1e-9, ranges[3].max, 4 * M_SQRT2));
+    assert(ranges[4].min == -5 && ranges[4].max == 1);
+  }
+  poly_free(rectangle);
+}
+
+// Every implementation must give exactly the scalar ranges,
+// for any number of vertices and axes (including the leftover ones)
+void test_impls_match_scalar() {
+  assert(projection_impl_supported(PROJECTION_SCALAR));
+  srand(0);
+  for (size_t size = 1; size <= 11; size++) {
+    polygon_t *polygon = poly_init(size);
+    for (size_t i = 0; i < size; i++) {
+      polygon->vertices[i] =
+          (vector_t){random_coordinate(), random_coordinate()};
+    }
+    for (size_t num_axes = 1; num_axes <= 9; num_axes++) {
+      vector_t axes[9];
+      for (size_t k = 0; k < num_axes; k++) {
+        double angle = 2 * M_PI * rand() / RAND_MAX;
+        axes[k] = (vector_t){cos(angle), sin(angle)};
+      }
+      projection_range_t expected[9];
+      projection_set_impl(PROJECTION_SCALAR);
+      poly_project(polygon, axes, num_axes, expected);
+      for (size_t i = 0; i < NUM_IMPLS; i++) {
+        if (!projection_impl_supported(IMPLS[i])) {
+          continue;
+        }
+        projection_range_t ranges[9];
+        projection_set_impl(IMPLS[i]);
+        poly_project(polygon, axes, num_axes, ranges);
+        for (size_t k = 0; k < num_axes; k++) {
+          assert(ranges[k].min == expected[k].min);
+          assert(ranges[k].max == expected[k].max);
+        }
+      }
+    }
+    poly_free(polygon);
+  }
+}
+
+void test_default_impl() {
+  projection_impl_t impl = projection_get_impl();
+  assert(projection_impl_supported(impl));
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_default_impl)
+  DO_TEST(test_project_rectangle)
+  DO_TEST(test_impls_match_scalar)
+
+  puts("projection_test PASS");
+}
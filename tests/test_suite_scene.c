@@ -1,7 +1,9 @@
 #include "scene.h"
+#include "shape.h"
 #include "test_util.h"
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 void scene_get_first(void *scene) { scene_get_body(scene, 0); }
@@ -202,6 +204,8 @@ void count_calls(void *aux) {
   count_aux->count++;
 }
 
+void increment_count(count_aux_t *count_aux) { count_aux->count++; }
+
 void test_reaping() {
   scene_t *scene = scene_init();
   for (int i = 0; i < 3; i++) {
@@ -228,6 +232,1008 @@ void test_reaping() {
   scene_free(scene);
 }
 
+// Removing a body only removes the force creators that depend on it
+void test_remove_keeps_other_forces() {
+  scene_t *scene = scene_init();
+  body_t *bodies[4];
+  for (int i = 0; i < 4; i++) {
+    bodies[i] = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    scene_add_body(scene, bodies[i]);
+  }
+  count_aux_t *counts[4];
+  for (int i = 0; i < 4; i++) {
+    counts[i] = malloc(sizeof(*counts[i]));
+    counts[i]->count = 0;
+    counts[i]->scene = scene;
+  }
+  // force creator i depends on bodies i and i + 1
+  for (int i = 0; i < 3; i++) {
+    list_t *required_bodies = list_init(2, NULL);
+    list_add(required_bodies, bodies[i]);
+    list_add(required_bodies, bodies[i + 1]);
+    scene_add_bodies_force_creator(scene, (force_creator_t)increment_count,
+                                   counts[i], required_bodies, NULL);
+  }
+  scene_tick(scene, 1);
+  body_remove(bodies[3]);
+  scene_tick(scene, 1);
+  body_remove(bodies[0]);
+  scene_tick(scene, 1);
+  scene_tick(scene, 1);
+  assert(scene_bodies(scene) == 2);
+  assert(scene_get_body(scene, 0) == bodies[1]);
+  assert(scene_get_body(scene, 1) == bodies[2]);
+  // removal is deferred until the end of the tick
+  assert(counts[0]->count == 3);
+  assert(counts[1]->count == 4);
+  assert(counts[2]->count == 2);
+  for (int i = 0; i < 4; i++) {
+    free(counts[i]);
+  }
+  scene_free(scene);
+}
+
+// Counts collisions and checks the bodies are passed in the rule's type order
+static const char *TYPE_A = "a";
+static const char *TYPE_B = "b";
+void count_collisions(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  assert(body1->type == TYPE_A);
+  assert(body2->type == TYPE_B);
+  (*(int *)aux)++;
+}
+
+void test_collision_rules() {
+  scene_t *scene = scene_init();
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions, count,
+                           NULL);
+  body_t *a = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                  TYPE_A);
+  body_t *b = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                  TYPE_B);
+  // two bodies of the same type never collide
+  body_t *other_b = body_init_with_info(make_shape(), 1,
+                                        (rgb_color_t){0, 0, 0}, TYPE_B);
+  body_set_centroid(a, (vector_t){10, 0});
+  body_set_centroid(b, (vector_t){-10, 0});
+  body_set_centroid(other_b, (vector_t){-10, 0});
+  // b is added first, so the scene sees the pair in the opposite order
+  scene_add_body(scene, b);
+  scene_add_body(scene, other_b);
+  scene_add_body(scene, a);
+
+  body_set_velocity(a, (vector_t){-1, 0});
+  for (int i = 0; i < 20; i++) {
+    scene_tick(scene, 1);
+  }
+  // a passes through both b bodies, but only counts as one contact each
+  assert(*count == 2);
+
+  // the handler runs again once the bodies separate and touch again
+  body_set_centroid(a, (vector_t){10, 0});
+  for (int i = 0; i < 20; i++) {
+    scene_tick(scene, 1);
+  }
+  assert(*count == 4);
+  free(count);
+  scene_free(scene);
+}
+
+// Checks the collision is seen from body1, which has type A
+void count_contacts(body_t *body1, body_t *body2,
+                    const collision_info_t *collision, void *aux) {
+  assert(body1->type == TYPE_A);
+  assert(body2->type == TYPE_B);
+  assert(vec_dot(collision->axis, vec_subtract(body_get_centroid(body2),
+                                               body_get_centroid(body1))) > 0);
+  assert(collision->depth >= 0 && collision->num_contacts > 0);
+  (*(int *)aux)++;
+}
+
+// Contact handlers run every tick the bodies collide
+void test_contact_rules() {
+  scene_t *scene = scene_init();
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_contact_rule(scene, TYPE_A, TYPE_B, count_contacts, count, NULL);
+  body_t *a = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                  TYPE_A);
+  body_t *b = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                  TYPE_B);
+  body_set_centroid(a, (vector_t){10, 0.5});
+  body_set_centroid(b, (vector_t){-10, 0});
+  // b is added first, so the scene sees the pair in the opposite order
+  scene_add_body(scene, b);
+  scene_add_body(scene, a);
+
+  // a overlaps b while its centroid is within 2 of b's
+  body_set_velocity(a, (vector_t){-1, 0});
+  for (int i = 0; i < 40; i++) {
+    scene_tick(scene, 1);
+  }
+  assert(*count >= 3 && *count <= 5);
+  free(count);
+  scene_free(scene);
+}
+
+void solve_contact(body_t *body1, body_t *body2,
+                   const collision_info_t *collision, void *scene) {
+  scene_add_solver_contact(scene, body1, body2, collision, 0.5);
+}
+
+/**
+ * Runs many stacks of boxes pushed into walls, all resting on one floor,
+ * and records where the boxes end up.
+ * Each stack is its own island, since the floor and walls cannot move.
+ */
+static void run_stacks(size_t num_threads, vector_t *positions,
+                       vector_t *velocities, size_t num_stacks) {
+  scene_t *scene = scene_init();
+  scene_set_solver_threads(scene, num_threads);
+  scene_add_contact_rule(scene, TYPE_A, TYPE_B, solve_contact, scene, NULL);
+  scene_add_contact_rule(scene, TYPE_B, TYPE_B, solve_contact, scene, NULL);
+  body_t *floor = body_init_with_polygon(
+      shape_rectangle((vector_t){10 * num_stacks + 10, 1}), INFINITY,
+      (rgb_color_t){0, 0, 0}, TYPE_A);
+  body_set_centroid(floor, (vector_t){5 * num_stacks, -1.4});
+  body_set_static(floor);
+  scene_add_body(scene, floor);
+  for (size_t i = 0; i < num_stacks; i++) {
+    body_t *wall = body_init_with_info(make_shape(), INFINITY,
+                                       (rgb_color_t){0, 0, 0}, TYPE_A);
+    body_set_centroid(wall, (vector_t){10 * i, 0.1});
+    body_set_static(wall);
+    scene_add_body(scene, wall);
+    for (size_t j = 1; j <= 2; j++) {
+      body_t *box = body_init_with_info(make_shape(), j,
+                                        (rgb_color_t){0, 0, 0}, TYPE_B);
+      body_set_centroid(box, (vector_t){10 * i + 2.3 * j, 0});
+      body_set_velocity(box, (vector_t){-3.0 * j - 0.1 * i, 0.2 * j});
+      scene_add_body(scene, box);
+    }
+  }
+  for (int i = 0; i < 60; i++) {
+    scene_tick(scene, 1.0 / 30);
+  }
+  size_t num_boxes = 0;
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (body->type == TYPE_B) {
+      positions[num_boxes] = body_get_centroid(body);
+      velocities[num_boxes] = body_get_velocity(body);
+      num_boxes++;
+    }
+  }
+  assert(num_boxes == 2 * num_stacks);
+  scene_free(scene);
+}
+
+// Solving islands on several threads gives exactly the single-threaded result
+void test_parallel_islands() {
+  const size_t NUM_STACKS = 40;
+  vector_t positions[2 * NUM_STACKS], velocities[2 * NUM_STACKS];
+  run_stacks(1, positions, velocities, NUM_STACKS);
+  for (size_t i = 0; i < 2 * NUM_STACKS; i++) {
+    // the boxes rest against their wall and the floor
+    assert(positions[i].x > 10 * (i / 2) + 1.9 * (i % 2 + 1));
+    assert(positions[i].y > -0.1);
+  }
+  for (size_t num_threads = 2; num_threads <= 4; num_threads++) {
+    vector_t threaded_positions[2 * NUM_STACKS];
+    vector_t threaded_velocities[2 * NUM_STACKS];
+    run_stacks(num_threads, threaded_positions, threaded_velocities,
+               NUM_STACKS);
+    for (size_t i = 0; i < 2 * NUM_STACKS; i++) {
+      assert(threaded_positions[i].x == positions[i].x);
+      assert(threaded_positions[i].y == positions[i].y);
+      assert(threaded_velocities[i].x == velocities[i].x);
+      assert(threaded_velocities[i].y == velocities[i].y);
+    }
+  }
+}
+
+// slows a body down, and counts how many ticks it was called
+typedef struct {
+  body_t *body;
+  int calls;
+} friction_aux_t;
+void friction(friction_aux_t *aux) {
+  body_add_force(aux->body, vec_multiply(-2, body_get_velocity(aux->body)));
+  aux->calls++;
+}
+
+// Slow bodies fall asleep, and wake up when something pushes them
+void test_sleeping() {
+  const double DT = 0.1;
+  scene_t *scene = scene_init();
+  scene_set_sleeping(scene, 0.1, 0.5);
+  scene_add_contact_rule(scene, TYPE_A, TYPE_B, solve_contact, scene, NULL);
+  body_t *sleeper = body_init_with_info(make_shape(), 1,
+                                        (rgb_color_t){0, 0, 0}, TYPE_B);
+  body_set_velocity(sleeper, (vector_t){1, 0});
+  scene_add_body(scene, sleeper);
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, sleeper);
+  friction_aux_t *aux = malloc(sizeof(*aux));
+  *aux = (friction_aux_t){sleeper, 0};
+  scene_add_bodies_force_creator(scene, (force_creator_t)friction, aux, bodies,
+                                 free);
+
+  // friction slows the body below 0.1 after about 12 ticks,
+  // and it stays below that for 5 ticks
+  int ticks = 0;
+  while (!body_is_asleep(sleeper)) {
+    scene_tick(scene, DT);
+    ticks++;
+    assert(ticks < 30);
+  }
+  assert(ticks >= 5 + 10);
+  assert(vec_equal(body_get_velocity(sleeper), VEC_ZERO));
+  vector_t centroid = body_get_centroid(sleeper);
+  int calls = aux->calls;
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(body_is_asleep(sleeper));
+  assert(aux->calls == calls);
+  assert(vec_equal(body_get_centroid(sleeper), centroid));
+
+  // a body moving into the sleeping body wakes it up and pushes it
+  body_t *pusher = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                       TYPE_A);
+  body_set_centroid(pusher, vec_subtract(centroid, (vector_t){3, 0}));
+  body_set_velocity(pusher, (vector_t){5, 0});
+  scene_add_body(scene, pusher);
+  for (int i = 0; i < 5; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(!body_is_asleep(sleeper));
+  assert(aux->calls > calls);
+  assert(body_get_centroid(sleeper).x > centroid.x);
+
+  // an impulse wakes a sleeping body too
+  body_sleep(sleeper);
+  body_add_impulse(sleeper, (vector_t){0, 1});
+  assert(!body_is_asleep(sleeper));
+  scene_free(scene);
+}
+
+// pushes a body along x, like a player's controls
+typedef struct {
+  body_t *body;
+  double throttle;
+} drive_aux_t;
+void drive(drive_aux_t *aux) {
+  body_add_force(aux->body, (vector_t){aux->throttle, 0});
+}
+
+// the creator is skipped while the body sleeps, so input has to wake it
+void set_throttle(drive_aux_t *aux, double throttle) {
+  aux->throttle = throttle;
+  if (throttle != 0) {
+    body_wake(aux->body);
+  }
+}
+
+// A sleeping body's force creator runs again once its input wakes the body
+void test_sleeping_input() {
+  const double DT = 0.1;
+  scene_t *scene = scene_init();
+  scene_set_sleeping(scene, 0.1, 0.5);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  scene_add_body(scene, body);
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, body);
+  drive_aux_t *aux = malloc(sizeof(*aux));
+  *aux = (drive_aux_t){body, 0};
+  scene_add_bodies_force_creator(scene, (force_creator_t)drive, aux, bodies,
+                                 free);
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(body_is_asleep(body));
+
+  // input alone is never seen, since the creator does not run
+  aux->throttle = 1;
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(body_is_asleep(body));
+  assert(vec_equal(body_get_centroid(body), VEC_ZERO));
+
+  set_throttle(aux, 1);
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, DT);
+  }
+  assert(!body_is_asleep(body));
+  assert(body_get_centroid(body).x > 0);
+  scene_free(scene);
+}
+
+// Fixed steps run whole ticks, capped per frame, and report the leftover time
+void test_step_fixed() {
+  scene_t *scene = scene_init();
+  scene_set_fixed_step(scene, 10, 3);
+  body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_set_velocity(body, (vector_t){10, 0});
+  scene_add_body(scene, body);
+  assert(scene_get_interpolation(scene) == 1);
+
+  assert(scene_step_fixed(scene, 0.05) == 0);
+  assert(isclose(scene_get_interpolation(scene), 0.5));
+  assert(vec_isclose(body_get_centroid(body), VEC_ZERO));
+  assert(scene_step_fixed(scene, 0.075) == 1);
+  assert(isclose(scene_get_interpolation(scene), 0.25));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){1, 0}));
+  // drawn a quarter of the way from the last tick to the current one
+  assert(vec_isclose(body_get_interpolated_centroid(
+                         body, scene_get_interpolation(scene)),
+                     (vector_t){0.25, 0}));
+
+  // a long hitch only runs 3 ticks, and the rest of it is dropped
+  assert(scene_step_fixed(scene, 10.01) == 3);
+  assert(vec_isclose(body_get_centroid(body), (vector_t){4, 0}));
+  assert(scene_get_interpolation(scene) < 1);
+  scene_free(scene);
+}
+
+// runs a bouncing body at a frame rate until it has run a number of ticks
+static vector_t run_frames(double frame_dt, size_t num_ticks) {
+  scene_t *scene = scene_init();
+  scene_add_contact_rule(scene, TYPE_A, TYPE_B, solve_contact, scene, NULL);
+  body_t *wall = body_init_with_info(make_shape(), INFINITY,
+                                     (rgb_color_t){0, 0, 0}, TYPE_A);
+  scene_add_body(scene, wall);
+  body_t *ball = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                     TYPE_B);
+  body_set_centroid(ball, (vector_t){5, 0.5});
+  body_set_velocity(ball, (vector_t){-7, 0});
+  scene_add_body(scene, ball);
+  size_t ticks = 0;
+  while (ticks < num_ticks) {
+    ticks += scene_step_fixed(scene, frame_dt);
+  }
+  assert(ticks == num_ticks);
+  vector_t centroid = body_get_centroid(ball);
+  scene_free(scene);
+  return centroid;
+}
+
+// The results only depend on the number of ticks, not on the frame rate
+void test_step_fixed_deterministic() {
+  vector_t at_144hz = run_frames(1.0 / 144, 120);
+  vector_t at_60hz = run_frames(1.0 / 60, 120);
+  vector_t at_30hz = run_frames(1.0 / 30, 120);
+  assert(at_144hz.x > 0);
+  assert(at_144hz.x == at_60hz.x && at_144hz.y == at_60hz.y);
+  assert(at_144hz.x == at_30hz.x && at_144hz.y == at_30hz.y);
+}
+
+// Static bodies never move, and never collide with each other
+void test_static_bodies() {
+  scene_t *scene = scene_init();
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions, count,
+                           NULL);
+  body_t *wall1 = body_init_with_info(make_shape(), INFINITY,
+                                      (rgb_color_t){0, 0, 0}, TYPE_A);
+  body_t *wall2 = body_init_with_info(make_shape(), INFINITY,
+                                      (rgb_color_t){0, 0, 0}, TYPE_B);
+  body_t *mover = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                      TYPE_B);
+  body_set_static(wall1);
+  body_set_static(wall2);
+  assert(body_is_static(wall1) && !body_is_static(mover));
+  body_set_velocity(wall1, (vector_t){1, 0});
+  body_set_centroid(mover, (vector_t){10, 0});
+  body_set_velocity(mover, (vector_t){-1, 0});
+  scene_add_body(scene, wall1);
+  scene_add_body(scene, wall2);
+  scene_add_body(scene, mover);
+
+  for (int i = 0; i < 5; i++) {
+    scene_tick(scene, 1);
+  }
+  // the overlapping walls did not collide, and wall1 was not integrated
+  assert(*count == 0);
+  assert(vec_isclose(body_get_centroid(wall1), VEC_ZERO));
+  for (int i = 0; i < 10; i++) {
+    scene_tick(scene, 1);
+  }
+  assert(*count == 1);
+
+  // removing a static body rebuilds the static broad phase
+  body_remove(wall1);
+  scene_tick(scene, 1);
+  body_set_centroid(mover, (vector_t){10, 0});
+  for (int i = 0; i < 20; i++) {
+    scene_tick(scene, 1);
+  }
+  assert(*count == 1);
+  assert(scene_bodies(scene) == 2);
+  free(count);
+  scene_free(scene);
+}
+
+// Records where body1 was when it hit body2 from the left
+void record_impact(body_t *body1, body_t *body2, vector_t axis, void *aux) {
+  assert(vec_isclose(axis, (vector_t){1, 0}));
+  *(vector_t *)aux = body_get_centroid(body1);
+}
+
+// A fast body is stopped by a wall it would otherwise jump over in a tick.
+// The sweep finds the wall in whichever broad phase the scene uses.
+static void check_fast_body(broad_phase_t broad_phase, bool fast) {
+  scene_t *scene = scene_init();
+  scene_set_broad_phase(scene, broad_phase);
+  body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){0.2, 10}),
+                                        INFINITY, (rgb_color_t){0, 0, 0},
+                                        NULL);
+  body_set_static(wall);
+  scene_add_body(scene, wall);
+  body_t *bullet = body_init_circle(0.5, 1, (rgb_color_t){0, 0, 0}, NULL);
+  body_set_centroid(bullet, (vector_t){-3, 0});
+  body_set_velocity(bullet, (vector_t){100, 0});
+  if (fast) {
+    body_set_fast(bullet);
+  }
+  assert(body_is_fast(bullet) == fast);
+  scene_add_body(scene, bullet);
+  vector_t impact = {INFINITY, INFINITY};
+  scene_add_collision(scene, bullet, wall, record_impact, &impact, NULL);
+
+  scene_tick(scene, 0.1);
+  if (fast) {
+    // the handler ran with the bullet touching the wall
+    assert(vec_isclose(impact, (vector_t){-0.6, 0}));
+  }
+  // the handler left the velocity alone, so the bullet went on, but only
+  // covered one tick's worth of its path in total
+  assert(vec_isclose(body_get_centroid(bullet), (vector_t){7, 0}));
+  if (!fast) {
+    assert(impact.x == INFINITY);
+  }
+  // the impact is not reported again
+  impact = (vector_t){INFINITY, INFINITY};
+  scene_tick(scene, 0.1);
+  assert(impact.x == INFINITY);
+  scene_free(scene);
+}
+
+void test_fast_bodies() {
+  check_fast_body(BROAD_PHASE_GRID, false);
+  check_fast_body(BROAD_PHASE_GRID, true);
+  check_fast_body(BROAD_PHASE_SAP, true);
+  check_fast_body(BROAD_PHASE_TREE, true);
+}
+
+void remove_on_collision(body_t *body1, body_t *body2, vector_t axis,
+                         void *aux) {
+  (*(int *)aux)++;
+  body_remove(body1);
+}
+
+/**
+ * Makes a bullet for test_fast_body_removed(), at the address of a freed body
+ * if the allocator hands it back within a few tries.
+ */
+static body_t *make_bullet_at(uintptr_t address) {
+  const size_t MAX_TRIES = 16;
+  body_t *tried[MAX_TRIES];
+  body_t *bullet = NULL;
+  size_t num_tried = 0;
+  while (!bullet && num_tried < MAX_TRIES) {
+    body_t *body = body_init_circle(0.5, 1, (rgb_color_t){0, 0, 0}, TYPE_A);
+    if ((uintptr_t)body == address) {
+      bullet = body;
+    } else {
+      tried[num_tried++] = body;
+    }
+  }
+  if (!bullet) {
+    bullet = tried[--num_tried];
+  }
+  for (size_t i = 0; i < num_tried; i++) {
+    body_free(tried[i]);
+  }
+  return bullet;
+}
+
+// A fast body whose only rule is a contact rule is stopped by the solver
+// at the wall, and spends the rest of the tick moving back from it
+void test_fast_body_contact() {
+  scene_t *scene = scene_init();
+  scene_add_contact_rule(scene, TYPE_A, TYPE_B, solve_contact, scene, NULL);
+  body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){0.2, 10}),
+                                        INFINITY, (rgb_color_t){0, 0, 0},
+                                        TYPE_B);
+  body_set_static(wall);
+  scene_add_body(scene, wall);
+  body_t *bullet = body_init_circle(0.5, 1, (rgb_color_t){0, 0, 0}, TYPE_A);
+  body_set_centroid(bullet, (vector_t){-3, 0});
+  body_set_velocity(bullet, (vector_t){100, 0});
+  body_set_fast(bullet);
+  scene_add_body(scene, bullet);
+
+  scene_tick(scene, 0.1);
+  // it hit the wall at x = -0.6, 0.24 of the way through the tick,
+  // and bounced with elasticity 0.5
+  assert(vec_isclose(body_get_velocity(bullet), (vector_t){-50, 0}));
+  assert(vec_isclose(body_get_centroid(bullet), (vector_t){-4.4, 0}));
+  scene_free(scene);
+}
+
+// A swept body removed by its handler leaves no contact behind,
+// so a new body that reuses its address still reports its first collision
+void test_fast_body_removed() {
+  scene_t *scene = scene_init();
+  int collisions = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, remove_on_collision,
+                           &collisions, NULL);
+  body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){0.2, 10}),
+                                        INFINITY, (rgb_color_t){0, 0, 0},
+                                        TYPE_B);
+  body_set_static(wall);
+  scene_add_body(scene, wall);
+  body_t *bullet = body_init_circle(0.5, 1, (rgb_color_t){0, 0, 0}, TYPE_A);
+  body_set_centroid(bullet, (vector_t){-3, 0});
+  body_set_velocity(bullet, (vector_t){100, 0});
+  body_set_fast(bullet);
+  scene_add_body(scene, bullet);
+  uintptr_t address = (uintptr_t)bullet;
+
+  scene_tick(scene, 0.1);
+  assert(collisions == 1);
+  assert(scene_bodies(scene) == 1);
+
+  // without a sanitizer holding on to freed memory, this is the same address
+  body_t *next = make_bullet_at(address);
+  body_set_centroid(next, (vector_t){-0.5, 0});
+  scene_add_body(scene, next);
+  scene_tick(scene, 0.1);
+  assert(collisions == 2);
+  assert(scene_bodies(scene) == 1);
+  scene_free(scene);
+}
+
+// A fast body is split into enough sub-steps to hit a wall it would skip
+void test_substepping() {
+  for (int substepping = 0; substepping <= 1; substepping++) {
+    scene_t *scene = scene_init();
+    assert(scene_get_substeps(scene) == 0);
+    int collisions = 0;
+    scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions,
+                             &collisions, NULL);
+    body_t *wall = body_init_with_info(make_shape(), INFINITY,
+                                       (rgb_color_t){0, 0, 0}, TYPE_A);
+    body_set_static(wall);
+    scene_add_body(scene, wall);
+    body_t *mover = body_init_with_info(make_shape(), 1,
+                                        (rgb_color_t){0, 0, 0}, TYPE_B);
+    body_set_centroid(mover, (vector_t){-5, 0});
+    body_set_velocity(mover, (vector_t){10, 0});
+    scene_add_body(scene, mover);
+    count_aux_t forces = {0, scene};
+    scene_add_force_creator(scene, (force_creator_t)increment_count, &forces,
+                            NULL);
+    if (substepping) {
+      scene_set_substepping(scene, 0.5, 100);
+    }
+
+    scene_tick(scene, 1);
+    assert(vec_isclose(body_get_centroid(mover), (vector_t){5, 0}));
+    if (substepping) {
+      // moving 10 per tick, and at most 1 per sub-step
+      assert(scene_get_substeps(scene) == 10);
+      assert(forces.count == 10);
+      assert(collisions == 1);
+    } else {
+      assert(scene_get_substeps(scene) == 1);
+      assert(forces.count == 1);
+      assert(collisions == 0);
+    }
+
+    // a quiet tick takes one step, and a busy one is capped
+    body_set_velocity(mover, VEC_ZERO);
+    scene_tick(scene, 1);
+    assert(scene_get_substeps(scene) == 1);
+    scene_set_substepping(scene, 0.5, 4);
+    body_set_velocity(mover, (vector_t){10, 0});
+    scene_tick(scene, 1);
+    assert(scene_get_substeps(scene) == 4);
+    scene_free(scene);
+  }
+}
+
+// The cached bounds follow the body, and far apart bodies never collide
+void test_body_bounds() {
+  body_t *body1 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  body_t *body2 = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  assert(isclose(body_get_bounding_radius(body1), M_SQRT2));
+  assert(body_collide(body1, body2).collided);
+
+  body_set_centroid(body2, (vector_t){5, 1});
+  body_set_rotation(body2, M_PI / 4);
+  aabb_t bounds = body_get_aabb(body2);
+  assert(vec_isclose(bounds.min, (vector_t){5 - M_SQRT2, 1 - M_SQRT2}));
+  assert(vec_isclose(bounds.max, (vector_t){5 + M_SQRT2, 1 + M_SQRT2}));
+  assert(isclose(body_get_bounding_radius(body2), M_SQRT2));
+  assert(!body_collide(body1, body2).collided);
+
+  // the bounding circles overlap here, but the bounding boxes do not
+  body_set_rotation(body2, 0);
+  body_set_centroid(body2, (vector_t){2.5, 0});
+  assert(!body_collide(body1, body2).collided);
+  body_set_centroid(body2, (vector_t){1.5, 1.5});
+  assert(body_collide(body1, body2).collided);
+  body_free(body1);
+  body_free(body2);
+}
+
+// Circular bodies collide as exact circles, not as their polygons,
+// and rectangular bodies are detected as boxes
+void test_circle_body() {
+  body_t *circle = body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, NULL);
+  body_t *square = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+  assert(body_get_shape_kind(circle) == BODY_SHAPE_CIRCLE);
+  assert(body_get_shape_kind(square) == BODY_SHAPE_BOX);
+  // a new circle is centered exactly on the origin, and so is its shape
+  assert(vec_equal(body_get_centroid(circle), VEC_ZERO));
+  aabb_t bounds = body_get_aabb(circle);
+  assert(vec_isclose(bounds.min, (vector_t){-1, -1}));
+  assert(vec_isclose(bounds.max, (vector_t){1, 1}));
+  body_set_centroid(circle, (vector_t){1.75, 1.75});
+  bounds = body_get_aabb(circle);
+  assert(vec_isclose(bounds.min, (vector_t){0.75, 0.75}));
+  assert(vec_isclose(bounds.max, (vector_t){2.75, 2.75}));
+  // the boxes overlap at the corner, but the circle misses the square
+  assert(!body_collide(circle, square).collided);
+
+  body_set_centroid(circle, (vector_t){1.5, 0});
+  collision_info_t collision = body_collide(square, circle);
+  assert(collision.collided);
+  assert(vec_isclose(collision.axis, (vector_t){1, 0}));
+  body_free(circle);
+  body_free(square);
+}
+
+// Counts the collisions of a polygon passing through two others
+static int count_polygon_collisions(collision_engine_t engine,
+                                    bool override_types) {
+  scene_t *scene = scene_init();
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions, count,
+                           NULL);
+  if (override_types) {
+    scene_set_type_collision_engine(scene, TYPE_B, TYPE_A, engine);
+  } else {
+    scene_set_collision_engine(scene, engine);
+  }
+  body_t *a = body_init_with_polygon(shape_circle_create(1), 1,
+                                     (rgb_color_t){0, 0, 0}, TYPE_A);
+  body_t *b1 = body_init_with_polygon(shape_star_create(3, 1, 0.9), 1,
+                                      (rgb_color_t){0, 0, 0}, TYPE_B);
+  body_t *b2 = body_init_with_polygon(shape_circle_create(1), 1,
+                                      (rgb_color_t){0, 0, 0}, TYPE_B);
+  body_set_centroid(a, (vector_t){10, 0});
+  body_set_centroid(b1, (vector_t){-10, 0.5});
+  body_set_centroid(b2, (vector_t){-15, 1.95});
+  scene_add_body(scene, b1);
+  scene_add_body(scene, a);
+  scene_add_body(scene, b2);
+  body_set_velocity(a, (vector_t){-0.5, 0});
+  for (int i = 0; i < 60; i++) {
+    scene_tick(scene, 1);
+  }
+  int result = *count;
+  free(count);
+  scene_free(scene);
+  return result;
+}
+
+void test_collision_engines() {
+  int sat_count = count_polygon_collisions(COLLISION_ENGINE_SAT, false);
+  assert(sat_count == 2);
+  assert(count_polygon_collisions(COLLISION_ENGINE_GJK, false) == sat_count);
+  assert(count_polygon_collisions(COLLISION_ENGINE_GJK, true) == sat_count);
+
+  body_t *body1 = body_init_with_polygon(shape_circle_create(1), 1,
+                                         (rgb_color_t){0, 0, 0}, NULL);
+  body_t *body2 = body_init_with_polygon(shape_circle_create(1), 1,
+                                         (rgb_color_t){0, 0, 0}, NULL);
+  body_set_centroid(body2, (vector_t){0, 1.5});
+  gjk_simplex_t simplex = {0};
+  collision_info_t gjk = body_collide_gjk(body1, body2, &simplex);
+  collision_info_t sat = body_collide(body1, body2);
+  assert(gjk.collided && sat.collided);
+  assert(vec_within(1e-6, gjk.axis, (vector_t){0, 1}));
+  // the separating axis test does not orient edge normals of polygons
+  assert(within(1e-6, fabs(sat.axis.y), 1));
+  body_free(body1);
+  body_free(body2);
+}
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+// Counts the collisions between bodies drifting through a static wall,
+// switching to the given broad phase after switch_tick ticks
+static int count_drifting_collisions(broad_phase_t first,
+                                     broad_phase_t second, int switch_tick) {
+  const size_t NUM_BODIES = 40;
+  srand(1);
+  scene_t *scene = scene_init();
+  scene_set_broad_phase(scene, first);
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions, count,
+                           NULL);
+  body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){1, 60}),
+                                        INFINITY, (rgb_color_t){0, 0, 0},
+                                        TYPE_B);
+  body_set_static(wall);
+  scene_add_body(scene, wall);
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    body_t *body = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                       i % 2 == 0 ? TYPE_A : TYPE_B);
+    body_set_centroid(body, (vector_t){random_between(-30, 30),
+                                       random_between(-30, 30)});
+    body_set_velocity(body, (vector_t){random_between(-5, 5),
+                                       random_between(-5, 5)});
+    scene_add_body(scene, body);
+  }
+  for (int tick = 0; tick < 100; tick++) {
+    if (tick == switch_tick) {
+      scene_set_broad_phase(scene, second);
+    }
+    // bodies leaving the broad phase must not be paired again
+    if (tick % 10 == 5) {
+      scene_remove_body(scene, 1 + tick % (scene_bodies(scene) - 1));
+    }
+    scene_tick(scene, 0.1);
+  }
+  int result = *count;
+  free(count);
+  scene_free(scene);
+  return result;
+}
+
+// Every broad phase finds the same collisions as the grid
+void test_broad_phases() {
+  const broad_phase_t OTHERS[] = {BROAD_PHASE_SAP, BROAD_PHASE_TREE};
+  int grid = count_drifting_collisions(BROAD_PHASE_GRID, BROAD_PHASE_GRID, 0);
+  assert(grid > 10);
+  for (size_t i = 0; i < sizeof(OTHERS) / sizeof(*OTHERS); i++) {
+    assert(count_drifting_collisions(OTHERS[i], OTHERS[i], 0) == grid);
+    // switching mid-run keeps the collisions already in progress
+    assert(count_drifting_collisions(OTHERS[i], BROAD_PHASE_GRID, 50) == grid);
+    assert(count_drifting_collisions(BROAD_PHASE_GRID, OTHERS[i], 50) == grid);
+  }
+  assert(count_drifting_collisions(BROAD_PHASE_SAP, BROAD_PHASE_TREE, 50) ==
+         grid);
+}
+
+static void count_body(body_t *body, void *count) { (*(int *)count)++; }
+
+// Queries find bodies where they are now, in any broad phase
+void test_queries() {
+  const broad_phase_t BROAD_PHASES[] = {BROAD_PHASE_GRID, BROAD_PHASE_SAP,
+                                        BROAD_PHASE_TREE};
+  for (size_t i = 0; i < sizeof(BROAD_PHASES) / sizeof(*BROAD_PHASES); i++) {
+    scene_t *scene = scene_init();
+    scene_set_broad_phase(scene, BROAD_PHASES[i]);
+    body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){2, 100}),
+                                          INFINITY, (rgb_color_t){0, 0, 0},
+                                          TYPE_A);
+    body_set_centroid(wall, (vector_t){10, 0});
+    body_set_static(wall);
+    scene_add_body(scene, wall);
+    body_t *ball = body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, TYPE_B);
+    body_set_centroid(ball, (vector_t){0, 5});
+    scene_add_body(scene, ball);
+    scene_tick(scene, 0.1);
+
+    int count = 0;
+    scene_query_aabb(scene, (aabb_t){{-1, -1}, {10, 10}}, NULL, count_body,
+                     &count);
+    assert(count == 2);
+    count = 0;
+    scene_query_aabb(scene, (aabb_t){{-1, -1}, {10, 10}}, TYPE_B, count_body,
+                     &count);
+    assert(count == 1);
+    // the ball's bounding box reaches the point, but the ball does not
+    count = 0;
+    scene_query_radius(scene, (vector_t){0.9, 5.9}, 0.1, NULL, count_body,
+                       &count);
+    assert(count == 0);
+    scene_query_radius(scene, (vector_t){0, 7}, 1.5, NULL, count_body,
+                       &count);
+    assert(count == 1);
+
+    // a body moved between ticks is found where it is now
+    body_set_centroid(ball, (vector_t){50, 50});
+    count = 0;
+    scene_query_radius(scene, (vector_t){50, 50}, 1, TYPE_B, count_body,
+                       &count);
+    assert(count == 1);
+    body_remove(ball);
+    count = 0;
+    scene_query_radius(scene, (vector_t){50, 50}, 1, TYPE_B, count_body,
+                       &count);
+    assert(count == 0);
+    scene_free(scene);
+  }
+}
+
+static void record_body(body_t *body, void *found) {
+  ((bool *)found)[(size_t)body->info] = true;
+}
+
+// Queries between ticks see every change since the broad phase was updated,
+// whether it refreshes just the changed bodies or rebuilds
+void test_queries_track_changes() {
+  const broad_phase_t BROAD_PHASES[] = {BROAD_PHASE_GRID, BROAD_PHASE_SAP,
+                                        BROAD_PHASE_TREE};
+  const size_t NUM_BODIES = 40;
+  const size_t NUM_CHANGES = 60;
+  for (size_t i = 0; i < sizeof(BROAD_PHASES) / sizeof(*BROAD_PHASES); i++) {
+    srand(i);
+    scene_t *scene = scene_init();
+    scene_set_broad_phase(scene, BROAD_PHASES[i]);
+    body_t *bodies[NUM_BODIES + NUM_CHANGES];
+    size_t num_bodies = 0;
+    for (; num_bodies < NUM_BODIES; num_bodies++) {
+      bodies[num_bodies] =
+          body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, NULL);
+      bodies[num_bodies]->info = (void *)num_bodies;
+      body_set_centroid(bodies[num_bodies],
+                        (vector_t){rand() % 100, rand() % 100});
+      scene_add_body(scene, bodies[num_bodies]);
+    }
+    scene_tick(scene, 0.1);
+
+    for (size_t change = 0; change < NUM_CHANGES; change++) {
+      body_t *body = bodies[rand() % num_bodies];
+      switch (change % 4) {
+      case 0:
+        bodies[num_bodies] =
+            body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, NULL);
+        bodies[num_bodies]->info = (void *)num_bodies;
+        body_set_centroid(bodies[num_bodies],
+                          (vector_t){rand() % 100, rand() % 100});
+        scene_add_body(scene, bodies[num_bodies++]);
+        break;
+      case 1:
+        body_remove(body);
+        break;
+      default:
+        // moving a sleeping body wakes it, too
+        if (change % 4 == 2) {
+          body_sleep(body);
+        }
+        body_set_centroid(body, (vector_t){rand() % 100, rand() % 100});
+      }
+
+      // every query gives the bodies whose boxes overlap it now
+      for (int query = 0; query < 4; query++) {
+        double x = rand() % 100;
+        double y = rand() % 100;
+        aabb_t bounds = {{x, y}, {x + 20, y + 20}};
+        bool found[NUM_BODIES + NUM_CHANGES];
+        for (size_t j = 0; j < num_bodies; j++) {
+          found[j] = false;
+        }
+        scene_query_aabb(scene, bounds, NULL, record_body, found);
+        for (size_t j = 0; j < num_bodies; j++) {
+          assert(found[j] == (!body_is_removed(bodies[j]) &&
+                              aabb_overlaps(body_get_aabb(bodies[j]), bounds)));
+        }
+      }
+    }
+    scene_free(scene);
+  }
+}
+
+// Rays and circles cast through the scene stop at the first body they hit
+void test_casts() {
+  const broad_phase_t BROAD_PHASES[] = {BROAD_PHASE_GRID, BROAD_PHASE_SAP,
+                                        BROAD_PHASE_TREE};
+  for (size_t i = 0; i < sizeof(BROAD_PHASES) / sizeof(*BROAD_PHASES); i++) {
+    scene_t *scene = scene_init();
+    scene_set_broad_phase(scene, BROAD_PHASES[i]);
+    body_t *wall = body_init_with_polygon(shape_rectangle((vector_t){2, 100}),
+                                          INFINITY, (rgb_color_t){0, 0, 0},
+                                          TYPE_A);
+    body_set_centroid(wall, (vector_t){10, 0});
+    body_set_static(wall);
+    scene_add_body(scene, wall);
+    body_t *ball = body_init_circle(1, 1, (rgb_color_t){0, 0, 0}, TYPE_B);
+    body_set_centroid(ball, (vector_t){5, 0});
+    scene_add_body(scene, ball);
+
+    scene_hit_t hit = scene_raycast(scene, VEC_ZERO, (vector_t){2, 0}, 20,
+                                    NULL);
+    assert(hit.body == ball);
+    assert(within(1e-9, hit.distance, 4));
+    assert(vec_isclose(hit.point, (vector_t){4, 0}));
+    assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+
+    // only walls block the line of sight
+    hit = scene_raycast(scene, VEC_ZERO, (vector_t){1, 0}, 20, TYPE_A);
+    assert(hit.body == wall);
+    assert(within(1e-9, hit.distance, 9));
+    assert(vec_isclose(hit.point, (vector_t){9, 0}));
+    assert(vec_isclose(hit.normal, (vector_t){-1, 0}));
+    hit = scene_raycast(scene, VEC_ZERO, (vector_t){1, 0}, 8, TYPE_A);
+    assert(hit.body == NULL);
+    hit = scene_raycast(scene, VEC_ZERO, (vector_t){0, 1}, 20, NULL);
+    assert(hit.body == NULL);
+
+    // a thick ray hits the wall sooner, and grazes the ball
+    hit = scene_shape_cast(scene, VEC_ZERO, 1, (vector_t){1, 0}, 20, TYPE_A);
+    assert(hit.body == wall && within(1e-9, hit.distance, 8));
+    assert(vec_isclose(hit.point, (vector_t){9, 0}));
+    hit = scene_shape_cast(scene, (vector_t){0, 1.5}, 1, (vector_t){1, 0}, 20,
+                           NULL);
+    assert(hit.body == ball && hit.distance < 5);
+    scene_free(scene);
+  }
+}
+
+// Each type keeps its bodies, in order, and its layers decide what collides
+void test_body_types() {
+  scene_t *scene = scene_init();
+  assert(scene_type_id(scene, NULL) == 0);
+  // looking up a type without bodies doesn't give it an id
+  assert(scene_type_bodies(scene, TYPE_A) == 0);
+  size_t id_a = scene_type_id(scene, TYPE_A);
+  assert(id_a == 1);
+  size_t id_b = scene_type_id(scene, TYPE_B);
+  assert(id_a != 0 && id_b != 0 && id_a != id_b);
+  assert(scene_type_id(scene, TYPE_A) == id_a);
+
+  body_t *bodies[6];
+  for (size_t i = 0; i < 6; i++) {
+    bodies[i] = body_init_with_info(make_shape(), 1, (rgb_color_t){0, 0, 0},
+                                    i % 3 == 0 ? TYPE_A : TYPE_B);
+    scene_add_body(scene, bodies[i]);
+  }
+  scene_add_body(scene, body_init(make_shape(), 1, (rgb_color_t){0, 0, 0}));
+  assert(bodies[0]->type_id == id_a && bodies[1]->type_id == id_b);
+  assert(scene_type_bodies(scene, TYPE_A) == 2);
+  assert(scene_type_bodies(scene, TYPE_B) == 4);
+  assert(scene_type_bodies(scene, NULL) == 1);
+
+  // removed bodies leave their type's list when they are reaped
+  body_remove(bodies[2]);
+  assert(scene_type_bodies(scene, TYPE_B) == 4);
+  scene_tick(scene, 0);
+  assert(scene_type_bodies(scene, TYPE_B) == 3);
+  assert(scene_get_type_body(scene, TYPE_B, 0) == bodies[1]);
+  assert(scene_get_type_body(scene, TYPE_B, 1) == bodies[4]);
+  assert(scene_get_type_body(scene, TYPE_B, 2) == bodies[5]);
+  assert(scene_get_type_body(scene, TYPE_A, 1) == bodies[3]);
+
+  // all the bodies overlap, but only pairs whose layers match collide
+  int *count = malloc(sizeof(*count));
+  *count = 0;
+  scene_add_collision_rule(scene, TYPE_A, TYPE_B, count_collisions, count,
+                           NULL);
+  scene_set_type_layers(scene, TYPE_A, 1 << 0, 1 << 2);
+  scene_set_type_layers(scene, TYPE_B, 1 << 1, 1 << 0);
+  scene_tick(scene, 0);
+  assert(*count == 0);
+  scene_set_type_layers(scene, TYPE_A, 1 << 0, 1 << 1);
+  scene_tick(scene, 0);
+  assert(*count == 2 * 3);
+  free(count);
+  scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -242,6 +1248,27 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_force_creator)
   DO_TEST(test_force_creator_aux)
   DO_TEST(test_reaping)
+  DO_TEST(test_remove_keeps_other_forces)
+  DO_TEST(test_collision_rules)
+  DO_TEST(test_contact_rules)
+  DO_TEST(test_parallel_islands)
+  DO_TEST(test_sleeping)
+  DO_TEST(test_sleeping_input)
+  DO_TEST(test_step_fixed)
+  DO_TEST(test_step_fixed_deterministic)
+  DO_TEST(test_static_bodies)
+  DO_TEST(test_fast_bodies)
+  DO_TEST(test_fast_body_removed)
+  DO_TEST(test_fast_body_contact)
+  DO_TEST(test_substepping)
+  DO_TEST(test_body_bounds)
+  DO_TEST(test_circle_body)
+  DO_TEST(test_collision_engines)
+  DO_TEST(test_broad_phases)
+  DO_TEST(test_queries)
+  DO_TEST(test_queries_track_changes)
+  DO_TEST(test_casts)
+  DO_TEST(test_body_types)
 
   puts("scene_test PASS");
 }
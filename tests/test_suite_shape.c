@@ -7,9 +7,9 @@ void test_shape_star_create() {
   size_t num_points = 10;
   double inner_radius = 50.0;
   double outer_radius = 20.0;
-  list_t *shape = shape_star_create(num_points, inner_radius, outer_radius);
-  assert(list_size(shape) == num_points * 2);
-  list_free(shape);
+  polygon_t *shape = shape_star_create(num_points, inner_radius, outer_radius);
+  assert(shape->size == num_points * 2);
+  poly_free(shape);
 }
 
 int main(int argc, char **argv) {
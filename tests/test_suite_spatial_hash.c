@@ -0,0 +1,112 @@
+#include "spatial_hash.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct {
+  size_t count;
+  int *items[16][2];
+} pairs_t;
+
+static void record_pair(void *item1, void *item2, void *aux) {
+  pairs_t *pairs = aux;
+  assert(pairs->count < 16);
+  pairs->items[pairs->count][0] = item1;
+  pairs->items[pairs->count][1] = item2;
+  pairs->count++;
+}
+
+static aabb_t box(double min_x, double min_y, double max_x, double max_y) {
+  return (aabb_t){{min_x, min_y}, {max_x, max_y}};
+}
+
+void test_spatial_hash_pairs() {
+  int a, b, c, d;
+  spatial_hash_t *hash = spatial_hash_init(10);
+  // a and b overlap across several cells; c is far away; d touches only a
+  spatial_hash_insert(hash, &a, box(0, 0, 25, 25));
+  spatial_hash_insert(hash, &b, box(5, 5, 30, 30));
+  spatial_hash_insert(hash, &c, box(100, 100, 101, 101));
+  spatial_hash_insert(hash, &d, box(-5, -5, 1, 1));
+  assert(spatial_hash_size(hash) == 4);
+
+  pairs_t pairs = {0};
+  spatial_hash_find_pairs(hash, record_pair, &pairs);
+  // Each overlapping pair is reported exactly once, in insertion order
+  assert(pairs.count == 2);
+  bool found_ab = false, found_ad = false;
+  for (size_t i = 0; i < pairs.count; i++) {
+    assert(pairs.items[i][0] == &a);
+    found_ab |= pairs.items[i][1] == &b;
+    found_ad |= pairs.items[i][1] == &d;
+  }
+  assert(found_ab && found_ad);
+
+  spatial_hash_clear(hash);
+  assert(spatial_hash_size(hash) == 0);
+  pairs.count = 0;
+  spatial_hash_find_pairs(hash, record_pair, &pairs);
+  assert(pairs.count == 0);
+  spatial_hash_free(hash);
+}
+
+// Boxes sharing a cell are only reported if the boxes themselves overlap
+void test_spatial_hash_same_cell() {
+  int a, b;
+  spatial_hash_t *hash = spatial_hash_init(100);
+  spatial_hash_insert(hash, &a, box(0, 0, 1, 1));
+  spatial_hash_insert(hash, &b, box(2, 2, 3, 3));
+  pairs_t pairs = {0};
+  spatial_hash_find_pairs(hash, record_pair, &pairs);
+  assert(pairs.count == 0);
+  spatial_hash_free(hash);
+}
+
+static void record_item(void *item, void *aux) {
+  pairs_t *found = aux;
+  assert(found->count < 16);
+  found->items[found->count][0] = item;
+  found->count++;
+}
+
+void test_spatial_hash_query() {
+  int a, b, c;
+  spatial_hash_t *hash = spatial_hash_init(10);
+  spatial_hash_insert(hash, &a, box(0, 0, 25, 25));
+  spatial_hash_insert(hash, &b, box(40, 0, 45, 5));
+  spatial_hash_insert(hash, &c, box(-30, -30, -25, -25));
+
+  // a spans several of the queried cells but is only reported once
+  pairs_t found = {0};
+  spatial_hash_query(hash, box(5, 0, 42, 22), record_item, &found);
+  assert(found.count == 2);
+  assert((found.items[0][0] == &a && found.items[1][0] == &b) ||
+         (found.items[0][0] == &b && found.items[1][0] == &a));
+
+  // the hash can be queried again without changing
+  found.count = 0;
+  spatial_hash_query(hash, box(-29, -29, -28, -28), record_item, &found);
+  assert(found.count == 1);
+  assert(found.items[0][0] == &c);
+
+  found.count = 0;
+  spatial_hash_query(hash, box(100, 100, 200, 200), record_item, &found);
+  assert(found.count == 0);
+  spatial_hash_free(hash);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_spatial_hash_pairs)
+  DO_TEST(test_spatial_hash_same_cell)
+  DO_TEST(test_spatial_hash_query)
+
+  puts("spatial_hash_test PASS");
+}
@@ -0,0 +1,237 @@
+#include "sweep_prune.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct {
+  size_t count;
+  int *items[16][2];
+} pairs_t;
+
+static void record_pair(void *item1, void *item2, void *aux) {
+  pairs_t *pairs = aux;
+  assert(pairs->count < 16);
+  pairs->items[pairs->count][0] = item1;
+  pairs->items[pairs->count][1] = item2;
+  pairs->count++;
+}
+
+static bool has_pair(pairs_t *pairs, int *item1, int *item2) {
+  for (size_t i = 0; i < pairs->count; i++) {
+    if (pairs->items[i][0] == item1 && pairs->items[i][1] == item2) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static aabb_t box(double min_x, double min_y, double max_x, double max_y) {
+  return (aabb_t){{min_x, min_y}, {max_x, max_y}};
+}
+
+void test_sweep_prune_pairs() {
+  int a, b, c, d;
+  sweep_prune_t *sap = sweep_prune_init();
+  // a and b overlap; c is far away; d touches a at a corner
+  sweep_prune_insert(sap, &a, box(0, 0, 25, 25));
+  sweep_prune_insert(sap, &b, box(5, 5, 30, 30));
+  sweep_prune_insert(sap, &c, box(100, 100, 101, 101));
+  sweep_prune_insert(sap, &d, box(-5, -5, 0, 0));
+  assert(sweep_prune_size(sap) == 4);
+
+  // no pairs are known until the ends are sorted
+  pairs_t pairs = {0};
+  sweep_prune_find_pairs(sap, record_pair, &pairs);
+  assert(pairs.count == 0);
+
+  pairs_t added = {0};
+  sweep_prune_update_pairs(sap, record_pair, NULL, &added);
+  assert(added.count == 2);
+  assert(has_pair(&added, &a, &b) && has_pair(&added, &a, &d));
+  sweep_prune_find_pairs(sap, record_pair, &pairs);
+  assert(pairs.count == 2);
+  assert(has_pair(&pairs, &a, &b) && has_pair(&pairs, &a, &d));
+  sweep_prune_free(sap);
+}
+
+// Only changes in overlap are reported, as the boxes move
+void test_sweep_prune_events() {
+  int a, b, c;
+  sweep_prune_t *sap = sweep_prune_init();
+  size_t proxy_a = sweep_prune_insert(sap, &a, box(0, 0, 10, 10));
+  size_t proxy_b = sweep_prune_insert(sap, &b, box(20, 0, 30, 10));
+  size_t proxy_c = sweep_prune_insert(sap, &c, box(40, 0, 50, 10));
+  pairs_t added = {0};
+  pairs_t removed = {0};
+  sweep_prune_update_pairs(sap, record_pair, record_pair, &added);
+  assert(added.count == 0);
+
+  // b slides onto a; nothing else changes
+  sweep_prune_update(sap, proxy_b, box(5, 0, 15, 10));
+  sweep_prune_update(sap, proxy_c, box(40, 0, 50, 10));
+  sweep_prune_update_pairs(sap, record_pair, NULL, &added);
+  assert(added.count == 1 && has_pair(&added, &a, &b));
+
+  // a jumps past c; its pair with b ends and one with c starts
+  added.count = 0;
+  sweep_prune_update(sap, proxy_a, box(45, 5, 55, 15));
+  sweep_prune_update_pairs(sap, NULL, record_pair, &removed);
+  assert(removed.count == 1 && has_pair(&removed, &a, &b));
+  pairs_t pairs = {0};
+  sweep_prune_find_pairs(sap, record_pair, &pairs);
+  assert(pairs.count == 1 && has_pair(&pairs, &a, &c));
+
+  // moving apart along y alone also ends a pair
+  removed.count = 0;
+  sweep_prune_update(sap, proxy_a, box(45, 20, 55, 30));
+  sweep_prune_update_pairs(sap, NULL, record_pair, &removed);
+  assert(removed.count == 1 && has_pair(&removed, &a, &c));
+
+  // removing an item drops its pairs without reporting them
+  sweep_prune_update(sap, proxy_a, box(45, 5, 55, 15));
+  sweep_prune_update_pairs(sap, NULL, NULL, NULL);
+  removed.count = 0;
+  sweep_prune_remove(sap, proxy_c);
+  sweep_prune_update_pairs(sap, NULL, record_pair, &removed);
+  assert(removed.count == 0);
+  pairs.count = 0;
+  sweep_prune_find_pairs(sap, record_pair, &pairs);
+  assert(pairs.count == 0);
+  assert(sweep_prune_size(sap) == 2);
+  sweep_prune_free(sap);
+}
+
+static double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+static void count_added(void *item1, void *item2, void *count) {
+  (*(int *)count)++;
+}
+
+static void count_removed(void *item1, void *item2, void *count) {
+  (*(int *)count)--;
+}
+
+typedef struct {
+  aabb_t *bounds;
+  int *items;
+  size_t count;
+} check_aux_t;
+
+static void check_pair(void *item1, void *item2, void *aux) {
+  check_aux_t *check = aux;
+  size_t index1 = (int *)item1 - check->items;
+  size_t index2 = (int *)item2 - check->items;
+  assert(aabb_overlaps(check->bounds[index1], check->bounds[index2]));
+  check->count++;
+}
+
+// Random moving boxes give the same pairs as testing every pair
+void test_sweep_prune_matches_brute_force() {
+  const size_t NUM_BOXES = 60;
+  srand(0);
+  int items[NUM_BOXES];
+  aabb_t bounds[NUM_BOXES];
+  size_t proxies[NUM_BOXES];
+  bool inserted[NUM_BOXES];
+  sweep_prune_t *sap = sweep_prune_init();
+  for (size_t i = 0; i < NUM_BOXES; i++) {
+    double x = random_between(0, 100);
+    double y = random_between(0, 100);
+    double size = random_between(1, 10);
+    bounds[i] = box(x, y, x + size, y + size);
+    proxies[i] = sweep_prune_insert(sap, &items[i], bounds[i]);
+    inserted[i] = true;
+  }
+
+  int pair_count = 0;
+  for (size_t step = 0; step < 200; step++) {
+    bool any_removed = false;
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      if (rand() % 50 == 0) {
+        // take some boxes out, and put others back
+        if (inserted[i]) {
+          sweep_prune_remove(sap, proxies[i]);
+          inserted[i] = false;
+          any_removed = true;
+        } else {
+          proxies[i] = sweep_prune_insert(sap, &items[i], bounds[i]);
+          inserted[i] = true;
+        }
+      }
+      if (inserted[i]) {
+        vector_t move = {random_between(-2, 2), random_between(-2, 2)};
+        bounds[i].min = vec_add(bounds[i].min, move);
+        bounds[i].max = vec_add(bounds[i].max, move);
+        sweep_prune_update(sap, proxies[i], bounds[i]);
+      }
+    }
+    int changes = 0;
+    sweep_prune_update_pairs(sap, count_added, count_removed, &changes);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < NUM_BOXES; i++) {
+      for (size_t j = i + 1; j < NUM_BOXES; j++) {
+        expected +=
+            inserted[i] && inserted[j] && aabb_overlaps(bounds[i], bounds[j]);
+      }
+    }
+    check_aux_t check = {bounds, items, 0};
+    sweep_prune_find_pairs(sap, check_pair, &check);
+    assert(check.count == expected);
+    // removed boxes' pairs are dropped without being reported
+    if (!any_removed) {
+      assert(pair_count + changes == (int)expected);
+    }
+    pair_count = expected;
+  }
+  sweep_prune_free(sap);
+}
+
+static void record_item(void *item, void *aux) {
+  pairs_t *items = aux;
+  items->items[items->count++][0] = item;
+}
+
+// Queries see the current bounds, whether or not the ends are sorted
+void test_sweep_prune_query() {
+  int a, b, c;
+  sweep_prune_t *sap = sweep_prune_init();
+  size_t proxy_a = sweep_prune_insert(sap, &a, box(0, 0, 10, 10));
+  sweep_prune_insert(sap, &b, box(20, 0, 30, 10));
+  sweep_prune_insert(sap, &c, box(5, 20, 15, 30));
+  for (int sorted = 0; sorted <= 1; sorted++) {
+    if (sorted) {
+      sweep_prune_update_pairs(sap, NULL, NULL, NULL);
+    }
+    pairs_t items = {0};
+    sweep_prune_query(sap, box(8, 8, 22, 12), record_item, &items);
+    assert(items.count == 2);
+    items.count = 0;
+    sweep_prune_query(sap, box(-10, -10, -1, -1), record_item, &items);
+    assert(items.count == 0);
+  }
+  sweep_prune_update(sap, proxy_a, box(100, 100, 110, 110));
+  pairs_t items = {0};
+  sweep_prune_query(sap, box(100, 100, 101, 101), record_item, &items);
+  assert(items.count == 1 && items.items[0][0] == &a);
+  sweep_prune_free(sap);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_sweep_prune_pairs)
+  DO_TEST(test_sweep_prune_events)
+  DO_TEST(test_sweep_prune_matches_brute_force)
+  DO_TEST(test_sweep_prune_query)
+
+  puts("sweep_prune_test PASS");
+}
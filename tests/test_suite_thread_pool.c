@@ -0,0 +1,72 @@
+#include "test_util.h"
+#include "thread_pool.h"
+#include <assert.h>
+#include <stdlib.h>
+
+static void increment(void *counts, size_t index) { ((int *)counts)[index]++; }
+
+// Every job in a batch runs exactly once, however many workers there are
+void test_jobs_run_once() {
+  const size_t NUM_JOBS = 1000;
+  for (size_t num_workers = 0; num_workers <= 4; num_workers++) {
+    thread_pool_t *pool = thread_pool_init(num_workers);
+    assert(thread_pool_workers(pool) <= num_workers);
+    int *counts = calloc(NUM_JOBS, sizeof(int));
+    // the pool is reused for many batches of different sizes
+    for (size_t batch = 0; batch < 50; batch++) {
+      thread_pool_run(pool, increment, counts, batch % 3 == 0 ? 0 : NUM_JOBS);
+    }
+    for (size_t i = 0; i < NUM_JOBS; i++) {
+      assert(counts[i] == 33);
+    }
+    free(counts);
+    thread_pool_free(pool);
+  }
+}
+
+typedef struct {
+  double *results;
+  size_t iterations;
+} work_aux_t;
+
+static void do_work(work_aux_t *aux, size_t index) {
+  double x = index;
+  for (size_t i = 0; i < aux->iterations; i++) {
+    x = x * 0.999 + 1;
+  }
+  aux->results[index] = x;
+}
+
+// Jobs give the same results on any number of threads
+void test_results_match() {
+  const size_t NUM_JOBS = 64;
+  double expected[NUM_JOBS];
+  work_aux_t aux = {expected, 10000};
+  thread_pool_t *serial = thread_pool_init(0);
+  thread_pool_run(serial, (thread_pool_job_t)do_work, &aux, NUM_JOBS);
+  thread_pool_free(serial);
+
+  double results[NUM_JOBS];
+  aux.results = results;
+  thread_pool_t *pool = thread_pool_init(3);
+  thread_pool_run(pool, (thread_pool_job_t)do_work, &aux, NUM_JOBS);
+  for (size_t i = 0; i < NUM_JOBS; i++) {
+    assert(results[i] == expected[i]);
+  }
+  thread_pool_free(pool);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_jobs_run_once)
+  DO_TEST(test_results_match)
+
+  puts("thread_pool_test PASS");
+}